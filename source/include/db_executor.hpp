@@ -0,0 +1,391 @@
+#pragma once
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "orm_rttr.hpp"
+
+namespace orm_rttr {
+
+// ========== 数据库执行器 ==========
+// OrmService只生成SqlQueryResult；DbExecutor在独立线程池上取连接并执行，以协程返回ResultSet，
+// 阻塞的驱动调用不会占用io_context线程。query与queryBatch执行写语句成功后调用completeWrite，
+// 给出transaction时变更事件暂存到该事务（须在co_await返回后再提交）；连接断开或超时使结果未知时调用abandonWrite，
+// 普通语句错误不做处理；
+// withConnection内执行的写语句由调用方在提交后自行调用
+
+// 语句执行失败（SQL错误、约束冲突等），连接仍可继续使用
+class DbError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// 连接已不可用，归还连接池时丢弃
+class DbConnectionError : public DbError {
+public:
+    using DbError::DbError;
+};
+
+// 在acquire_timeout内未取得连接
+class DbTimeoutError : public DbError {
+public:
+    using DbError::DbError;
+};
+
+// 后端预编译语句
+class DbStatement {
+public:
+    virtual ~DbStatement() = default;
+    virtual ResultSet execute(const std::vector<ValueVariant>& params) = 0;
+};
+
+// 后端连接：prepare与ping由后端实现；execute按SQL文本缓存预编译语句（LRU），同一形状的语句只预编译一次
+class DbConnection {
+public:
+    virtual ~DbConnection() = default;
+
+    ResultSet execute(const SqlQueryResult& query);
+
+    // 在本连接上执行一组语句，按顺序返回结果；遇到错误即停止并抛出。
+    // 默认逐条执行，支持管道化的后端可一次发出全部语句后再依次读取结果
+    virtual std::vector<ResultSet> executeBatch(const std::vector<SqlQueryResult>& queries);
+
+    // 连接是否可用（连接池健康检查调用）
+    virtual bool ping() = 0;
+
+    void setStatementCacheCapacity(size_t capacity);
+    size_t cachedStatements() const { return m_statements.size(); }
+    uint64_t statementCacheHits() const { return m_hits; }
+    uint64_t statementCacheMisses() const { return m_misses; }
+
+protected:
+    virtual std::unique_ptr<DbStatement> prepare(const std::string& sql) = 0;
+
+private:
+    using Entry = std::pair<std::string, std::unique_ptr<DbStatement>>;
+    std::list<Entry> m_statements;  // 最近使用的在前
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> m_index;  // 键指向链表节点中的SQL文本
+    size_t m_capacity = 256;
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+};
+
+// 可插拔后端：每次调用建立一条新连接
+class DbBackend {
+public:
+    virtual ~DbBackend() = default;
+    virtual std::unique_ptr<DbConnection> connect() = 0;
+};
+
+struct PoolOptions {
+    size_t max_connections = 8;
+    std::chrono::milliseconds acquire_timeout{5000};
+    std::chrono::milliseconds health_check_idle{30000};  // 空闲超过该时长的连接取出前先ping
+    size_t statement_cache_size = 256;                   // 每条连接的预编译语句缓存容量
+};
+
+struct PoolStats {
+    size_t open = 0;        // 已建立的连接数（含借出）
+    size_t idle = 0;        // 空闲连接数
+    uint64_t acquired = 0;
+    uint64_t created = 0;
+    uint64_t discarded = 0; // 健康检查失败或标记为不可用而关闭的连接
+    uint64_t timeouts = 0;
+};
+
+// 有界连接池：空闲连接后进先出复用，达到上限时等待归还直到超时
+class ConnectionPool : public std::enable_shared_from_this<ConnectionPool> {
+public:
+    // 借出的连接，析构时归还；invalidate后归还时关闭
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(Lease&& other) noexcept = default;
+        Lease& operator=(Lease&& other) noexcept;
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        ~Lease() { release(); }
+
+        DbConnection& operator*() const { return *m_conn; }
+        DbConnection* operator->() const { return m_conn.get(); }
+        explicit operator bool() const { return m_conn != nullptr; }
+
+        void invalidate() { m_broken = true; }
+
+    private:
+        friend class ConnectionPool;
+        Lease(std::shared_ptr<ConnectionPool> pool, std::unique_ptr<DbConnection> conn)
+            : m_pool(std::move(pool)), m_conn(std::move(conn)) {}
+        void release();
+
+        std::shared_ptr<ConnectionPool> m_pool;
+        std::unique_ptr<DbConnection> m_conn;
+        bool m_broken = false;
+    };
+
+    static std::shared_ptr<ConnectionPool> create(std::shared_ptr<DbBackend> backend, PoolOptions options = {});
+
+    // 阻塞获取连接，超时抛出DbTimeoutError（在执行器线程池中调用）
+    Lease acquire();
+
+    PoolStats stats() const;
+    const PoolOptions& options() const { return m_options; }
+
+private:
+    struct IdleConnection {
+        std::unique_ptr<DbConnection> conn;
+        std::chrono::steady_clock::time_point since;
+    };
+
+    ConnectionPool(std::shared_ptr<DbBackend> backend, PoolOptions options)
+        : m_backend(std::move(backend)), m_options(options) {}
+
+    void giveBack(std::unique_ptr<DbConnection> conn, bool broken);
+
+    std::shared_ptr<DbBackend> m_backend;
+    PoolOptions m_options;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_available;
+    std::deque<IdleConnection> m_idle;
+    PoolStats m_stats;
+};
+
+// 一组互不依赖的查询的执行方式
+enum class BatchMode {
+    Pipelined,  // 借用一条连接，按管道方式依次发出
+    FanOut      // 每条语句各取一条连接并行执行，占用的连接数最多为语句数
+};
+
+// 协程执行器：co_await executor.query(OrmService<T>::selectByCondition(w))
+class DbExecutor {
+public:
+    explicit DbExecutor(std::shared_ptr<ConnectionPool> pool, size_t threads = 4);
+    ~DbExecutor();
+
+    DbExecutor(const DbExecutor&) = delete;
+    DbExecutor& operator=(const DbExecutor&) = delete;
+
+    boost::asio::awaitable<ResultSet> query(SqlQueryResult query, ChangeTransaction* transaction = nullptr);
+
+    // 一次等待取回一组查询的结果，顺序与queries一致；任一语句失败时抛出第一个错误
+    boost::asio::awaitable<std::vector<ResultSet>> queryBatch(std::vector<SqlQueryResult> queries,
+                                                             BatchMode mode = BatchMode::Pipelined,
+                                                             ChangeTransaction* transaction = nullptr);
+
+    // 在同一条连接上执行一组操作（临时表、事务等），fn在执行器线程中调用
+    template<typename Fn>
+    boost::asio::awaitable<std::invoke_result_t<Fn&, DbConnection&>> withConnection(Fn fn) {
+        using Result = std::invoke_result_t<Fn&, DbConnection&>;
+        return boost::asio::co_spawn(m_threads.get_executor(),
+            [pool = m_pool, fn = std::move(fn)]() mutable -> boost::asio::awaitable<Result> {
+                auto lease = pool->acquire();
+                try {
+                    co_return fn(*lease);
+                } catch (const DbConnectionError&) {
+                    lease.invalidate();
+                    throw;
+                }
+            }, boost::asio::use_awaitable);
+    }
+
+    // 按主键加载实体：依次查找请求级标识映射与二级实体缓存，未命中时查询并回填；
+    // 带锁读取直接查询，既不读取也不回填缓存。行不存在时返回空指针
+    template<typename Entity, typename IdType>
+    boost::asio::awaitable<std::shared_ptr<const Entity>> getById(IdType id, IdentityMap* identity = nullptr,
+                                                                  LockMode lock = LockMode::None) {
+        if (lock != LockMode::None) {
+            SqlQueryResult sql = OrmService<Entity>::getById(id, lock);
+            ResultSet rs = co_await query(std::move(sql));
+            if (rs.empty()) co_return nullptr;
+            co_return std::make_shared<const Entity>(OrmService<Entity>::mapRow(rs[0]));
+        }
+
+        const ValueVariant key = id;
+        if (identity) {
+            if (auto found = identity->find<Entity>(key)) co_return found;
+        }
+        EntityCache<Entity>& cache = EntityCache<Entity>::instance();
+        auto lookup = cache.lookup(key);
+        std::shared_ptr<const Entity> entity = lookup.entity;
+        if (!entity) {
+            SqlQueryResult sql = OrmService<Entity>::getById(id);
+            ResultSet rs = co_await query(std::move(sql));
+            if (rs.empty()) co_return nullptr;
+            entity = cache.store(lookup, OrmService<Entity>::mapRow(rs[0]));
+        }
+        if (identity) identity->put<Entity>(key, entity);
+        co_return entity;
+    }
+
+    ConnectionPool& pool() const { return *m_pool; }
+
+private:
+    boost::asio::awaitable<std::vector<ResultSet>> fanOut(std::vector<SqlQueryResult> queries, ChangeTransaction* transaction);
+
+    std::shared_ptr<ConnectionPool> m_pool;
+    boost::asio::thread_pool m_threads;
+};
+
+// ========== 读写分离 ==========
+
+struct RoutingOptions {
+    std::chrono::milliseconds sticky_window{2000};  // 会话写入后该时长内的读取也发往主库（读己之写）
+    bool replica_fallback = true;                     // 副本取连接超时或连接断开时改由主库执行
+};
+
+// 会话：记录最近一次写入的时间，可在同一请求或用户的多个协程间共享
+class DbSession {
+public:
+    void markWrite();
+    bool wroteWithin(std::chrono::milliseconds window) const;
+
+private:
+    std::atomic<long long> m_last_write{0};  // steady_clock计数，0表示尚未写入
+};
+
+// 语句组（queryBatch、withConnection）按一次计
+struct RouterStats {
+    uint64_t writes = 0;         // 写语句
+    uint64_t primary_reads = 0;  // 加锁读取或会话粘滞而发往主库的读取
+    uint64_t replica_reads = 0;
+    uint64_t fallbacks = 0;      // 副本失败后改由主库执行
+};
+
+// 读写分离路由：按SqlQueryResult::route（Auto时按语句类型）选择主库或轮询副本；没有副本时全部发往主库。
+// 须在同一连接上执行的语句（FoundRows分页的数据语句与 SELECT FOUND_ROWS()、InListPlan::Kind::TempTable
+// 的setup/queries/cleanup）经queryBatch（Pipelined）或withConnection整组发往同一节点
+class DbRouter {
+public:
+    DbRouter(std::shared_ptr<DbExecutor> primary, std::vector<std::shared_ptr<DbExecutor>> replicas,
+             RoutingOptions options = {});
+
+    // 实际执行目标：会话在粘滞窗口内时读取也发往主库
+    StatementRoute route(const SqlQueryResult& query, const DbSession* session = nullptr) const;
+
+    // 语句组的执行目标：任一语句须发往主库时整组发往主库
+    StatementRoute route(const std::vector<SqlQueryResult>& queries, const DbSession* session = nullptr) const;
+
+    boost::asio::awaitable<ResultSet> query(SqlQueryResult query, DbSession* session = nullptr,
+                                            ChangeTransaction* transaction = nullptr);
+
+    // 整组发往同一节点，粘滞与副本失败改由主库执行按组处理
+    boost::asio::awaitable<std::vector<ResultSet>> queryBatch(std::vector<SqlQueryResult> queries,
+                                                             BatchMode mode = BatchMode::Pipelined,
+                                                             DbSession* session = nullptr,
+                                                             ChangeTransaction* transaction = nullptr);
+
+    // 在目标节点的一条连接上执行一组操作；target为Primary时按写入计，会话随后进入粘滞窗口，
+    // 为Replica时会话在粘滞窗口内则改发主库
+    template<typename Fn>
+    boost::asio::awaitable<std::invoke_result_t<Fn&, DbConnection&>> withConnection(Fn fn, StatementRoute target,
+                                                                                   DbSession* session = nullptr) {
+        const bool primary = target == StatementRoute::Primary || m_replicas.empty()
+                             || (session && session->wroteWithin(m_options.sticky_window));
+        return dispatch(primary ? StatementRoute::Primary : StatementRoute::Replica, target == StatementRoute::Primary,
+                        session, [fn = std::move(fn)](DbExecutor& executor) { return executor.withConnection(fn); });
+    }
+
+    DbExecutor& primary() const { return *m_primary; }
+    DbExecutor& nextReplica();
+    RouterStats stats() const;
+
+private:
+    static bool writes(const SqlQueryResult& query) {
+        return query.route != StatementRoute::Replica && !internal::is_read_statement(query.sql);
+    }
+
+    // 在选定节点上执行：发往主库的写入完成（无论成功与否）后开始会话粘滞窗口；
+    // 发往副本时取连接超时或连接断开，按配置改由主库重新执行
+    template<typename Run>
+    auto dispatch(StatementRoute target, bool write, DbSession* session, Run run)
+        -> decltype(run(std::declval<DbExecutor&>())) {
+        using Result = typename decltype(run(std::declval<DbExecutor&>()))::value_type;
+        std::exception_ptr failure;
+        if (target == StatementRoute::Primary) {
+            if (!write) {
+                m_primary_reads.fetch_add(1, std::memory_order_relaxed);
+                co_return co_await run(*m_primary);
+            }
+            m_writes.fetch_add(1, std::memory_order_relaxed);
+            if constexpr (std::is_void_v<Result>) {
+                try {
+                    co_await run(*m_primary);
+                } catch (...) {
+                    failure = std::current_exception();
+                }
+                if (session) session->markWrite();
+                if (failure) std::rethrow_exception(failure);
+                co_return;
+            } else {
+                std::optional<Result> result;
+                try {
+                    result.emplace(co_await run(*m_primary));
+                } catch (...) {
+                    failure = std::current_exception();
+                }
+                if (session) session->markWrite();
+                if (failure) std::rethrow_exception(failure);
+                co_return std::move(*result);
+            }
+        }
+
+        m_replica_reads.fetch_add(1, std::memory_order_relaxed);
+        try {
+            co_return co_await run(nextReplica());
+        } catch (const DbTimeoutError&) {
+            failure = std::current_exception();
+        } catch (const DbConnectionError&) {
+            failure = std::current_exception();
+        }
+        if (!m_options.replica_fallback) std::rethrow_exception(failure);
+        m_fallbacks.fetch_add(1, std::memory_order_relaxed);
+        co_return co_await run(*m_primary);
+    }
+
+    std::shared_ptr<DbExecutor> m_primary;
+    std::vector<std::shared_ptr<DbExecutor>> m_replicas;
+    RoutingOptions m_options;
+    std::atomic<size_t> m_next{0};
+    std::atomic<uint64_t> m_writes{0};
+    std::atomic<uint64_t> m_primary_reads{0};
+    std::atomic<uint64_t> m_replica_reads{0};
+    std::atomic<uint64_t> m_fallbacks{0};
+};
+
+// 进程内后端：语句交给处理函数生成结果，用于离线测试与演示；处理函数可能被多个执行器线程同时调用
+class MemoryBackend : public DbBackend {
+public:
+    using Handler = std::function<ResultSet(const std::string& sql, const std::vector<ValueVariant>& params)>;
+
+    explicit MemoryBackend(Handler handler);
+
+    std::unique_ptr<DbConnection> connect() override;
+
+    // 模拟服务端断开：此前建立的连接ping失败，执行时抛出DbConnectionError
+    void dropConnections();
+
+    uint64_t connects() const;
+    uint64_t prepares() const;
+
+    struct State;
+
+private:
+    std::shared_ptr<State> m_state;
+};
+
+} // namespace orm_rttr
@@ -352,4 +352,32 @@ RTTR_REGISTRATION
         );
 }
 
+// 使用Boost.PFR静态描述符启用编译期路径（列顺序必须与结构体字段顺序一致，列名与上面的RTTR注册一致）
+namespace orm_rttr {
+
+    // ================ 部门表静态描述 ================
+    template<>
+    struct StaticEntity<entity::SysDept> : StaticEntityDefaults {
+        static constexpr std::string_view table = "sys_dept";
+        static constexpr std::array<std::string_view, 14> columns = {
+            "dept_id", "parent_id", "ancestors", "dept_name", "order_num", "leader", "phone",
+            "email", "status", "del_flag", "create_by", "create_time", "update_by", "update_time"
+        };
+        static constexpr bool pk_auto_increment = true;
+    };
+
+    // ================ 用户表静态描述 ================
+    template<>
+    struct StaticEntity<entity::SysUser> : StaticEntityDefaults {
+        static constexpr std::string_view table = "sys_user";
+        static constexpr std::array<std::string_view, 20> columns = {
+            "user_id", "dept_id", "user_name", "nick_name", "user_type", "email", "phonenumber",
+            "sex", "avatar", "password", "status", "del_flag", "login_ip", "login_date",
+            "pwd_update_date", "create_by", "create_time", "update_by", "update_time", "remark"
+        };
+        static constexpr bool pk_auto_increment = true;
+    };
+
+} // namespace orm_rttr
+
 #endif // SYS_ENTITIES_MAPPING_HPP 
\ No newline at end of file
@@ -9,6 +9,8 @@
 #include "sys_entities.hpp"
 #include "sys_entities_mapping.hpp"
 #include "../../include/orm_rttr.hpp"
+#include "../rbac/data_scope.hpp"
+#include "../rbac/dept_tree.hpp"
 
 namespace entity {
 
@@ -61,6 +63,22 @@ public:
         return orm_rttr::OrmService<SysUser>::selectPage(wrapper, pageParam);
     }
 
+    /**
+     * 获取数据权限范围内的用户列表查询SQL（分页），数据权限以预编译谓词追加，不再执行数据范围子查询
+     * @param pageParam 分页参数
+     * @param scope 当前用户的数据权限（rbac::DataScopeCompiler::compile）
+     * @return SQL查询结果对（计数SQL和数据SQL）
+     */
+    static std::pair<orm_rttr::SqlQueryResult, orm_rttr::SqlQueryResult> getUserListSql(
+            const orm_rttr::PageParam& pageParam,
+            const rbac::DataScope& scope) {
+        orm_rttr::QueryWrapper<SysUser> wrapper;
+        wrapper.eq("del_flag", '0');
+        scope.applyTo(wrapper, "`dept_id`", "`user_id`");
+        wrapper.orderBy("create_time", orm_rttr::OrderDirection::DESC);
+        return orm_rttr::OrmService<SysUser>::selectPage(wrapper, pageParam);
+    }
+
     /**
      * 获取带部门信息的用户查询SQL
      * @param userId 用户ID
@@ -254,6 +272,19 @@ public:
         return result;
     }
 
+    /**
+     * 获取部门及子部门的所有用户（由部门树展开子部门，不再扫描 sys_dept.ancestors）
+     * @param tree 已载入的部门树
+     * @param deptId 部门ID
+     * @return SQL查询结果
+     */
+    static orm_rttr::SqlQueryResult getUsersByDeptHierarchySql(const rbac::DeptTree& tree, int64_t deptId) {
+        orm_rttr::QueryWrapper<SysUser> wrapper;
+        tree.applyTo(wrapper, "dept_id", deptId);
+        wrapper.eq("del_flag", '0');
+        return orm_rttr::OrmService<SysUser>::selectByCondition(wrapper);
+    }
+
     /**
      * 将所有SQL查询保存到txt文件
      * @param filePath 文件路径
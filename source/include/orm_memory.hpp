@@ -0,0 +1,355 @@
+#ifndef ORM_MEMORY_HPP
+#define ORM_MEMORY_HPP
+
+#include <algorithm>
+#include <cctype>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string_view>
+#include <vector>
+#include "orm_rttr.hpp"
+
+namespace orm_rttr {
+
+// ========== 内存查询 ==========
+// 将QueryWrapper的条件、排序与分页编译为可直接作用于实体集合的谓词与比较器，
+// 语义与生成的SQL保持一致：NULL参与的比较均不成立，字符串比较与LIKE按ASCII忽略大小写（对应MySQL默认的_ci排序规则）
+
+namespace internal {
+    inline int ascii_icompare(std::string_view a, std::string_view b) {
+        const size_t n = std::min(a.size(), b.size());
+        for (size_t i = 0; i < n; ++i) {
+            int ca = std::tolower(static_cast<unsigned char>(a[i]));
+            int cb = std::tolower(static_cast<unsigned char>(b[i]));
+            if (ca != cb) return ca < cb ? -1 : 1;
+        }
+        return a.size() == b.size() ? 0 : (a.size() < b.size() ? -1 : 1);
+    }
+
+    template<typename T>
+    int three_way(const T& a, const T& b) {
+        return a < b ? -1 : (b < a ? 1 : 0);
+    }
+
+    // 按SQL规则比较两个值：任一为NULL或无法比较时返回空；字符串与数值比较时按数值比较
+    inline std::optional<int> compare_values(const ValueVariant& a, const ValueVariant& b) {
+        return std::visit([](const auto& x, const auto& y) -> std::optional<int> {
+            using X = std::decay_t<decltype(x)>;
+            using Y = std::decay_t<decltype(y)>;
+            if constexpr (std::is_same_v<X, std::monostate> || std::is_same_v<Y, std::monostate>) {
+                return std::nullopt;
+            } else if constexpr (std::is_arithmetic_v<X> && std::is_arithmetic_v<Y>) {
+                if constexpr (std::is_integral_v<X> && std::is_integral_v<Y>) {
+                    return three_way(static_cast<long long>(x), static_cast<long long>(y));
+                } else {
+                    return three_way(static_cast<double>(x), static_cast<double>(y));
+                }
+            } else if constexpr (std::is_same_v<X, std::string> && std::is_same_v<Y, std::string>) {
+                return ascii_icompare(x, y);
+            } else if constexpr (std::is_same_v<X, std::string> && std::is_arithmetic_v<Y>) {
+                double parsed = 0;
+                auto [ptr, ec] = std::from_chars(x.data(), x.data() + x.size(), parsed);
+                if (ec != std::errc() || ptr != x.data() + x.size()) return std::nullopt;
+                return three_way(parsed, static_cast<double>(y));
+            } else if constexpr (std::is_arithmetic_v<X> && std::is_same_v<Y, std::string>) {
+                double parsed = 0;
+                auto [ptr, ec] = std::from_chars(y.data(), y.data() + y.size(), parsed);
+                if (ec != std::errc() || ptr != y.data() + y.size()) return std::nullopt;
+                return three_way(static_cast<double>(x), parsed);
+            } else if constexpr (std::is_same_v<X, Y>) {
+                return three_way(x, y);
+            } else {
+                return std::nullopt;
+            }
+        }, a, b);
+    }
+
+    // LIKE匹配：%匹配任意串，_匹配单个字符，反斜杠转义，按ASCII忽略大小写
+    inline bool like_match(std::string_view text, std::string_view pattern) {
+        auto same = [](char a, char b) {
+            return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+        };
+        size_t t = 0, p = 0;
+        size_t star_p = std::string_view::npos, star_t = 0;
+        while (t < text.size()) {
+            if (p < pattern.size() && pattern[p] == '%') {
+                star_p = ++p;
+                star_t = t;
+                continue;
+            }
+            if (p < pattern.size()) {
+                bool escaped = pattern[p] == '\\' && p + 1 < pattern.size();
+                char pc = escaped ? pattern[p + 1] : pattern[p];
+                if ((!escaped && pc == '_') || same(pc, text[t])) {
+                    p += escaped ? 2 : 1;
+                    ++t;
+                    continue;
+                }
+            }
+            if (star_p == std::string_view::npos) return false;
+            p = star_p;
+            t = ++star_t;
+        }
+        while (p < pattern.size() && pattern[p] == '%') ++p;
+        return p == pattern.size();
+    }
+} // namespace internal
+
+template<typename Entity>
+class InMemoryQuery {
+private:
+    // 字段读取：静态实体直接读取字段，其余通过RTTR属性
+    struct Accessor {
+        ValueVariant (*getter)(const Entity&) = nullptr;
+        const PropertyPlan* prop = nullptr;
+
+        ValueVariant read(const Entity& entity) const {
+            return getter ? getter(entity) : prop->read(entity);
+        }
+    };
+
+    struct CompiledCondition {
+        Accessor field;
+        QueryOperator op;
+        std::vector<ValueVariant> values;
+    };
+
+    std::vector<CompiledCondition> m_conditions;
+    std::vector<std::pair<Accessor, OrderDirection>> m_order;
+    std::vector<ValueVariant> m_seek_after;
+    std::optional<Accessor> m_logical_delete;
+    LogicOperator m_logic_op = LogicOperator::AND;
+    int m_limit = -1;
+    int m_offset = -1;
+
+    static Accessor accessor(const std::string& field_name) {
+        const EntityPlan& plan = EntityPlan::of<Entity>();
+        Accessor acc;
+        acc.prop = &plan.property(field_name);
+        if constexpr (PfrEntity<Entity>) {
+            int field = internal::StaticPlan<Entity>::field_index(acc.prop->column);
+            if (field >= 0) acc.getter = internal::StaticPlan<Entity>::getters[field];
+        }
+        return acc;
+    }
+
+    static bool evaluate(const CompiledCondition& cond, const ValueVariant& value) {
+        auto cmp = [&](size_t i) { return internal::compare_values(value, cond.values[i]); };
+        switch (cond.op) {
+            case QueryOperator::__op_EQ: { auto c = cmp(0); return c && *c == 0; }
+            case QueryOperator::__op_NE: { auto c = cmp(0); return c && *c != 0; }
+            case QueryOperator::__op_GT: { auto c = cmp(0); return c && *c > 0; }
+            case QueryOperator::__op_GE: { auto c = cmp(0); return c && *c >= 0; }
+            case QueryOperator::__op_LT: { auto c = cmp(0); return c && *c < 0; }
+            case QueryOperator::__op_LE: { auto c = cmp(0); return c && *c <= 0; }
+            case QueryOperator::__op_LIKE:
+            case QueryOperator::__op_NOT_LIKE: {
+                const auto* text = std::get_if<std::string>(&value);
+                const auto* pattern = std::get_if<std::string>(&cond.values[0]);
+                if (!text || !pattern) return false;
+                return internal::like_match(*text, *pattern) == (cond.op == QueryOperator::__op_LIKE);
+            }
+            case QueryOperator::__op_IN:
+                for (size_t i = 0; i < cond.values.size(); ++i) {
+                    auto c = cmp(i);
+                    if (c && *c == 0) return true;
+                }
+                return false;
+            case QueryOperator::__op_NOT_IN:
+                for (size_t i = 0; i < cond.values.size(); ++i) {
+                    auto c = cmp(i);
+                    if (!c || *c == 0) return false;
+                }
+                return true;
+            case QueryOperator::__op_IS_NULL: return std::holds_alternative<std::monostate>(value);
+            case QueryOperator::__op_IS_NOT_NULL: return !std::holds_alternative<std::monostate>(value);
+            case QueryOperator::__op_BETWEEN: {
+                auto lo = cmp(0), hi = cmp(1);
+                return lo && hi && *lo >= 0 && *hi <= 0;
+            }
+            case QueryOperator::__op_NOT_BETWEEN: {
+                auto lo = cmp(0), hi = cmp(1);
+                return lo && hi && (*lo < 0 || *hi > 0);
+            }
+            case QueryOperator::__op_IN_SUBQUERY:
+            case QueryOperator::__op_NOT_IN_SUBQUERY:
+                break;
+        }
+        return false;
+    }
+
+    // 游标谓词：排序位置严格位于seek键值之后
+    bool afterSeek(const Entity& entity) const {
+        for (size_t i = 0; i < m_order.size(); ++i) {
+            auto c = internal::compare_values(m_order[i].first.read(entity), m_seek_after[i]);
+            if (!c) return false;
+            if (*c != 0) return m_order[i].second == OrderDirection::ASC ? *c > 0 : *c < 0;
+        }
+        return false;
+    }
+
+public:
+    // apply_logical_delete与OrmService::selectByCondition一致，排除逻辑删除标记为1的行
+    explicit InMemoryQuery(const QueryWrapper<Entity>& wrapper, bool apply_logical_delete = true)
+        : m_seek_after(wrapper.seekKeys()),
+          m_logic_op(wrapper.logicOperator()),
+          m_limit(wrapper.limitValue()),
+          m_offset(wrapper.offsetValue()) {
+        for (const auto& [field_name, op, values] : wrapper.conditions()) {
+            if (!internal::binds_values(op)) throw std::runtime_error("Subquery conditions cannot be evaluated in memory");
+            m_conditions.push_back({accessor(field_name), op, values});
+        }
+        if (!wrapper.appliedPredicates().empty()) throw std::runtime_error("Applied SQL predicates cannot be evaluated in memory");
+        for (const auto& [field_name, dir] : wrapper.orderFields()) {
+            m_order.emplace_back(accessor(field_name), dir);
+        }
+        if (!m_seek_after.empty() && m_seek_after.size() != m_order.size()) {
+            throw std::runtime_error("Seek key count does not match ORDER BY fields");
+        }
+        const EntityPlan& plan = EntityPlan::of<Entity>();
+        if (apply_logical_delete && plan.use_logical_delete && plan.logical_delete_index >= 0) {
+            m_logical_delete = accessor(plan.props[plan.logical_delete_index].name);
+        }
+    }
+
+    // 实体是否满足全部条件（不含排序与分页）
+    bool matches(const Entity& entity) const {
+        if (m_logical_delete) {
+            auto c = internal::compare_values(m_logical_delete->read(entity), 1);
+            if (!c || *c == 0) return false;
+        }
+        if (!m_seek_after.empty() && !afterSeek(entity)) return false;
+        if (m_conditions.empty()) return true;
+
+        const bool all = m_logic_op == LogicOperator::AND;
+        for (const auto& cond : m_conditions) {
+            if (evaluate(cond, cond.field.read(entity)) != all) return !all;
+        }
+        return all;
+    }
+
+    // 按orderBy字段比较，NULL在升序时排在最前
+    bool less(const Entity& a, const Entity& b) const {
+        for (const auto& [field, dir] : m_order) {
+            ValueVariant va = field.read(a), vb = field.read(b);
+            const bool na = std::holds_alternative<std::monostate>(va);
+            const bool nb = std::holds_alternative<std::monostate>(vb);
+            int c = 0;
+            if (na || nb) {
+                c = na == nb ? 0 : (na ? -1 : 1);
+            } else if (auto r = internal::compare_values(va, vb)) {
+                c = *r;
+            }
+            if (c != 0) return dir == OrderDirection::ASC ? c < 0 : c > 0;
+        }
+        return false;
+    }
+
+    // 过滤、排序并分页，返回指向源集合元素的指针
+    std::vector<const Entity*> selectRefs(const std::vector<Entity>& source) const {
+        std::vector<const Entity*> rows;
+        for (const auto& entity : source) {
+            if (matches(entity)) rows.push_back(&entity);
+        }
+        if (!m_order.empty()) {
+            std::stable_sort(rows.begin(), rows.end(), [this](const Entity* a, const Entity* b) { return less(*a, *b); });
+        }
+
+        const size_t begin = m_offset > 0 ? std::min(rows.size(), static_cast<size_t>(m_offset)) : 0;
+        size_t end = rows.size();
+        if (m_limit > -1) end = std::min(end, begin + static_cast<size_t>(m_limit));
+        return std::vector<const Entity*>(rows.begin() + static_cast<std::ptrdiff_t>(begin),
+                                          rows.begin() + static_cast<std::ptrdiff_t>(end));
+    }
+
+    std::vector<Entity> select(const std::vector<Entity>& source) const {
+        std::vector<Entity> result;
+        for (const Entity* entity : selectRefs(source)) result.push_back(*entity);
+        return result;
+    }
+
+    // 满足条件的行数（不受排序与分页影响）
+    long long count(const std::vector<Entity>& source) const {
+        return static_cast<long long>(std::count_if(source.begin(), source.end(), [this](const Entity& e) { return matches(e); }));
+    }
+};
+
+// 进程内实体表：小型热点表（部门、岗位、菜单等）整表常驻内存，直接用QueryWrapper查询；
+// 快照整体替换，读取方持有的快照不受后续load影响
+template<typename Entity>
+class InMemoryTable {
+public:
+    using Rows = std::vector<Entity>;
+
+    // 读取整表之前调用，返回值交给load：读取与载入之间完成的写入使快照仍被视为过期
+    uint64_t beginLoad() const {
+        return TableGeneration::instance().current(EntityPlan::of<Entity>().table_name);
+    }
+
+    // 载入整表数据；generation为读取前beginLoad的返回值
+    void load(Rows rows, uint64_t generation) {
+        auto snapshot = std::make_shared<const Rows>(std::move(rows));
+        std::lock_guard lock(m_mutex);
+        m_rows = std::move(snapshot);
+        m_generation = generation;
+        m_loaded = true;
+    }
+
+    std::shared_ptr<const Rows> snapshot() const {
+        std::lock_guard lock(m_mutex);
+        return m_rows;
+    }
+
+    // 未载入或载入后表已被写入时需要重新载入
+    bool stale() const {
+        std::lock_guard lock(m_mutex);
+        return !m_loaded || TableGeneration::instance().current(EntityPlan::of<Entity>().table_name) != m_generation;
+    }
+
+    Rows select(const QueryWrapper<Entity>& wrapper) const {
+        return InMemoryQuery<Entity>(wrapper).select(*snapshot());
+    }
+
+    std::optional<Entity> selectOne(const QueryWrapper<Entity>& wrapper) const {
+        auto rows = snapshot();
+        auto refs = InMemoryQuery<Entity>(wrapper).selectRefs(*rows);
+        if (refs.empty()) return std::nullopt;
+        return *refs.front();
+    }
+
+    long long count(const QueryWrapper<Entity>& wrapper) const {
+        return InMemoryQuery<Entity>(wrapper).count(*snapshot());
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    std::shared_ptr<const Rows> m_rows = std::make_shared<const Rows>();
+    uint64_t m_generation = 0;
+    bool m_loaded = false;
+};
+
+// 合并InListPlan::Kind::Split各段语句的结果：按主键去重（OR条件下同一行可能出现在多段中），
+// 再按原包装器的排序与分页截取；各段语句已按 offset+limit 取行，条件与逻辑删除无需重复判断
+template<typename Entity>
+std::vector<Entity> mergeSplitResults(std::vector<std::vector<Entity>> parts, const QueryWrapper<Entity>& wrapper) {
+    const EntityPlan& plan = EntityPlan::of<Entity>();
+    std::vector<Entity> rows;
+    std::set<ValueVariant> seen;
+    for (auto& part : parts) {
+        for (auto& entity : part) {
+            if (plan.pk_index >= 0 && !seen.insert(plan.props[plan.pk_index].read(entity)).second) continue;
+            rows.push_back(std::move(entity));
+        }
+    }
+
+    QueryWrapper<Entity> paging;
+    for (const auto& [field_name, dir] : wrapper.orderFields()) paging.orderBy(field_name, dir);
+    paging.limit(wrapper.limitValue()).offset(wrapper.offsetValue());
+    return InMemoryQuery<Entity>(paging, false).select(rows);
+}
+
+} // namespace orm_rttr
+
+#endif // ORM_MEMORY_HPP
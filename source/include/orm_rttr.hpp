@@ -17,12 +17,27 @@
 #include <functional>
 #include <memory>
 #include <algorithm>
+#include <iterator>
 #include <cmath> // For std::ceil
+#include <array>
+#include <string_view>
+#include <concepts>
+#include <charconv>
+#include <cctype>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <list>
+#include <typeinfo>
+#include <utility>
 
 // 引入 RTTR 库的核心头文件
 #include <rttr/registration>
 #include <rttr/type>
 
+// Boost.PFR 静态反射（可选的编译期字段访问路径）
+#include <boost/pfr.hpp>
+
 
 namespace orm_rttr {
 
@@ -40,50 +55,366 @@ using ValueVariant = std::variant<
     std::chrono::system_clock::time_point
 >;
 
-// 数据库行表示
-class DbRow {
+namespace internal {
+    // 支持std::string_view异构查找的字符串哈希
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view text) const { return std::hash<std::string_view>{}(text); }
+    };
+} // namespace internal
+
+// 结果集列结构：列名与列下标的映射，由同一结果集的所有行共享
+class ResultSchema {
+public:
+    ResultSchema() = default;
+
+    explicit ResultSchema(std::vector<std::string> columns) {
+        for (auto& column : columns) addColumn(std::move(column));
+    }
+
+    // 添加列并返回下标，已存在时返回原下标
+    size_t addColumn(std::string column) {
+        auto it = m_index.find(column);
+        if (it != m_index.end()) return it->second;
+        size_t idx = m_columns.size();
+        m_index.emplace(column, idx);
+        m_columns.push_back(std::move(column));
+        return idx;
+    }
+
+    // 按列名查找下标，不存在返回-1
+    int indexOf(std::string_view column) const {
+        auto it = m_index.find(column);
+        return it == m_index.end() ? -1 : static_cast<int>(it->second);
+    }
+
+    const std::string& columnName(size_t idx) const { return m_columns.at(idx); }
+    const std::vector<std::string>& columns() const { return m_columns; }
+    size_t size() const { return m_columns.size(); }
+
+private:
+    std::vector<std::string> m_columns;
+    std::unordered_map<std::string, size_t, internal::StringHash, std::equal_to<>> m_index;
+};
+
+namespace internal {
+    // 行读取接口，DbRow与DbRowView共用；派生类提供rowSchema()与rowValues()
+    template<typename Derived>
+    class RowAccess {
+    public:
+        bool hasColumn(std::string_view column) const {
+            return self().rowSchema().indexOf(column) >= 0;
+        }
+
+        // 按列名查找下标，不存在返回-1，可在遍历多行前预先计算
+        int columnIndex(std::string_view column) const {
+            return self().rowSchema().indexOf(column);
+        }
+
+        const ValueVariant& getValue(std::string_view column) const {
+            int idx = self().rowSchema().indexOf(column);
+            if (idx < 0) {
+                throw std::runtime_error("Column not found: " + std::string(column));
+            }
+            return self().rowValues()[idx];
+        }
+
+        // 按预先计算的列下标读取
+        const ValueVariant& getValue(size_t idx) const {
+            return self().rowValues()[idx];
+        }
+
+        template<typename T>
+        T getValueAs(std::string_view column) const {
+            return as<T>(getValue(column));
+        }
+
+        template<typename T>
+        T getValueAs(size_t idx) const {
+            return as<T>(getValue(idx));
+        }
+
+        size_t columnCount() const { return self().rowSchema().size(); }
+
+    private:
+        const Derived& self() const { return static_cast<const Derived&>(*this); }
+
+        template<typename T>
+        static T as(const ValueVariant& variant) {
+            if (std::holds_alternative<std::monostate>(variant)) {
+                // 返回默认值，如果需要NULL值处理则可以特化
+                return T();
+            }
+            return std::get<T>(variant);
+        }
+    };
+} // namespace internal
+
+// 结果集中一行的只读视图，不持有数据
+class DbRowView : public internal::RowAccess<DbRowView> {
+public:
+    DbRowView(const ResultSchema& schema, const ValueVariant* values) : m_schema(&schema), m_values(values) {}
+
+    const ResultSchema& rowSchema() const { return *m_schema; }
+    const ValueVariant* rowValues() const { return m_values; }
+
+private:
+    const ResultSchema* m_schema;
+    const ValueVariant* m_values;
+};
+
+// 数据库行表示（独立持有数据的单行，列结构可与结果集共享）
+class DbRow : public internal::RowAccess<DbRow> {
 private:
-    std::unordered_map<std::string, ValueVariant> values;
+    std::shared_ptr<ResultSchema> m_schema;
+    std::vector<ValueVariant> values;
 
 public:
-    DbRow() = default;
+    DbRow() : m_schema(std::make_shared<ResultSchema>()) {}
+
+    explicit DbRow(std::shared_ptr<ResultSchema> schema)
+        : m_schema(std::move(schema)), values(m_schema->size()) {}
 
     void setValue(const std::string& column, const ValueVariant& value) {
-        values[column] = value;
+        int idx = m_schema->indexOf(column);
+        if (idx < 0) {
+            // 列结构被其他行共享时先复制，避免影响其他行
+            if (m_schema.use_count() > 1) m_schema = std::make_shared<ResultSchema>(*m_schema);
+            idx = static_cast<int>(m_schema->addColumn(column));
+            values.resize(m_schema->size());
+        }
+        values[idx] = value;
     }
 
-    bool hasColumn(const std::string& column) const {
-        return values.find(column) != values.end();
+    void setValue(size_t idx, const ValueVariant& value) {
+        values.at(idx) = value;
     }
 
-    const ValueVariant& getValue(const std::string& column) const {
-        auto it = values.find(column);
-        if (it == values.end()) {
-            throw std::runtime_error("Column not found: " + column);
+    const ResultSchema& rowSchema() const { return *m_schema; }
+    const ValueVariant* rowValues() const { return values.data(); }
+
+    operator DbRowView() const { return DbRowView(*m_schema, values.data()); }
+};
+
+// 结果集表示：所有行共享一份列结构，数据按行优先连续存放
+class ResultSet {
+public:
+    class const_iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = DbRowView;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = DbRowView;
+
+        const_iterator(const ResultSet* rs, size_t row) : m_rs(rs), m_row(row) {}
+        DbRowView operator*() const { return (*m_rs)[m_row]; }
+        const_iterator& operator++() { ++m_row; return *this; }
+        const_iterator operator++(int) { auto tmp = *this; ++m_row; return tmp; }
+        const_iterator& operator--() { --m_row; return *this; }
+        const_iterator& operator+=(difference_type n) { m_row += n; return *this; }
+        const_iterator operator+(difference_type n) const { return {m_rs, m_row + n}; }
+        difference_type operator-(const const_iterator& other) const {
+            return static_cast<difference_type>(m_row) - static_cast<difference_type>(other.m_row);
+        }
+        bool operator==(const const_iterator& other) const { return m_row == other.m_row; }
+        bool operator!=(const const_iterator& other) const { return m_row != other.m_row; }
+
+    private:
+        const ResultSet* m_rs;
+        size_t m_row;
+    };
+
+    ResultSet() : m_schema(std::make_shared<ResultSchema>()) {}
+
+    explicit ResultSet(std::shared_ptr<ResultSchema> schema) : m_schema(std::move(schema)) {}
+
+    explicit ResultSet(std::vector<std::string> columns)
+        : m_schema(std::make_shared<ResultSchema>(std::move(columns))) {}
+
+    const ResultSchema& schema() const { return *m_schema; }
+    const std::shared_ptr<ResultSchema>& schemaPtr() const { return m_schema; }
+
+    // 添加列；已有数据时逐行补齐NULL
+    size_t addColumn(const std::string& column) {
+        int existing = m_schema->indexOf(column);
+        if (existing >= 0) return static_cast<size_t>(existing);
+        size_t old_width = m_schema->size();
+        if (m_schema.use_count() > 1) m_schema = std::make_shared<ResultSchema>(*m_schema);
+        size_t idx = m_schema->addColumn(column);
+        if (m_rows > 0) {
+            std::vector<ValueVariant> widened(m_rows * m_schema->size());
+            for (size_t r = 0; r < m_rows; ++r) {
+                std::move(m_cells.begin() + r * old_width, m_cells.begin() + (r + 1) * old_width,
+                          widened.begin() + r * m_schema->size());
+            }
+            m_cells = std::move(widened);
         }
-        return it->second;
+        return idx;
     }
 
-    template<typename T>
-    T getValueAs(const std::string& column) const {
-        const ValueVariant& variant = getValue(column);
-        if (std::holds_alternative<std::monostate>(variant)) {
-            // 返回默认值，如果需要NULL值处理则可以特化
-            return T();
+    int columnIndex(std::string_view column) const { return m_schema->indexOf(column); }
+    size_t columnCount() const { return m_schema->size(); }
+
+    size_t size() const { return m_rows; }
+    bool empty() const { return m_rows == 0; }
+
+    void reserve(size_t rows) { m_cells.reserve(rows * m_schema->size()); }
+
+    // 追加一行（全部为NULL），返回该行首个单元格，按列下标写入
+    ValueVariant* appendRow() {
+        m_cells.resize(m_cells.size() + m_schema->size());
+        ++m_rows;
+        return m_cells.data() + (m_rows - 1) * m_schema->size();
+    }
+
+    // 兼容逐行构建：按列名对齐到结果集的列结构
+    void push_back(const DbRow& row) {
+        const ResultSchema& row_schema = row.rowSchema();
+        std::vector<size_t> targets(row_schema.size());
+        for (size_t i = 0; i < row_schema.size(); ++i) {
+            targets[i] = addColumn(row_schema.columnName(i));
         }
-        return std::get<T>(variant);
+        ValueVariant* cells = appendRow();
+        for (size_t i = 0; i < targets.size(); ++i) {
+            cells[targets[i]] = row.getValue(i);
+        }
+    }
+
+    void clear() {
+        m_cells.clear();
+        m_rows = 0;
+    }
+
+    DbRowView operator[](size_t row) const {
+        return DbRowView(*m_schema, m_cells.data() + row * m_schema->size());
+    }
+
+    DbRowView at(size_t row) const {
+        if (row >= m_rows) throw std::out_of_range("Row index out of range");
+        return (*this)[row];
+    }
+
+    const ValueVariant& getValue(size_t row, size_t column) const {
+        return m_cells[row * m_schema->size() + column];
     }
+
+    const_iterator begin() const { return {this, 0}; }
+    const_iterator end() const { return {this, m_rows}; }
+
+    // 写语句的影响行数与自增主键（由执行器填写，查询语句为0）
+    long long affectedRows() const { return m_affected_rows; }
+    long long lastInsertId() const { return m_last_insert_id; }
+    void setAffectedRows(long long rows) { m_affected_rows = rows; }
+    void setLastInsertId(long long id) { m_last_insert_id = id; }
+
+private:
+    std::shared_ptr<ResultSchema> m_schema;
+    std::vector<ValueVariant> m_cells;  // 行优先存放的单元格
+    size_t m_rows = 0;
+    long long m_affected_rows = 0;
+    long long m_last_insert_id = 0;
+};
+
+// 语句的执行目标：Auto按语句类型判断，不带锁的查询可发往只读副本，写语句与加锁读取发往主库
+enum class StatementRoute { Auto, Primary, Replica };
+
+enum class ChangeOp { Insert, Update, Upsert, Delete };
+
+// 表变更事件，见ChangeEventBus
+struct ChangeEvent {
+    std::string table;
+    ChangeOp op = ChangeOp::Update;
+    std::vector<std::vector<ValueVariant>> keys;  // 每行的主键值，复合主键按声明顺序；按ID删除时只有该ID
+    bool complete = true;                          // false：语句是否执行未知或主键由数据库生成，keys不可信，订阅方应重新载入该表
+    uint64_t generation = 0;                       // 投递时分配
 };
 
-// 结果集表示
-using ResultSet = std::vector<DbRow>;
+// 写语句执行后的后续处理：OrmService生成写语句时填写，执行方在语句执行后交给completeWrite
+struct WriteEffect {
+    std::string table;                                      // 写入的表
+    std::vector<ValueVariant> ids;                          // 按主键写入的行，执行后在实体缓存中再次失效
+    void (*evict)(const std::vector<ValueVariant>&) = nullptr;  // 实体缓存失效，缓存未启用时为空
+    std::optional<ChangeEvent> change;                      // 执行成功后发布的变更事件，生成时没有订阅者则为空
+};
 
 // SQL查询结果
 struct SqlQueryResult {
     std::string sql;
     std::vector<ValueVariant> params;
+    StatementRoute route = StatementRoute::Auto;
+    std::shared_ptr<const WriteEffect> effect;  // 写语句的后续处理，读语句与手写SQL为空
+};
+
+// 借用参数：字符串以string_view引用实体字段或查询包装器中保存的值，其余类型按值保存
+using ParamView = std::variant<
+    std::monostate,
+    int, long, long long, double,
+    std::string_view,
+    bool,
+    std::chrono::system_clock::time_point
+>;
+
+// 借用参数的语句，仅在被引用的实体或包装器存活且未修改期间有效；
+// 需要跨越其生命周期保存时调用materialize()转换为SqlQueryResult
+struct SqlQueryView {
+    std::string sql;
+    std::vector<ParamView> params;
+    std::shared_ptr<const WriteEffect> effect;
+
+    SqlQueryResult materialize() const {
+        SqlQueryResult result{sql, {}, StatementRoute::Auto, effect};
+        result.params.reserve(params.size());
+        for (const auto& param : params) {
+            result.params.push_back(std::visit([](const auto& v) -> ValueVariant {
+                if constexpr (std::is_same_v<std::decay_t<decltype(v)>, std::string_view>) {
+                    return std::string(v);
+                } else {
+                    return v;
+                }
+            }, param));
+        }
+        return result;
+    }
 };
 
+namespace internal {
+    // 将ValueVariant借用为ParamView，字符串引用value内部数据
+    inline ParamView borrow_param(const ValueVariant& value) {
+        return std::visit([](const auto& v) -> ParamView {
+            if constexpr (std::is_same_v<std::decay_t<decltype(v)>, std::string>) {
+                return std::string_view(v);
+            } else {
+                return v;
+            }
+        }, value);
+    }
+}
+
+// 批量写入分块选项，任一上限达到即切分为新语句
+struct BatchOptions {
+    size_t max_rows = 1000;            // 每条语句最多行数
+    size_t max_params = 65535;         // 每条语句最多占位符数（MySQL预处理语句上限）
+    size_t max_bytes = 4 * 1024 * 1024; // SQL文本与参数的估算字节数上限（对应max_allowed_packet）
+};
+
+namespace internal {
+    // 将数值型ValueVariant转换为long long，非数值返回0
+    inline long long value_to_long_long(const ValueVariant& value) {
+        return std::visit([](const auto& v) -> long long {
+            using T = std::decay_t<decltype(v)>;
+            if constexpr (std::is_arithmetic_v<T>) return static_cast<long long>(v);
+            else return 0;
+        }, value);
+    }
+
+    // 估算参数在数据包中占用的字节数
+    inline size_t estimate_param_bytes(const ValueVariant& value) {
+        if (const auto* str = std::get_if<std::string>(&value)) return str->size() + 9;
+        return 9;
+    }
+}
+
 // 锁定模式枚举
 enum class LockMode { None, ForUpdate, ForShare };
 
@@ -93,9 +424,93 @@ enum class QueryOperator {
     __op_LIKE, __op_NOT_LIKE,
     __op_IN, __op_NOT_IN,
     __op_IS_NULL, __op_IS_NOT_NULL,
-    __op_BETWEEN, __op_NOT_BETWEEN
+    __op_BETWEEN, __op_NOT_BETWEEN,
+    __op_IN_SUBQUERY, __op_NOT_IN_SUBQUERY  // 取值为子查询SQL文本，不绑定参数
+};
+
+// 大IN列表改写策略（启动时配置）
+struct InListPolicy {
+    size_t bucket_threshold = 8;          // 达到该数量后去重排序，并以重复末值补齐到2的幂，使语句形状稳定
+    size_t split_threshold = 1024;        // 超过该数量时拆分为多条语句，每条最多该数量个值
+    size_t temp_table_threshold = 16384;  // 超过该数量时改用临时表连接
+
+    static InListPolicy& global() {
+        static InListPolicy policy;
+        return policy;
+    }
 };
 
+namespace internal {
+    inline size_t next_power_of_two(size_t n) {
+        size_t p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    // 去重排序后以重复末值补齐到2的幂（IN/NOT IN语义不变）
+    inline void bucket_in_values(std::vector<ValueVariant>& values) {
+        std::sort(values.begin(), values.end());
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+        if (values.empty()) return;
+        values.resize(next_power_of_two(values.size()), values.back());
+    }
+
+    inline void normalize_in_values(std::vector<ValueVariant>& values) {
+        if (values.size() >= InListPolicy::global().bucket_threshold) bucket_in_values(values);
+    }
+
+    // 条件的取值是否作为占位符参数绑定
+    inline bool binds_values(QueryOperator op) {
+        return op != QueryOperator::__op_IN_SUBQUERY && op != QueryOperator::__op_NOT_IN_SUBQUERY;
+    }
+}
+
+namespace internal {
+    inline bool ascii_iequal(std::string_view a, std::string_view b) {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (std::toupper(static_cast<unsigned char>(a[i])) != std::toupper(static_cast<unsigned char>(b[i]))) return false;
+        }
+        return true;
+    }
+
+    inline bool contains_keyword(std::string_view sql, std::string_view keyword) {
+        for (size_t i = 0; i + keyword.size() <= sql.size(); ++i) {
+            if (ascii_iequal(sql.substr(i, keyword.size()), keyword)) return true;
+        }
+        return false;
+    }
+
+    // 语句是否只读（按首个关键字判断，不考虑锁定子句）
+    inline bool is_read_statement(std::string_view sql) {
+        size_t pos = 0;
+        while (pos < sql.size() && (std::isspace(static_cast<unsigned char>(sql[pos])) || sql[pos] == '(')) ++pos;
+        size_t end = pos;
+        while (end < sql.size() && std::isalpha(static_cast<unsigned char>(sql[end]))) ++end;
+        const std::string_view verb = sql.substr(pos, end - pos);
+        return ascii_iequal(verb, "SELECT") || ascii_iequal(verb, "WITH") || ascii_iequal(verb, "SHOW")
+               || ascii_iequal(verb, "EXPLAIN") || ascii_iequal(verb, "DESCRIBE");
+    }
+
+    // 按语句文本判断执行目标：只读语句且不带锁定子句时为Replica，其余为Primary
+    inline StatementRoute classify_statement(std::string_view sql) {
+        if (!is_read_statement(sql)) return StatementRoute::Primary;
+        if (contains_keyword(sql, " FOR UPDATE") || contains_keyword(sql, " FOR SHARE")
+            || contains_keyword(sql, " LOCK IN SHARE MODE")) {
+            return StatementRoute::Primary;
+        }
+        return StatementRoute::Replica;
+    }
+
+    inline StatementRoute resolve_route(const SqlQueryResult& query) {
+        return query.route == StatementRoute::Auto ? classify_statement(query.sql) : query.route;
+    }
+
+    inline StatementRoute route_for(LockMode lock) {
+        return lock == LockMode::None ? StatementRoute::Replica : StatementRoute::Primary;
+    }
+}
+
 // 逻辑运算符枚举
 enum class LogicOperator { AND, OR };
 
@@ -104,6 +519,24 @@ enum class OrderDirection { ASC, DESC };
 
 // ========== 分页相关结构 ==========
 
+// 分页计数方式
+enum class PageCountMode {
+    Separate,   // 单独的COUNT语句（两次往返）
+    Window,     // 数据语句附带 COUNT(*) OVER() 总数列（MySQL 8+，一次往返）
+    FoundRows,  // SQL_CALC_FOUND_ROWS，随后在同一连接执行 SELECT FOUND_ROWS()（旧版MySQL）
+    SkipCount   // 不计数，多取一行只判断是否有下一页
+};
+
+// Window模式下附带的总数列名
+inline constexpr const char* PAGE_TOTAL_COLUMN = "__total";
+
+// 分页语句：count为需要单独执行的计数语句，Window与SkipCount模式下为空
+struct PageQuery {
+    SqlQueryResult data;
+    std::optional<SqlQueryResult> count;
+    PageCountMode mode = PageCountMode::Separate;
+};
+
 // 分页参数
 struct PageParam {
     int page_index = 1; // 当前页码，从1开始
@@ -120,12 +553,14 @@ struct PageResult {
     int size;                 // 每页记录数
     bool has_next;            // 是否有下一页
     bool has_previous;        // 是否有上一页
+    bool total_exact = true;  // total是否为精确值（估算或不计数时为false）
 
     // 辅助函数，用于从数据库结果构建分页对象
-    static PageResult<T> build(std::vector<T> recs, long long total_records, const PageParam& page) {
+    static PageResult<T> build(std::vector<T> recs, long long total_records, const PageParam& page, bool exact = true) {
         PageResult<T> res;
         res.records = std::move(recs);
         res.total = total_records;
+        res.total_exact = exact;
         res.size = page.page_size;
         res.current = page.page_index;
         res.pages = (total_records > 0 && page.page_size > 0) ? static_cast<int>(std::ceil(static_cast<double>(total_records) / page.page_size)) : 0;
@@ -133,6 +568,178 @@ struct PageResult {
         res.has_next = res.current < res.pages;
         return res;
     }
+
+    // 从结果集首行读取总数：Window模式读取总数列，FoundRows模式读取 SELECT FOUND_ROWS() 的第一列。
+    // Window模式下总数随行返回，首页以后的页没有行（页码越界）时总数未知，与无法解析的总数一样按-1返回
+    static PageResult<T> build(std::vector<T> recs, const ResultSet& totalSource, const PageParam& page) {
+        std::optional<long long> total_records;
+        if (!totalSource.empty()) {
+            int col = totalSource.columnIndex(PAGE_TOTAL_COLUMN);
+            const ValueVariant& value = totalSource.getValue(0, col >= 0 ? static_cast<size_t>(col) : 0);
+            total_records = std::visit([](const auto& v) -> std::optional<long long> {
+                using V = std::decay_t<decltype(v)>;
+                if constexpr (std::is_arithmetic_v<V>) {
+                    return static_cast<long long>(v);
+                } else if constexpr (std::is_same_v<V, std::string>) {
+                    long long parsed = 0;
+                    auto [ptr, ec] = std::from_chars(v.data(), v.data() + v.size(), parsed);
+                    if (ec != std::errc() || ptr != v.data() + v.size()) return std::nullopt;
+                    return parsed;
+                } else {
+                    return std::nullopt;
+                }
+            }, value);
+        } else if (page.page_index <= 1) {
+            total_records = 0;  // 首页没有行：结果确实为空
+        }
+        if (total_records) return build(std::move(recs), *total_records, page);
+
+        PageResult<T> res = build(std::move(recs), 0, page, false);
+        res.total = -1;
+        res.pages = -1;
+        return res;
+    }
+
+    // 不计数模式：recs为多取一行的查询结果，总数与总页数未知（-1）
+    static PageResult<T> buildSkipCount(std::vector<T> recs, const PageParam& page) {
+        PageResult<T> res;
+        const size_t limit = static_cast<size_t>(std::max(page.page_size, 0));
+        res.has_next = recs.size() > limit;
+        if (res.has_next) recs.erase(recs.begin() + static_cast<std::ptrdiff_t>(limit), recs.end());
+        res.records = std::move(recs);
+        res.total = -1;
+        res.pages = -1;
+        res.total_exact = false;
+        res.size = page.page_size;
+        res.current = page.page_index;
+        res.has_previous = res.current > 1;
+        return res;
+    }
+};
+
+// 游标（键集）分页参数
+struct SeekParam {
+    int page_size = 10;   // 每页记录数
+    std::string cursor;   // 上一页返回的续页令牌，为空表示第一页
+};
+
+namespace internal {
+    // 以类型标记+值的形式追加一个值，可无歧义地解析回ValueVariant
+    inline void append_value_key(std::string& raw, const ValueVariant& value) {
+        std::visit([&raw](const auto& v) {
+            using T = std::decay_t<decltype(v)>;
+            char buf[32];
+            if constexpr (std::is_same_v<T, std::monostate>) {
+                raw += 'n';
+            } else if constexpr (std::is_same_v<T, std::string>) {
+                raw += 's';
+                raw += std::to_string(v.size());
+                raw += ':';
+                raw += v;
+            } else if constexpr (std::is_same_v<T, bool>) {
+                raw += v ? "b1" : "b0";
+            } else if constexpr (std::is_same_v<T, std::chrono::system_clock::time_point>) {
+                raw += 't';
+                raw.append(buf, std::to_chars(buf, buf + sizeof(buf), static_cast<long long>(v.time_since_epoch().count())).ptr);
+                raw += ';';
+            } else {
+                raw += std::is_same_v<T, int> ? 'i' : std::is_same_v<T, long> ? 'l' : std::is_same_v<T, long long> ? 'L' : 'd';
+                raw.append(buf, std::to_chars(buf, buf + sizeof(buf), v).ptr);
+                raw += ';';
+            }
+        }, value);
+    }
+
+    // 将排序键值编码为不透明的续页令牌（整体十六进制编码）
+    inline std::string encode_seek_cursor(const std::vector<ValueVariant>& keys) {
+        std::string raw;
+        for (const auto& key : keys) append_value_key(raw, key);
+
+        static constexpr char hex[] = "0123456789abcdef";
+        std::string token;
+        token.reserve(raw.size() * 2);
+        for (unsigned char c : raw) {
+            token += hex[c >> 4];
+            token += hex[c & 0x0f];
+        }
+        return token;
+    }
+
+    // 解析续页令牌，格式不正确时抛出异常
+    inline std::vector<ValueVariant> decode_seek_cursor(std::string_view token) {
+        auto invalid = [] { return std::runtime_error("Invalid page cursor"); };
+        auto nibble = [&](char c) -> int {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            throw invalid();
+        };
+        if (token.size() % 2 != 0) throw invalid();
+        std::string raw(token.size() / 2, '\0');
+        for (size_t i = 0; i < raw.size(); ++i) {
+            raw[i] = static_cast<char>(nibble(token[2 * i]) << 4 | nibble(token[2 * i + 1]));
+        }
+
+        std::vector<ValueVariant> keys;
+        const char* pos = raw.data();
+        const char* end = raw.data() + raw.size();
+        auto number = [&](auto value) {
+            auto [ptr, ec] = std::from_chars(pos, end, value);
+            if (ec != std::errc() || ptr == end || *ptr != ';') throw invalid();
+            pos = ptr + 1;
+            return value;
+        };
+        while (pos < end) {
+            switch (*pos++) {
+                case 'n': keys.emplace_back(std::monostate{}); break;
+                case 'i': keys.emplace_back(number(int{})); break;
+                case 'l': keys.emplace_back(number(long{})); break;
+                case 'L': keys.emplace_back(number(0LL)); break;
+                case 'd': keys.emplace_back(number(double{})); break;
+                case 't':
+                    keys.emplace_back(std::chrono::system_clock::time_point(
+                        std::chrono::system_clock::duration(number(0LL))));
+                    break;
+                case 'b':
+                    if (pos == end) throw invalid();
+                    keys.emplace_back(*pos++ == '1');
+                    break;
+                case 's': {
+                    size_t len = 0;
+                    auto [ptr, ec] = std::from_chars(pos, end, len);
+                    if (ec != std::errc() || ptr == end || *ptr != ':' || static_cast<size_t>(end - ptr - 1) < len) throw invalid();
+                    keys.emplace_back(std::string(ptr + 1, len));
+                    pos = ptr + 1 + len;
+                    break;
+                }
+                default: throw invalid();
+            }
+        }
+        return keys;
+    }
+}
+
+// 游标分页结果
+template<typename T>
+struct CursorPageResult {
+    std::vector<T> records;   // 当前页记录
+    std::string next_cursor;  // 续页令牌，为空表示没有下一页
+    int size = 0;             // 每页记录数
+    bool has_next = false;    // 是否有下一页
+
+    // 从多取一行的查询结果构建，第page_size+1行只用于判断是否有下一页；keyOf返回记录的排序键值
+    template<typename KeyFn>
+    static CursorPageResult<T> build(std::vector<T> recs, const SeekParam& page, KeyFn&& keyOf) {
+        CursorPageResult<T> res;
+        res.size = page.page_size;
+        const size_t limit = static_cast<size_t>(std::max(page.page_size, 0));
+        res.has_next = recs.size() > limit;
+        if (res.has_next) recs.erase(recs.begin() + static_cast<std::ptrdiff_t>(limit), recs.end());
+        res.records = std::move(recs);
+        if (res.has_next && !res.records.empty()) {
+            res.next_cursor = internal::encode_seek_cursor(keyOf(res.records.back()));
+        }
+        return res;
+    }
 };
 
 // ========== ORM元数据键 ==========
@@ -261,6 +868,18 @@ namespace internal {
         throw std::runtime_error("Unsupported type for ValueVariant conversion: " + type_name);
     }
 
+    // 将ValueVariant转换为rttr::variant，NULL返回无效variant
+    inline rttr::variant value_variant_to_rttr(const ValueVariant& value) {
+        return std::visit([](const auto& v) -> rttr::variant {
+            using T = std::decay_t<decltype(v)>;
+            if constexpr (std::is_same_v<T, std::monostate>) {
+                return rttr::variant();
+            } else {
+                return v;
+            }
+        }, value);
+    }
+
     // 获取实体元数据，带默认值和错误检查
     inline std::string get_table_name(rttr::type t) {
         auto meta = t.get_metadata(meta::TABLE_NAME);
@@ -289,72 +908,1353 @@ namespace internal {
     }
 } // namespace internal
 
-// ========== 查询条件包装器 ==========
-template<typename Entity>
-class QueryWrapper {
-private:
-    using Condition = std::tuple<std::string, QueryOperator, std::vector<ValueVariant>>;
-    
-protected:
-    std::vector<Condition> m_conditions;
-    std::vector<std::pair<std::string, OrderDirection>> m_order_by;
-    LogicOperator m_logic_op = LogicOperator::AND;
-    int m_limit = -1;
-    int m_offset = -1;
-    std::vector<std::string> m_group_by; // 用于存储GROUP BY字段
+// ========== SQL文本写入器 ==========
+namespace internal {
+    // 复用线程局部缓冲区拼接SQL，避免stringstream的locale开销和反复扩容；数字使用std::to_chars格式化
+    class SqlWriter {
+    public:
+        explicit SqlWriter(size_t reserve = 256) : m_buf(acquire()) {
+            m_buf.reserve(reserve);
+        }
 
-    // 将任意类型转换为ValueVariant的辅助函数
-    template<typename T>
-    static ValueVariant to_val(const T& value) {
-        rttr::variant v = value;
-        return internal::rttr_to_value_variant(v);
-    }
+        ~SqlWriter() { release(std::move(m_buf)); }
 
-public:
-    QueryWrapper() = default;
+        SqlWriter(const SqlWriter&) = delete;
+        SqlWriter& operator=(const SqlWriter&) = delete;
 
-    // 所有条件方法
-    template<typename T> QueryWrapper& eq(const std::string& field, const T& value) { m_conditions.emplace_back(field, QueryOperator::__op_EQ, std::vector{to_val(value)}); return *this; }
-    template<typename T> QueryWrapper& ne(const std::string& field, const T& value) { m_conditions.emplace_back(field, QueryOperator::__op_NE, std::vector{to_val(value)}); return *this; }
-    template<typename T> QueryWrapper& gt(const std::string& field, const T& value) { m_conditions.emplace_back(field, QueryOperator::__op_GT, std::vector{to_val(value)}); return *this; }
-    template<typename T> QueryWrapper& ge(const std::string& field, const T& value) { m_conditions.emplace_back(field, QueryOperator::__op_GE, std::vector{to_val(value)}); return *this; }
-    template<typename T> QueryWrapper& lt(const std::string& field, const T& value) { m_conditions.emplace_back(field, QueryOperator::__op_LT, std::vector{to_val(value)}); return *this; }
-    template<typename T> QueryWrapper& le(const std::string& field, const T& value) { m_conditions.emplace_back(field, QueryOperator::__op_LE, std::vector{to_val(value)}); return *this; }
-    QueryWrapper& like(const std::string& field, const std::string& pattern) { m_conditions.emplace_back(field, QueryOperator::__op_LIKE, std::vector<ValueVariant>{to_val(pattern)}); return *this; }
-    QueryWrapper& notLike(const std::string& field, const std::string& pattern) { m_conditions.emplace_back(field, QueryOperator::__op_NOT_LIKE, std::vector<ValueVariant>{to_val(pattern)}); return *this; }
-    QueryWrapper& isNull(const std::string& field) { m_conditions.emplace_back(field, QueryOperator::__op_IS_NULL, std::vector<ValueVariant>{}); return *this; }
-    QueryWrapper& isNotNull(const std::string& field) { m_conditions.emplace_back(field, QueryOperator::__op_IS_NOT_NULL, std::vector<ValueVariant>{}); return *this; }
+        SqlWriter& operator<<(std::string_view text) {
+            m_buf.append(text);
+            return *this;
+        }
 
-    template<typename T>
-    QueryWrapper& in(const std::string& field, const std::vector<T>& values) {
-        std::vector<ValueVariant> variants;
-        std::transform(values.begin(), values.end(), std::back_inserter(variants), [](const T& v){ return to_val(v); });
-        m_conditions.emplace_back(field, QueryOperator::__op_IN, variants);
-        return *this;
-    }
+        SqlWriter& operator<<(char c) {
+            m_buf.push_back(c);
+            return *this;
+        }
 
-    template<typename T>
-    QueryWrapper& notIn(const std::string& field, const std::vector<T>& values) {
-        std::vector<ValueVariant> variants;
-        std::transform(values.begin(), values.end(), std::back_inserter(variants), [](const T& v){ return to_val(v); });
-        m_conditions.emplace_back(field, QueryOperator::__op_NOT_IN, variants);
-        return *this;
-    }
+        template<std::integral T>
+        SqlWriter& operator<<(T number) {
+            char tmp[24];
+            auto [end, ec] = std::to_chars(tmp, tmp + sizeof(tmp), number);
+            m_buf.append(tmp, end);
+            return *this;
+        }
 
-    template<typename T1, typename T2>
-    QueryWrapper& between(const std::string& field, const T1& start, const T2& end) {
-        m_conditions.emplace_back(field, QueryOperator::__op_BETWEEN, std::vector{to_val(start), to_val(end)});
-        return *this;
-    }
+        void reserve(size_t n) { m_buf.reserve(n); }
+        size_t size() const { return m_buf.size(); }
+        bool empty() const { return m_buf.empty(); }
+        std::string_view view() const { return m_buf; }
 
-    template<typename T1, typename T2>
-    QueryWrapper& notBetween(const std::string& field, const T1& start, const T2& end) {
-        m_conditions.emplace_back(field, QueryOperator::__op_NOT_BETWEEN, std::vector{to_val(start), to_val(end)});
-        return *this;
-    }
+        // 复制出恰好大小的结果，缓冲区留给下一条语句使用
+        std::string str() const { return std::string(m_buf); }
 
-    // 逻辑与排序
-    QueryWrapper& and_() { m_logic_op = LogicOperator::AND; return *this; }
+    private:
+        std::string m_buf;
+
+        static constexpr size_t kMaxPooled = 8;                // 每线程最多保留的缓冲区个数
+        static constexpr size_t kMaxPooledCapacity = 1 << 20;  // 超过该容量的缓冲区不回收
+
+        static std::vector<std::string>& pool() {
+            thread_local std::vector<std::string> buffers;
+            return buffers;
+        }
+
+        static std::string acquire() {
+            auto& buffers = pool();
+            if (buffers.empty()) return {};
+            std::string buf = std::move(buffers.back());
+            buffers.pop_back();
+            buf.clear();
+            return buf;
+        }
+
+        static void release(std::string&& buf) {
+            auto& buffers = pool();
+            if (buf.capacity() > kMaxPooledCapacity || buffers.size() >= kMaxPooled) return;
+            buffers.push_back(std::move(buf));
+        }
+    };
+} // namespace internal
+
+// ========== 实体元数据计划 ==========
+
+// 属性值的类型分类，构建计划时确定一次，读取时不再逐个比较rttr::type
+enum class ValueKind { Int, Long, LongLong, Double, Float, Char, String, Bool, TimePoint, Other };
+
+// 单个属性的预编译信息
+struct PropertyPlan {
+    rttr::property prop;            // RTTR属性访问器
+    std::string name;               // 属性名
+    std::string column;             // 列名
+    std::string quoted_column;      // 带反引号的列名
+    ValueKind kind;                 // 值类型分类
+    bool primary_key = false;       // 主键标记
+    bool auto_increment = false;    // 自增标记
+    bool negative_as_null = false;  // 负数空值标记
+
+    // 需要做负数空值检测时返回属性指针，否则返回nullptr
+    const rttr::property* null_prop() const { return negative_as_null ? &prop : nullptr; }
+
+    // 按属性的实际类型转换并写入值，NULL时保持原值（定义见静态反射后端之后）
+    void write(rttr::instance obj, const ValueVariant& value) const;
+
+    // 读取属性值并转换为ValueVariant，apply_null为true时应用负数空值规则
+    ValueVariant read(rttr::instance obj, bool apply_null = false) const {
+        rttr::variant v = prop.get_value(obj);
+        const rttr::property* np = apply_null ? null_prop() : nullptr;
+        switch (kind) {
+            case ValueKind::Int: return internal::handle_numeric_value(v.get_value<int>(), np);
+            case ValueKind::Long: return internal::handle_numeric_value(v.get_value<long>(), np);
+            case ValueKind::LongLong: return internal::handle_numeric_value(v.get_value<long long>(), np);
+            case ValueKind::Double: return internal::handle_numeric_value(v.get_value<double>(), np);
+            case ValueKind::Float: return internal::handle_numeric_value(v.get_value<float>(), np);
+            case ValueKind::Char: return std::string(1, v.get_value<char>());
+            case ValueKind::String: return v.get_value<std::string>();
+            case ValueKind::Bool: return v.get_value<bool>();
+            case ValueKind::TimePoint: return v.get_value<std::chrono::system_clock::time_point>();
+            case ValueKind::Other: break;
+        }
+        return internal::rttr_to_value_variant(v, np);
+    }
+};
+
+// 实体级预编译元数据：表名、列名、主键下标及各类自动填充字段，每个实体类型只构建一次
+class EntityPlan {
+public:
+    rttr::type type;
+    std::string table_name;                   // 表名
+    std::string quoted_table;                 // 带反引号的表名
+    std::vector<PropertyPlan> props;          // 按注册顺序排列的属性
+    std::vector<size_t> insert_indices;       // 插入时使用的属性下标（跳过自增列）
+    std::string insert_columns_sql;           // 预拼接的插入列清单
+    std::string batch_insert_prefix;          // INSERT INTO `t` (`a`, `b`) VALUES
+    std::string batch_row_sql;                // (?,?) 批量插入单行占位符
+    int pk_index = -1;                        // 主键属性下标
+
+    bool use_logical_delete = false;
+    std::string logical_delete_field;         // 逻辑删除字段（元数据原值）
+    int logical_delete_index = -1;
+    bool use_version = false;
+    std::string version_field;                // 版本字段（元数据原值）
+    int version_index = -1;
+    std::string create_time_field;            // 创建时间字段（元数据原值）
+    int create_time_index = -1;
+    std::string update_time_field;            // 更新时间字段（元数据原值）
+    int update_time_index = -1;
+
+    explicit EntityPlan(rttr::type t) : type(t) {
+        table_name = internal::get_table_name(t);
+        quoted_table = "`" + table_name + "`";
+
+        for (auto& prop : t.get_properties()) {
+            PropertyPlan p{prop, prop.get_name().to_string(), internal::get_column_name(prop), "", classify(prop.get_type())};
+            p.quoted_column = "`" + p.column + "`";
+            p.primary_key = prop.get_metadata(meta::PRIMARY_KEY).to_bool();
+            p.auto_increment = prop.get_metadata(meta::AUTO_INCREMENT).to_bool();
+            p.negative_as_null = prop.get_metadata(meta::NEGATIVE_AS_NULL).to_bool();
+            if (p.primary_key && pk_index < 0) pk_index = static_cast<int>(props.size());
+            m_index.emplace(p.name, props.size());
+            props.push_back(std::move(p));
+        }
+
+        for (size_t i = 0; i < props.size(); ++i) {
+            if (props[i].auto_increment) continue;
+            if (!insert_indices.empty()) insert_columns_sql += ", ";
+            insert_columns_sql += props[i].quoted_column;
+            insert_indices.push_back(i);
+        }
+        batch_insert_prefix = "INSERT INTO " + quoted_table + " (" + insert_columns_sql + ") VALUES ";
+        batch_row_sql = "(";
+        for (size_t i = 0; i < insert_indices.size(); ++i) {
+            if (i > 0) batch_row_sql += ",";
+            batch_row_sql += "?";
+        }
+        batch_row_sql += ")";
+
+        use_logical_delete = t.get_metadata(meta::USE_LOGICAL_DELETE).to_bool();
+        if (auto m = t.get_metadata(meta::LOGICAL_DELETE_FIELD); m) {
+            logical_delete_field = m.to_string();
+            logical_delete_index = indexOf(logical_delete_field);
+        }
+        use_version = t.get_metadata(meta::USE_VERSION).to_bool();
+        if (auto m = t.get_metadata(meta::VERSION_FIELD); m) {
+            version_field = m.to_string();
+            version_index = indexOf(version_field);
+        }
+        if (auto m = t.get_metadata(meta::CREATE_TIME_FIELD); m) {
+            create_time_field = m.to_string();
+            create_time_index = indexOf(create_time_field);
+        }
+        if (auto m = t.get_metadata(meta::UPDATE_TIME_FIELD); m) {
+            update_time_field = m.to_string();
+            update_time_index = indexOf(update_time_field);
+        }
+    }
+
+    // 获取实体类型的计划（首次调用时构建，线程安全）
+    template<typename Entity>
+    static const EntityPlan& of() {
+        static const EntityPlan plan(rttr::type::get<Entity>());
+        return plan;
+    }
+
+    // 按属性名查找下标，不存在返回-1
+    int indexOf(const std::string& name) const {
+        auto it = m_index.find(name);
+        return it == m_index.end() ? -1 : static_cast<int>(it->second);
+    }
+
+    // 按属性名获取属性计划，不存在时抛出异常
+    const PropertyPlan& property(const std::string& name) const {
+        int idx = indexOf(name);
+        if (idx < 0) throw std::runtime_error("Property '" + name + "' not found in type " + std::string(type.get_name()));
+        return props[idx];
+    }
+
+    // 获取主键属性计划，未定义主键时抛出异常
+    const PropertyPlan& primaryKey() const {
+        if (pk_index < 0) throw std::runtime_error("No primary key defined for type " + std::string(type.get_name()));
+        return props[pk_index];
+    }
+
+private:
+    std::unordered_map<std::string, size_t> m_index;  // 属性名 -> 下标
+
+    static ValueKind classify(rttr::type t) {
+        if (t == rttr::type::get<int>()) return ValueKind::Int;
+        if (t == rttr::type::get<long>()) return ValueKind::Long;
+        if (t == rttr::type::get<long long>()) return ValueKind::LongLong;
+        if (t == rttr::type::get<double>()) return ValueKind::Double;
+        if (t == rttr::type::get<float>()) return ValueKind::Float;
+        if (t == rttr::type::get<char>()) return ValueKind::Char;
+        if (t == rttr::type::get<std::string>()) return ValueKind::String;
+        if (t == rttr::type::get<bool>()) return ValueKind::Bool;
+        if (t == rttr::type::get<std::chrono::system_clock::time_point>()) return ValueKind::TimePoint;
+        return ValueKind::Other;
+    }
+};
+
+// ========== Boost.PFR 静态反射后端 ==========
+// 为实体特化StaticEntity即可启用编译期路径：列名来自constexpr描述符，
+// 字段通过boost::pfr::get<I>直接访问，插入与结果映射不再经过rttr::variant。
+// 未特化的实体继续使用RTTR元数据。
+template<typename Entity>
+struct StaticEntity;
+
+// 描述符默认值，特化时继承并按需覆盖
+struct StaticEntityDefaults {
+    static constexpr int pk_index = 0;              // 主键字段下标
+    static constexpr bool pk_auto_increment = false; // 主键是否自增（插入时跳过）
+    static constexpr int create_time_index = -1;    // 插入时自动填充的创建时间字段
+    static constexpr int update_time_index = -1;    // 插入时自动填充的更新时间字段
+    static constexpr int version_index = -1;        // 插入时初始化为1的版本字段
+};
+
+template<typename Entity>
+concept PfrEntity = requires {
+    { StaticEntity<Entity>::table } -> std::convertible_to<std::string_view>;
+    { StaticEntity<Entity>::columns.size() } -> std::convertible_to<size_t>;
+};
+
+namespace internal {
+    template<typename T> struct is_optional : std::false_type {};
+    template<typename T> struct is_optional<std::optional<T>> : std::true_type {};
+
+    // 字段值直接转换为ValueVariant（与rttr_to_value_variant的规则一致）
+    template<typename T>
+    ValueVariant to_value_variant(const T& val) {
+        if constexpr (std::is_same_v<T, char>) {
+            return std::string(1, val);
+        } else if constexpr (std::is_same_v<T, float>) {
+            return static_cast<double>(val);
+        } else if constexpr (std::is_same_v<T, int> || std::is_same_v<T, long> || std::is_same_v<T, long long> ||
+                             std::is_same_v<T, double> || std::is_same_v<T, bool> || std::is_same_v<T, std::string> ||
+                             std::is_same_v<T, std::chrono::system_clock::time_point>) {
+            return val;
+        } else if constexpr (std::is_integral_v<T>) {
+            return static_cast<long long>(val);
+        } else if constexpr (is_optional<T>::value) {
+            if (!val) return std::monostate{};
+            return to_value_variant(*val);
+        } else {
+            static_assert(sizeof(T) == 0, "Unsupported field type for ValueVariant conversion");
+        }
+    }
+
+    // 字段值借用为ParamView：字符串与char字段直接引用实体内存，规则与to_value_variant一致
+    template<typename T>
+    ParamView to_param_view(const T& val) {
+        if constexpr (std::is_same_v<T, std::string>) {
+            return std::string_view(val);
+        } else if constexpr (std::is_same_v<T, char>) {
+            return std::string_view(&val, 1);
+        } else if constexpr (is_optional<T>::value) {
+            if (!val) return std::monostate{};
+            return to_param_view(*val);
+        } else {
+            return borrow_param(to_value_variant(val));
+        }
+    }
+
+    // 可直接转换为ValueVariant、无需经过rttr::variant的值类型
+    template<typename T>
+    concept DirectValue = std::is_arithmetic_v<T> || std::is_same_v<T, std::string> ||
+                          std::is_same_v<T, std::chrono::system_clock::time_point> || is_optional<T>::value;
+
+    // 将ValueVariant写入字段，NULL或类型不兼容时保持字段原值
+    template<typename T>
+    void assign_from_value(T& field, const ValueVariant& value) {
+        if (std::holds_alternative<std::monostate>(value)) return;
+        if constexpr (is_optional<T>::value) {
+            typename T::value_type inner{};
+            assign_from_value(inner, value);
+            field = std::move(inner);
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            if (auto* s = std::get_if<std::string>(&value)) field = *s;
+        } else if constexpr (std::is_same_v<T, char>) {
+            if (auto* s = std::get_if<std::string>(&value)) {
+                if (!s->empty()) field = (*s)[0];
+            } else if (auto* i = std::get_if<int>(&value)) {
+                field = static_cast<char>(*i);
+            }
+        } else if constexpr (std::is_same_v<T, std::chrono::system_clock::time_point>) {
+            if (auto* tp = std::get_if<std::chrono::system_clock::time_point>(&value)) field = *tp;
+        } else if constexpr (std::is_arithmetic_v<T>) {
+            std::visit([&field](const auto& v) {
+                using V = std::decay_t<decltype(v)>;
+                if constexpr (std::is_arithmetic_v<V>) field = static_cast<T>(v);
+            }, value);
+        }
+    }
+
+    // 静态实体的预拼接SQL片段，只依赖constexpr描述符
+    template<typename Entity>
+    struct StaticPlan {
+        using Desc = StaticEntity<Entity>;
+        static constexpr size_t field_count = boost::pfr::tuple_size_v<Entity>;
+        static_assert(Desc::columns.size() == field_count, "StaticEntity column count does not match entity fields");
+
+        std::string insert_prefix;       // INSERT INTO `t` (`a`, `b`) VALUES
+        std::string row_placeholders;    // (?, ?) 单行插入占位符
+        std::string batch_placeholders;  // (?,?) 批量插入占位符
+        size_t insert_count = 0;         // 每行参数个数
+
+        StaticPlan() {
+            std::string cols;
+            for (size_t i = 0; i < field_count; ++i) {
+                if (is_skipped(i)) continue;
+                if (insert_count > 0) { cols += ", "; row_placeholders += ", "; batch_placeholders += ","; }
+                cols += "`"; cols += Desc::columns[i]; cols += "`";
+                row_placeholders += "?";
+                batch_placeholders += "?";
+                ++insert_count;
+            }
+            insert_prefix = "INSERT INTO `" + std::string(Desc::table) + "` (" + cols + ") VALUES ";
+            row_placeholders = "(" + row_placeholders + ")";
+            batch_placeholders = "(" + batch_placeholders + ")";
+        }
+
+        static constexpr bool is_skipped(size_t i) {
+            return Desc::pk_auto_increment && static_cast<int>(i) == Desc::pk_index;
+        }
+
+        static const StaticPlan& get() {
+            static const StaticPlan plan;
+            return plan;
+        }
+
+        // 按字段顺序追加插入参数
+        static void append_insert_params(const Entity& entity, std::vector<ValueVariant>& params) {
+            [&]<size_t... I>(std::index_sequence<I...>) {
+                ((is_skipped(I) ? void() : void(params.push_back(to_value_variant(boost::pfr::get<I>(entity))))), ...);
+            }(std::make_index_sequence<field_count>{});
+        }
+
+        // 按字段顺序追加借用的插入参数
+        static void append_insert_views(const Entity& entity, std::vector<ParamView>& params) {
+            [&]<size_t... I>(std::index_sequence<I...>) {
+                ((is_skipped(I) ? void() : void(params.push_back(to_param_view(boost::pfr::get<I>(entity))))), ...);
+            }(std::make_index_sequence<field_count>{});
+        }
+
+        // 插入前自动填充时间戳与版本
+        static void auto_fill_insert(Entity& entity) {
+            if constexpr (Desc::create_time_index >= 0 || Desc::update_time_index >= 0) {
+                auto now = std::chrono::system_clock::now();
+                if constexpr (Desc::create_time_index >= 0) boost::pfr::get<Desc::create_time_index>(entity) = now;
+                if constexpr (Desc::update_time_index >= 0) boost::pfr::get<Desc::update_time_index>(entity) = now;
+            }
+            if constexpr (Desc::version_index >= 0) boost::pfr::get<Desc::version_index>(entity) = 1;
+        }
+
+        // 描述符各列在结果集中的下标，-1表示结果中没有该列
+        using ColumnIndexes = std::array<int, field_count>;
+
+        static ColumnIndexes bind(const ResultSchema& schema) {
+            ColumnIndexes indexes{};
+            for (size_t i = 0; i < field_count; ++i) indexes[i] = schema.indexOf(Desc::columns[i]);
+            return indexes;
+        }
+
+        // 按预先绑定的列下标映射实体，列名与描述符一致
+        static Entity map_row(DbRowView row, const ColumnIndexes& indexes) {
+            Entity obj{};
+            for (size_t i = 0; i < field_count; ++i) {
+                if (indexes[i] >= 0) setters[i](obj, row.getValue(static_cast<size_t>(indexes[i])));
+            }
+            return obj;
+        }
+
+        // 每个字段一个直接写入函数，供映射计划按下标调用
+        using Setter = void (*)(Entity&, const ValueVariant&);
+
+        template<size_t I>
+        static void set_field(Entity& obj, const ValueVariant& value) {
+            assign_from_value(boost::pfr::get<I>(obj), value);
+        }
+
+        static constexpr std::array<Setter, field_count> setters = []<size_t... I>(std::index_sequence<I...>) {
+            return std::array<Setter, field_count>{&set_field<I>...};
+        }(std::make_index_sequence<field_count>{});
+
+        // 每个字段一个直接读取函数，供内存查询按下标调用
+        using Getter = ValueVariant (*)(const Entity&);
+
+        template<size_t I>
+        static ValueVariant get_field(const Entity& obj) {
+            return to_value_variant(boost::pfr::get<I>(obj));
+        }
+
+        static constexpr std::array<Getter, field_count> getters = []<size_t... I>(std::index_sequence<I...>) {
+            return std::array<Getter, field_count>{&get_field<I>...};
+        }(std::make_index_sequence<field_count>{});
+
+        // 按列名查找字段下标，不存在返回-1
+        static int field_index(std::string_view column) {
+            for (size_t i = 0; i < field_count; ++i) {
+                if (Desc::columns[i] == column) return static_cast<int>(i);
+            }
+            return -1;
+        }
+    };
+} // namespace internal
+
+inline void PropertyPlan::write(rttr::instance obj, const ValueVariant& value) const {
+    if (std::holds_alternative<std::monostate>(value)) return;
+    auto set = [&](auto typed) {
+        internal::assign_from_value(typed, value);
+        prop.set_value(obj, typed);
+    };
+    switch (kind) {
+        case ValueKind::Int: set(int{}); return;
+        case ValueKind::Long: set(long{}); return;
+        case ValueKind::LongLong: set(static_cast<long long>(0)); return;
+        case ValueKind::Double: set(double{}); return;
+        case ValueKind::Float: set(float{}); return;
+        case ValueKind::Char: set(char{}); return;
+        case ValueKind::String: set(std::string{}); return;
+        case ValueKind::Bool: set(bool{}); return;
+        case ValueKind::TimePoint: set(std::chrono::system_clock::time_point{}); return;
+        case ValueKind::Other: break;
+    }
+    rttr::variant var = internal::value_variant_to_rttr(value);
+    if (var.is_valid()) prop.set_value(obj, var);
+}
+
+// ========== SQL文本缓存 ==========
+// 以查询形状（字段、运算符、IN元数、排序、是否分页等）为键缓存生成好的SQL文本，
+// 命中时只需重新收集参数。容量满后淘汰最久未使用的形状。
+class SqlShapeCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;      // 命中次数
+        uint64_t misses = 0;    // 未命中次数
+        size_t entries = 0;     // 当前缓存的形状数
+        uint64_t evictions = 0; // 因容量被淘汰的形状数
+    };
+
+    static SqlShapeCache& instance() {
+        static SqlShapeCache cache;
+        return cache;
+    }
+
+    // 查找形状对应的SQL文本
+    std::optional<std::string> find(const std::string& key) {
+        if (!m_enabled.load(std::memory_order_relaxed)) return std::nullopt;
+        std::lock_guard lock(m_mutex);
+        auto it = m_index.find(key);
+        if (it == m_index.end()) {
+            ++m_misses;
+            return std::nullopt;
+        }
+        ++m_hits;
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        return it->second->second;
+    }
+
+    // 保存形状对应的SQL文本
+    void store(const std::string& key, const std::string& sql) {
+        if (!m_enabled.load(std::memory_order_relaxed)) return;
+        std::lock_guard lock(m_mutex);
+        if (m_capacity == 0 || m_index.count(key)) return;
+        m_entries.emplace_front(key, sql);
+        m_index.emplace(m_entries.front().first, m_entries.begin());
+        trim();
+    }
+
+    Stats stats() const {
+        std::lock_guard lock(m_mutex);
+        return {m_hits, m_misses, m_entries.size(), m_evictions};
+    }
+
+    void clear() {
+        std::lock_guard lock(m_mutex);
+        m_index.clear();
+        m_entries.clear();
+        m_hits = m_misses = m_evictions = 0;
+    }
+
+    void setCapacity(size_t capacity) {
+        std::lock_guard lock(m_mutex);
+        m_capacity = capacity;
+        trim();
+    }
+
+    void setEnabled(bool enabled) { m_enabled = enabled; }
+
+private:
+    using Entry = std::pair<std::string, std::string>;  // 形状键, SQL文本
+
+    SqlShapeCache() = default;
+
+    void trim() {
+        while (m_entries.size() > m_capacity) {
+            m_index.erase(m_entries.back().first);
+            m_entries.pop_back();
+            ++m_evictions;
+        }
+    }
+
+    mutable std::mutex m_mutex;
+    std::list<Entry> m_entries;  // 最近使用的在前
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> m_index;  // 键指向链表节点中的形状键
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+    uint64_t m_evictions = 0;
+    std::atomic<bool> m_enabled{true};
+    size_t m_capacity = 4096;
+};
+
+namespace internal {
+    // 形状键的字段分隔
+    inline void append_key_part(std::string& key, const std::string& part) {
+        key += part;
+        key += '\x1f';
+    }
+
+    inline void append_key_part(std::string& key, long long number) {
+        key += std::to_string(number);
+        key += '\x1f';
+    }
+} // namespace internal
+
+// ========== 表写入代数与计数缓存 ==========
+// 每张表一个单调递增的写入代数，OrmService生成写语句时递增，依赖表数据的缓存据此判断是否失效
+class TableGeneration {
+public:
+    static TableGeneration& instance() {
+        static TableGeneration registry;
+        return registry;
+    }
+
+    uint64_t current(std::string_view table) const {
+        std::lock_guard lock(m_mutex);
+        auto it = m_generations.find(table);
+        return it == m_generations.end() ? 0 : it->second;
+    }
+
+    uint64_t bump(std::string_view table) {
+        std::lock_guard lock(m_mutex);
+        auto it = m_generations.find(table);
+        if (it == m_generations.end()) it = m_generations.emplace(std::string(table), 0).first;
+        return ++it->second;
+    }
+
+private:
+    TableGeneration() = default;
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, uint64_t, internal::StringHash, std::equal_to<>> m_generations;
+};
+
+// ========== 变更事件 ==========
+// OrmService生成写语句时收集变更事件（表、操作、受影响行的主键值）并随语句携带，语句执行成功后
+// 由completeWrite发布，进程内缓存据此做定向失效；执行失败的语句不发布。交给ChangeTransaction的事件
+// 按(表, 操作)合并，提交时一次投递，回滚或未提交即析构时丢弃；
+// 每个投递的事件分配单调递增的代数，读取方比较代数即可无锁判断是否错过了变更
+
+class ChangeEventBus {
+public:
+    // 回调在发布（或提交事务）的线程中同步执行，不应抛出异常（抛出的异常被忽略）
+    using Handler = std::function<void(const ChangeEvent&)>;
+
+    // 订阅句柄，析构时退订
+    class Subscription {
+    public:
+        Subscription() = default;
+        Subscription(Subscription&& other) noexcept : m_id(std::exchange(other.m_id, 0)) {}
+        Subscription& operator=(Subscription&& other) noexcept {
+            if (this != &other) {
+                reset();
+                m_id = std::exchange(other.m_id, 0);
+            }
+            return *this;
+        }
+        Subscription(const Subscription&) = delete;
+        Subscription& operator=(const Subscription&) = delete;
+        ~Subscription() { reset(); }
+
+        void reset() {
+            if (m_id != 0) ChangeEventBus::instance().unsubscribe(m_id);
+            m_id = 0;
+        }
+
+    private:
+        friend class ChangeEventBus;
+        explicit Subscription(uint64_t id) : m_id(id) {}
+        uint64_t m_id = 0;
+    };
+
+    static ChangeEventBus& instance() {
+        static ChangeEventBus bus;
+        return bus;
+    }
+
+    // tables为空时接收全部表的事件
+    [[nodiscard]] Subscription subscribe(std::vector<std::string> tables, Handler handler) {
+        std::lock_guard lock(m_mutex);
+        const uint64_t id = ++m_next_id;
+        m_subscribers.push_back({id, std::move(tables), std::make_shared<Handler>(std::move(handler))});
+        m_count.store(m_subscribers.size(), std::memory_order_release);
+        return Subscription(id);
+    }
+
+    // 是否需要收集事件：没有订阅者时，写语句生成器跳过主键提取
+    bool active() const { return m_count.load(std::memory_order_acquire) > 0; }
+
+    // 立即投递；写语句的事件由completeWrite发布，不应在执行前调用
+    void publish(ChangeEvent event) { deliver(event); }
+
+    // 最近一次投递分配的代数
+    uint64_t generation() const { return m_generation.load(std::memory_order_acquire); }
+
+private:
+    friend class ChangeTransaction;
+
+    struct Subscriber {
+        uint64_t id;
+        std::vector<std::string> tables;
+        std::shared_ptr<Handler> handler;
+    };
+
+    ChangeEventBus() = default;
+
+    void deliver(ChangeEvent& event) {
+        std::vector<std::shared_ptr<Handler>> handlers;
+        {
+            std::lock_guard lock(m_mutex);
+            event.generation = m_generation.fetch_add(1, std::memory_order_acq_rel) + 1;
+            for (const auto& sub : m_subscribers) {
+                if (sub.tables.empty() || std::find(sub.tables.begin(), sub.tables.end(), event.table) != sub.tables.end()) {
+                    handlers.push_back(sub.handler);
+                }
+            }
+        }
+        for (const auto& handler : handlers) {
+            try {
+                (*handler)(event);
+            } catch (...) {
+            }
+        }
+    }
+
+    void unsubscribe(uint64_t id) {
+        std::lock_guard lock(m_mutex);
+        m_subscribers.erase(std::remove_if(m_subscribers.begin(), m_subscribers.end(),
+                                           [id](const Subscriber& sub) { return sub.id == id; }),
+                            m_subscribers.end());
+        m_count.store(m_subscribers.size(), std::memory_order_release);
+    }
+
+    mutable std::mutex m_mutex;
+    std::vector<Subscriber> m_subscribers;
+    uint64_t m_next_id = 0;
+    std::atomic<size_t> m_count{0};
+    std::atomic<uint64_t> m_generation{0};
+};
+
+// 变更事务：显式传给completeWrite（或DbExecutor）的事件暂存区，不依赖线程，可跨协程挂起点使用。
+// 事件按(表, 操作)合并、主键去重，commit时投递（嵌套时并入外层），rollback或未提交即析构时丢弃。
+// 提交前须等交给它的写语句全部执行完毕；外层事务须比内层存活更久
+class ChangeTransaction {
+public:
+    ChangeTransaction() = default;
+    explicit ChangeTransaction(ChangeTransaction& outer) : m_outer(&outer) {
+        std::lock_guard lock(outer.m_mutex);
+        if (outer.m_state != State::Open) throw std::logic_error("ChangeTransaction: outer transaction already finished");
+        ++outer.m_open_inner;
+    }
+    ChangeTransaction(const ChangeTransaction&) = delete;
+    ChangeTransaction& operator=(const ChangeTransaction&) = delete;
+    ~ChangeTransaction() {
+        std::lock_guard lock(m_mutex);
+        if (m_state == State::Open) finish(State::RolledBack);
+    }
+
+    // 暂存一个事件；事务已结束时抛出std::logic_error
+    void add(ChangeEvent event) {
+        std::lock_guard lock(m_mutex);
+        requireOpen("add");
+        for (auto& pending : m_events) {
+            if (pending.table == event.table && pending.op == event.op) {
+                std::move(event.keys.begin(), event.keys.end(), std::back_inserter(pending.keys));
+                pending.complete = pending.complete && event.complete;
+                return;
+            }
+        }
+        m_events.push_back(std::move(event));
+    }
+
+    // 已提交、已回滚、仍有未结束的内层事务或外层已结束时抛出std::logic_error
+    void commit() {
+        std::vector<ChangeEvent> events;
+        {
+            std::lock_guard lock(m_mutex);
+            requireOpen("commit");
+            if (m_open_inner > 0) throw std::logic_error("ChangeTransaction: commit with an unfinished inner transaction");
+            events = std::move(m_events);
+            m_events.clear();
+            for (auto& event : events) {
+                std::sort(event.keys.begin(), event.keys.end());
+                event.keys.erase(std::unique(event.keys.begin(), event.keys.end()), event.keys.end());
+                if (m_outer) m_outer->add(std::move(event));
+            }
+            finish(State::Committed);
+        }
+        if (!m_outer) {
+            for (auto& event : events) ChangeEventBus::instance().deliver(event);
+        }
+    }
+
+    void rollback() {
+        std::lock_guard lock(m_mutex);
+        requireOpen("rollback");
+        finish(State::RolledBack);
+    }
+
+    // 暂存的（合并后的）事件数
+    size_t pending() const {
+        std::lock_guard lock(m_mutex);
+        return m_events.size();
+    }
+
+private:
+    enum class State { Open, Committed, RolledBack };
+
+    void requireOpen(const char* action) const {
+        if (m_state != State::Open) throw std::logic_error(std::string("ChangeTransaction: ") + action + " after commit or rollback");
+    }
+
+    // 调用方持有m_mutex
+    void finish(State state) {
+        m_state = state;
+        m_events.clear();
+        if (m_outer) {
+            std::lock_guard lock(m_outer->m_mutex);
+            --m_outer->m_open_inner;
+        }
+    }
+
+    ChangeTransaction* m_outer = nullptr;
+    mutable std::mutex m_mutex;  // 扇出执行时多个语句可能在不同线程完成
+    State m_state = State::Open;
+    size_t m_open_inner = 0;
+    std::vector<ChangeEvent> m_events;
+};
+
+// 写语句执行成功后调用。生成写语句时已递增过一次表写入代数，但生成与执行之间开始的读取
+// 仍会读到旧数据并以新代数写入缓存，因此执行后再递增一次；随后发布变更事件，给出transaction时
+// 暂存到该事务。DbExecutor自动调用；经withConnection或其他途径执行时由调用方在语句（或所在事务）提交后调用
+inline void completeWrite(const SqlQueryResult& query, ChangeTransaction* transaction = nullptr) {
+    if (!query.effect) return;
+    TableGeneration::instance().bump(query.effect->table);
+    if (query.effect->evict) query.effect->evict(query.effect->ids);
+    if (!query.effect->change) return;
+    if (transaction) {
+        transaction->add(*query.effect->change);
+    } else {
+        ChangeEventBus::instance().publish(*query.effect->change);
+    }
+}
+
+// 语句是否执行成功无法确定时（如批量执行中途失败）调用：使缓存失效，并立即发布不带主键、
+// 标记为不完整的事件（不经事务，回滚也不丢弃），订阅方据此重新载入该表而不是按主键定向更新
+inline void abandonWrite(const SqlQueryResult& query) {
+    if (!query.effect) return;
+    TableGeneration::instance().bump(query.effect->table);
+    if (query.effect->evict) query.effect->evict(query.effect->ids);
+    if (!query.effect->change) return;
+    ChangeEvent event;
+    event.table = query.effect->change->table;
+    event.op = query.effect->change->op;
+    event.complete = false;
+    ChangeEventBus::instance().publish(std::move(event));
+}
+
+// 计数方式
+enum class CountMode {
+    Exact,        // COUNT(*)
+    Approximate   // 无过滤条件时读取information_schema中的表行数估计值
+};
+
+// 计数语句及其来源表，exact为false表示结果只是估计值
+struct CountQuery {
+    SqlQueryResult sql;
+    std::string table;
+    bool exact = true;
+};
+
+// 分页总数缓存：以计数SQL与参数为键，条目在TTL到期或表写入代数变化后失效
+class CountCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        size_t entries = 0;
+    };
+
+    // 查找结果；未命中时保留键与查询前的写入代数，执行计数后交给store
+    struct Lookup {
+        std::string key;
+        std::string table;
+        uint64_t generation = 0;
+        std::optional<long long> total;
+    };
+
+    static CountCache& instance() {
+        static CountCache cache;
+        return cache;
+    }
+
+    Lookup lookup(const CountQuery& query) {
+        Lookup result;
+        result.table = query.table;
+        result.generation = TableGeneration::instance().current(query.table);
+        result.key = query.sql.sql;
+        result.key += '\x1f';
+        for (const auto& param : query.sql.params) internal::append_value_key(result.key, param);
+        if (!m_enabled.load(std::memory_order_relaxed)) return result;
+
+        {
+            std::lock_guard lock(m_mutex);
+            auto it = m_entries.find(result.key);
+            if (it != m_entries.end()) {
+                if (it->second.generation == result.generation && std::chrono::steady_clock::now() < it->second.expires) {
+                    m_hits.fetch_add(1, std::memory_order_relaxed);
+                    result.total = it->second.total;
+                    return result;
+                }
+                m_entries.erase(it);
+            }
+        }
+        m_misses.fetch_add(1, std::memory_order_relaxed);
+        return result;
+    }
+
+    // 保存计数结果；查询期间表已被写入时不保存
+    void store(const Lookup& lookup, long long total) {
+        if (!m_enabled.load(std::memory_order_relaxed)) return;
+        if (TableGeneration::instance().current(lookup.table) != lookup.generation) return;
+        std::lock_guard lock(m_mutex);
+        const auto now = std::chrono::steady_clock::now();
+        if (m_entries.size() >= m_capacity) {
+            // 先清理过期条目，仍然已满则不再写入
+            for (auto it = m_entries.begin(); it != m_entries.end();) {
+                it = it->second.expires <= now ? m_entries.erase(it) : std::next(it);
+            }
+            if (m_entries.size() >= m_capacity) return;
+        }
+        m_entries[lookup.key] = {total, lookup.generation, now + m_ttl};
+    }
+
+    Stats stats() const {
+        std::lock_guard lock(m_mutex);
+        return {m_hits.load(std::memory_order_relaxed), m_misses.load(std::memory_order_relaxed), m_entries.size()};
+    }
+
+    void clear() {
+        std::lock_guard lock(m_mutex);
+        m_entries.clear();
+        m_hits = 0;
+        m_misses = 0;
+    }
+
+    void setTtl(std::chrono::steady_clock::duration ttl) {
+        std::lock_guard lock(m_mutex);
+        m_ttl = ttl;
+    }
+
+    void setCapacity(size_t capacity) {
+        std::lock_guard lock(m_mutex);
+        m_capacity = capacity;
+    }
+
+    void setEnabled(bool enabled) { m_enabled = enabled; }
+
+private:
+    CountCache() = default;
+
+    struct Entry {
+        long long total = 0;
+        uint64_t generation = 0;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, Entry> m_entries;
+    std::atomic<uint64_t> m_hits{0};
+    std::atomic<uint64_t> m_misses{0};
+    std::atomic<bool> m_enabled{true};
+    std::chrono::steady_clock::duration m_ttl = std::chrono::seconds(30);
+    size_t m_capacity = 1024;
+};
+
+// 查询语句及其读取的全部表，表的写入代数变化后依赖它的缓存结果失效
+struct TaggedQuery {
+    SqlQueryResult sql;
+    std::vector<std::string> tables;
+};
+
+namespace internal {
+    // 缓存结果占用内存的估计值，用于内存预算
+    template<typename T>
+    size_t estimate_result_bytes(const T&) { return sizeof(T); }
+
+    inline size_t estimate_result_bytes(const std::string& value) { return sizeof(std::string) + value.capacity(); }
+
+    inline size_t estimate_result_bytes(const ValueVariant& value) {
+        const auto* text = std::get_if<std::string>(&value);
+        return sizeof(ValueVariant) + (text ? text->capacity() : 0);
+    }
+
+    template<typename T>
+    size_t estimate_result_bytes(const std::vector<T>& values) {
+        size_t bytes = sizeof(std::vector<T>) + (values.capacity() - values.size()) * sizeof(T);
+        for (const auto& value : values) bytes += estimate_result_bytes(value);
+        return bytes;
+    }
+
+    inline size_t estimate_result_bytes(const ResultSet& rs) {
+        size_t bytes = sizeof(ResultSet);
+        for (size_t r = 0; r < rs.size(); ++r) {
+            for (size_t c = 0; c < rs.columnCount(); ++c) bytes += estimate_result_bytes(rs.getValue(r, c));
+        }
+        return bytes;
+    }
+}
+
+// 查询结果缓存：以SQL与参数为键保存映射后的结果（任意类型，共享只读），
+// 条目记录所读各表在查询前的写入代数，任一表被写入后即失效；按内存预算LRU淘汰。
+// 写语句生成时与执行成功后（completeWrite）各递增一次代数，两者之间开始的查询结果随后失效，条目不设TTL。
+// 适合读远多于写的表（菜单、角色、字典等）；带锁读取不应经过缓存
+class QueryResultCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;     // 因内存预算被淘汰
+        uint64_t invalidations = 0; // 因表写入而失效
+        size_t entries = 0;
+        size_t bytes = 0;
+
+        double hitRate() const {
+            const uint64_t total = hits + misses;
+            return total == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(total);
+        }
+    };
+
+    // 查找结果；未命中时保留键与查询前各表的写入代数，执行并映射后交给store
+    struct Lookup {
+        std::string key;
+        std::vector<std::string> tables;
+        std::vector<uint64_t> generations;
+        std::shared_ptr<const void> value;
+        const std::type_info* type = nullptr;
+
+        template<typename T>
+        std::shared_ptr<const T> get() const {
+            if (!value || *type != typeid(T)) return nullptr;
+            return std::static_pointer_cast<const T>(value);
+        }
+    };
+
+    static QueryResultCache& instance() {
+        static QueryResultCache cache;
+        return cache;
+    }
+
+    Lookup lookup(const TaggedQuery& query) {
+        Lookup result;
+        result.tables = query.tables;
+        for (const auto& table : query.tables) result.generations.push_back(TableGeneration::instance().current(table));
+        result.key = query.sql.sql;
+        result.key += '\x1f';
+        for (const auto& param : query.sql.params) internal::append_value_key(result.key, param);
+        if (!m_enabled.load(std::memory_order_relaxed)) return result;
+
+        {
+            std::lock_guard lock(m_mutex);
+            auto it = m_index.find(result.key);
+            if (it != m_index.end()) {
+                Entry& entry = *it->second;
+                if (entry.generations == result.generations) {
+                    m_entries.splice(m_entries.begin(), m_entries, it->second);
+                    ++m_hits;
+                    result.value = entry.value;
+                    result.type = entry.type;
+                    return result;
+                }
+                ++m_invalidations;
+                eraseEntry(it->second);
+            }
+            ++m_misses;
+        }
+        return result;
+    }
+
+    // 保存结果并返回共享指针；查询期间任一表被写入或单个结果超过预算时只返回不保存
+    template<typename T>
+    std::shared_ptr<const T> store(const Lookup& lookup, T value) {
+        const size_t bytes = internal::estimate_result_bytes(value) + lookup.key.size();
+        auto shared = std::make_shared<const T>(std::move(value));
+        if (!m_enabled.load(std::memory_order_relaxed)) return shared;
+        for (size_t i = 0; i < lookup.tables.size(); ++i) {
+            if (TableGeneration::instance().current(lookup.tables[i]) != lookup.generations[i]) return shared;
+        }
+
+        std::lock_guard lock(m_mutex);
+        if (bytes > m_budget) return shared;
+        auto it = m_index.find(lookup.key);
+        if (it != m_index.end()) eraseEntry(it->second);
+        while (m_bytes + bytes > m_budget && !m_entries.empty()) {
+            ++m_evictions;
+            eraseEntry(std::prev(m_entries.end()));
+        }
+        m_entries.push_front({lookup.key, lookup.generations, shared, &typeid(T), bytes});
+        m_index.emplace(m_entries.front().key, m_entries.begin());
+        m_bytes += bytes;
+        return shared;
+    }
+
+    Stats stats() const {
+        std::lock_guard lock(m_mutex);
+        return {m_hits, m_misses, m_evictions, m_invalidations, m_entries.size(), m_bytes};
+    }
+
+    void clear() {
+        std::lock_guard lock(m_mutex);
+        m_index.clear();
+        m_entries.clear();
+        m_bytes = 0;
+        m_hits = m_misses = m_evictions = m_invalidations = 0;
+    }
+
+    // 内存预算（字节），超出时淘汰最久未使用的条目
+    void setBudget(size_t bytes) {
+        std::lock_guard lock(m_mutex);
+        m_budget = bytes;
+        while (m_bytes > m_budget && !m_entries.empty()) {
+            ++m_evictions;
+            eraseEntry(std::prev(m_entries.end()));
+        }
+    }
+
+    void setEnabled(bool enabled) { m_enabled = enabled; }
+
+private:
+    QueryResultCache() = default;
+
+    struct Entry {
+        std::string key;
+        std::vector<uint64_t> generations;
+        std::shared_ptr<const void> value;
+        const std::type_info* type = nullptr;
+        size_t bytes = 0;
+    };
+
+    void eraseEntry(std::list<Entry>::iterator it) {
+        m_bytes -= it->bytes;
+        m_index.erase(it->key);
+        m_entries.erase(it);
+    }
+
+    mutable std::mutex m_mutex;
+    std::list<Entry> m_entries;  // 最近使用的在前
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> m_index;  // 键指向链表节点中的字符串
+    size_t m_bytes = 0;
+    size_t m_budget = 64 * 1024 * 1024;
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+    uint64_t m_evictions = 0;
+    uint64_t m_invalidations = 0;
+    std::atomic<bool> m_enabled{true};
+};
+
+// ========== 查询条件包装器 ==========
+template<typename Entity>
+class QueryWrapper {
+public:
+    using Condition = std::tuple<std::string, QueryOperator, std::vector<ValueVariant>>;
+    
+protected:
+    std::vector<Condition> m_conditions;
+    std::vector<std::pair<std::string, OrderDirection>> m_order_by;
+    LogicOperator m_logic_op = LogicOperator::AND;
+    int m_limit = -1;
+    int m_offset = -1;
+    std::vector<std::string> m_group_by; // 用于存储GROUP BY字段
+    std::vector<ValueVariant> m_seek_after; // 游标分页：上一页末行的排序键值
+    std::vector<std::pair<std::string, std::vector<ValueVariant>>> m_applied; // apply追加的SQL谓词及其参数
+
+    // 将任意类型转换为ValueVariant的辅助函数，常用类型直接构造，其余经rttr::variant转换
+    template<typename T>
+    static ValueVariant to_val(const T& value) {
+        if constexpr (internal::DirectValue<T>) {
+            return internal::to_value_variant(value);
+        } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+            return std::string(std::string_view(value));
+        } else {
+            rttr::variant v = value;
+            return internal::rttr_to_value_variant(v);
+        }
+    }
+
+    // 按占位符顺序收集条件参数（每个条件保存的值个数与其占位符个数一致）
+    void collectConditionParams(std::vector<ValueVariant>& params) const {
+        for (const auto& [field_name, op, values] : m_conditions) {
+            if (internal::binds_values(op)) params.insert(params.end(), values.begin(), values.end());
+        }
+        for (const auto& [predicate, values] : m_applied) params.insert(params.end(), values.begin(), values.end());
+        forEachSeekParam([&](const ValueVariant& value) { params.push_back(value); });
+    }
+
+    // 按占位符顺序借用条件参数，视图指向m_conditions中保存的值
+    void collectConditionViews(std::vector<ParamView>& params) const {
+        for (const auto& [field_name, op, values] : m_conditions) {
+            if (!internal::binds_values(op)) continue;
+            for (const auto& value : values) params.push_back(internal::borrow_param(value));
+        }
+        for (const auto& [predicate, values] : m_applied) {
+            for (const auto& value : values) params.push_back(internal::borrow_param(value));
+        }
+        forEachSeekParam([&](const ValueVariant& value) { params.push_back(internal::borrow_param(value)); });
+    }
+
+    // 分页子句的写法：Plain为单表查询（LIMIT、OFFSET各自独立），Join仅在LIMIT大于0时输出，OFFSET跟随LIMIT
+    enum class Paging { None, Plain, Join };
+
+    // 按占位符顺序遍历分页子句及其取值；LIMIT/OFFSET以参数绑定，不同页码共享同一SQL文本
+    template<typename Fn>
+    void forEachPagingClause(Paging paging, Fn&& fn) const {
+        if (paging == Paging::Plain) {
+            if (m_limit > -1) fn(" LIMIT ?", m_limit);
+            if (m_offset > -1) fn(" OFFSET ?", m_offset);
+        } else if (paging == Paging::Join && m_limit > 0) {
+            fn(" LIMIT ?", m_limit);
+            if (m_offset >= 0) fn(" OFFSET ?", m_offset);
+        }
+    }
+
+    void writePagingSql(internal::SqlWriter& sql, std::vector<ValueVariant>& params, Paging paging) const {
+        forEachPagingClause(paging, [&](const char* clause, int value) {
+            sql << clause;
+            params.emplace_back(static_cast<long long>(value));
+        });
+    }
+
+    // 排序方向是否一致（一致时游标谓词可写成行值比较）
+    bool seekUniform() const {
+        for (const auto& [field_name, dir] : m_order_by) {
+            if (dir != m_order_by.front().second) return false;
+        }
+        return true;
+    }
+
+    // 按游标谓词中的占位符顺序遍历键值
+    template<typename Fn>
+    void forEachSeekParam(Fn&& fn) const {
+        if (m_seek_after.empty()) return;
+        if (seekUniform()) {
+            for (const auto& value : m_seek_after) fn(value);
+            return;
+        }
+        for (size_t i = 0; i < m_seek_after.size(); ++i) {
+            for (size_t j = 0; j <= i; ++j) fn(m_seek_after[j]);
+        }
+    }
+
+    // 游标谓词：方向一致时为 (a, b) < (?, ?)，方向混合时展开为 (a < ?) OR (a = ? AND b > ?)
+    void writeSeekPredicate(internal::SqlWriter& sql, std::vector<ValueVariant>& params, bool raw_order_columns) const {
+        if (m_seek_after.size() != m_order_by.size()) {
+            throw std::runtime_error("Seek key count does not match ORDER BY fields");
+        }
+        const EntityPlan& plan = EntityPlan::of<Entity>();
+        auto column = [&](size_t i) -> std::string_view {
+            if (raw_order_columns) return m_order_by[i].first;
+            return plan.property(m_order_by[i].first).quoted_column;
+        };
+        auto compare = [&](size_t i) { return m_order_by[i].second == OrderDirection::ASC ? " > " : " < "; };
+
+        if (m_order_by.size() == 1) {
+            sql << column(0) << compare(0) << '?';
+        } else if (seekUniform()) {
+            sql << '(';
+            for (size_t i = 0; i < m_order_by.size(); ++i) sql << (i > 0 ? ", " : "") << column(i);
+            sql << ')' << compare(0) << '(';
+            for (size_t i = 0; i < m_order_by.size(); ++i) sql << (i > 0 ? ", ?" : "?");
+            sql << ')';
+        } else {
+            sql << '(';
+            for (size_t i = 0; i < m_order_by.size(); ++i) {
+                sql << (i > 0 ? " OR (" : "(");
+                for (size_t j = 0; j < i; ++j) sql << column(j) << " = ? AND ";
+                sql << column(i) << compare(i) << "?)";
+            }
+            sql << ')';
+        }
+        forEachSeekParam([&](const ValueVariant& value) { params.push_back(value); });
+    }
+
+    // 追加条件、排序与分页的形状键（不含参数值）
+    void appendShapeKey(std::string& key) const {
+        key += m_logic_op == LogicOperator::AND ? 'A' : 'O';
+        for (const auto& [field_name, op, values] : m_conditions) {
+            internal::append_key_part(key, field_name);
+            internal::append_key_part(key, static_cast<long long>(op));
+            internal::append_key_part(key, static_cast<long long>(values.size()));
+            if (!internal::binds_values(op)) internal::append_key_part(key, std::get<std::string>(values[0]));
+        }
+        for (const auto& [predicate, values] : m_applied) internal::append_key_part(key, predicate);
+        key += '|';
+        for (const auto& [field_name, dir] : m_order_by) {
+            internal::append_key_part(key, field_name);
+            key += dir == OrderDirection::ASC ? 'a' : 'd';
+        }
+        key += '|';
+        // 只记录分页子句是否存在（两种写法的判断条件都涵盖），取值作为参数绑定
+        internal::append_key_part(key, (m_limit > -1 ? 1 : 0) + (m_limit > 0 ? 2 : 0) + (m_offset > -1 ? 4 : 0));
+        internal::append_key_part(key, static_cast<long long>(m_seek_after.size()));
+    }
+
+    // 以语句种类与实体计划地址开头的形状键
+    std::string shapeKeyPrefix(char kind) const {
+        std::string key;
+        key.reserve(128);
+        key += kind;
+        key += std::to_string(reinterpret_cast<uintptr_t>(&EntityPlan::of<Entity>()));
+        key += '|';
+        return key;
+    }
+
+    // 查找缓存的SQL文本，命中时只收集参数
+    bool loadCachedSql(const std::string& key, SqlQueryResult& result, Paging paging = Paging::None) const {
+        auto cached = SqlShapeCache::instance().find(key);
+        if (!cached) return false;
+        result.sql = std::move(*cached);
+        collectConditionParams(result.params);
+        forEachPagingClause(paging, [&](const char*, int value) { result.params.emplace_back(static_cast<long long>(value)); });
+        return true;
+    }
+
+public:
+    QueryWrapper() = default;
+
+    // 所有条件方法
+    template<typename T> QueryWrapper& eq(const std::string& field, const T& value) { m_conditions.emplace_back(field, QueryOperator::__op_EQ, std::vector{to_val(value)}); return *this; }
+    template<typename T> QueryWrapper& ne(const std::string& field, const T& value) { m_conditions.emplace_back(field, QueryOperator::__op_NE, std::vector{to_val(value)}); return *this; }
+    template<typename T> QueryWrapper& gt(const std::string& field, const T& value) { m_conditions.emplace_back(field, QueryOperator::__op_GT, std::vector{to_val(value)}); return *this; }
+    template<typename T> QueryWrapper& ge(const std::string& field, const T& value) { m_conditions.emplace_back(field, QueryOperator::__op_GE, std::vector{to_val(value)}); return *this; }
+    template<typename T> QueryWrapper& lt(const std::string& field, const T& value) { m_conditions.emplace_back(field, QueryOperator::__op_LT, std::vector{to_val(value)}); return *this; }
+    template<typename T> QueryWrapper& le(const std::string& field, const T& value) { m_conditions.emplace_back(field, QueryOperator::__op_LE, std::vector{to_val(value)}); return *this; }
+    QueryWrapper& like(const std::string& field, const std::string& pattern) { m_conditions.emplace_back(field, QueryOperator::__op_LIKE, std::vector<ValueVariant>{to_val(pattern)}); return *this; }
+    QueryWrapper& notLike(const std::string& field, const std::string& pattern) { m_conditions.emplace_back(field, QueryOperator::__op_NOT_LIKE, std::vector<ValueVariant>{to_val(pattern)}); return *this; }
+    QueryWrapper& isNull(const std::string& field) { m_conditions.emplace_back(field, QueryOperator::__op_IS_NULL, std::vector<ValueVariant>{}); return *this; }
+    QueryWrapper& isNotNull(const std::string& field) { m_conditions.emplace_back(field, QueryOperator::__op_IS_NOT_NULL, std::vector<ValueVariant>{}); return *this; }
+
+    template<typename T>
+    QueryWrapper& in(const std::string& field, const std::vector<T>& values) {
+        std::vector<ValueVariant> variants;
+        std::transform(values.begin(), values.end(), std::back_inserter(variants), [](const T& v){ return to_val(v); });
+        internal::normalize_in_values(variants);
+        m_conditions.emplace_back(field, QueryOperator::__op_IN, variants);
+        return *this;
+    }
+
+    template<typename T>
+    QueryWrapper& notIn(const std::string& field, const std::vector<T>& values) {
+        std::vector<ValueVariant> variants;
+        std::transform(values.begin(), values.end(), std::back_inserter(variants), [](const T& v){ return to_val(v); });
+        internal::normalize_in_values(variants);
+        m_conditions.emplace_back(field, QueryOperator::__op_NOT_IN, variants);
+        return *this;
+    }
+
+    // 子查询条件：field IN (subquery)，子查询中不能含占位符
+    QueryWrapper& inSubquery(const std::string& field, const std::string& subquery) {
+        m_conditions.emplace_back(field, QueryOperator::__op_IN_SUBQUERY, std::vector<ValueVariant>{subquery});
+        return *this;
+    }
+
+    QueryWrapper& notInSubquery(const std::string& field, const std::string& subquery) {
+        m_conditions.emplace_back(field, QueryOperator::__op_NOT_IN_SUBQUERY, std::vector<ValueVariant>{subquery});
+        return *this;
+    }
+
+    // 追加SQL谓词（可含占位符，params与之一一对应），与其余条件整体以AND连接，不受or_()影响；
+    // 谓词原样写入，列名由调用方给出（JOIN查询可带表别名），数据权限等强制过滤使用
+    QueryWrapper& apply(std::string predicate, std::vector<ValueVariant> params = {}) {
+        m_applied.emplace_back(std::move(predicate), std::move(params));
+        return *this;
+    }
+
+    // 改写第index个条件：替换取值或改为子查询（大IN列表拆分、临时表改写使用）
+    QueryWrapper& setConditionValues(size_t index, std::vector<ValueVariant> values) {
+        std::get<2>(m_conditions.at(index)) = std::move(values);
+        return *this;
+    }
+
+    QueryWrapper& setConditionSubquery(size_t index, const std::string& subquery) {
+        auto& [field_name, op, values] = m_conditions.at(index);
+        op = (op == QueryOperator::__op_NOT_IN || op == QueryOperator::__op_NOT_IN_SUBQUERY)
+            ? QueryOperator::__op_NOT_IN_SUBQUERY : QueryOperator::__op_IN_SUBQUERY;
+        values = {subquery};
+        return *this;
+    }
+
+    template<typename T1, typename T2>
+    QueryWrapper& between(const std::string& field, const T1& start, const T2& end) {
+        m_conditions.emplace_back(field, QueryOperator::__op_BETWEEN, std::vector{to_val(start), to_val(end)});
+        return *this;
+    }
+
+    template<typename T1, typename T2>
+    QueryWrapper& notBetween(const std::string& field, const T1& start, const T2& end) {
+        m_conditions.emplace_back(field, QueryOperator::__op_NOT_BETWEEN, std::vector{to_val(start), to_val(end)});
+        return *this;
+    }
+
+    // 逻辑与排序
+    QueryWrapper& and_() { m_logic_op = LogicOperator::AND; return *this; }
     QueryWrapper& or_() { m_logic_op = LogicOperator::OR; return *this; }
     QueryWrapper& orderBy(const std::string& field, OrderDirection dir = OrderDirection::ASC) { m_order_by.emplace_back(field, dir); return *this; }
     
@@ -371,21 +2271,46 @@ public:
     QueryWrapper& limit(int count) { m_limit = count; return *this; }
     QueryWrapper& offset(int start) { m_offset = start; return *this; }
 
+    // 游标分页：只返回排序位置在给定键值之后的行，键值与orderBy字段一一对应
+    QueryWrapper& seekAfter(std::vector<ValueVariant> keys) { m_seek_after = std::move(keys); return *this; }
+
+    const std::vector<std::pair<std::string, OrderDirection>>& orderFields() const { return m_order_by; }
+
+    bool hasConditions() const { return !m_conditions.empty() || !m_applied.empty() || !m_seek_after.empty(); }
+
+    // 条件与分页的只读访问，供内存查询等非SQL执行方式使用
+    const std::vector<Condition>& conditions() const { return m_conditions; }
+    LogicOperator logicOperator() const { return m_logic_op; }
+    int limitValue() const { return m_limit; }
+    int offsetValue() const { return m_offset; }
+    const std::vector<ValueVariant>& seekKeys() const { return m_seek_after; }
+    const std::vector<std::pair<std::string, std::vector<ValueVariant>>>& appliedPredicates() const { return m_applied; }
+
     // SQL生成
     std::pair<std::string, std::vector<ValueVariant>> generateConditionSql() const {
-        std::stringstream sql;
+        if (!hasConditions()) return {"", {}};
+        internal::SqlWriter sql;
         std::vector<ValueVariant> params;
-        if (m_conditions.empty()) return {"", {}};
+        writeConditionSql(sql, params);
+        return {sql.str(), params};
+    }
+
+protected:
+    // 将WHERE子句写入sql并追加参数，无条件时不写入；raw_order_columns为true时游标谓词直接使用排序字段原文
+    void writeConditionSql(internal::SqlWriter& sql, std::vector<ValueVariant>& params, bool raw_order_columns = false) const {
+        const bool seek = !m_seek_after.empty();
+        if (!hasConditions()) return;
 
         sql << " WHERE ";
-        rttr::type t = rttr::type::get<Entity>();
+        const EntityPlan& plan = EntityPlan::of<Entity>();
+        const bool grouped = (seek || !m_applied.empty()) && m_logic_op == LogicOperator::OR && m_conditions.size() > 1;
+        if (grouped) sql << '(';
 
         for (size_t i = 0; i < m_conditions.size(); ++i) {
             if (i > 0) sql << (m_logic_op == LogicOperator::AND ? " AND " : " OR ");
 
             const auto& [field_name, op, values] = m_conditions[i];
-            std::string col_name = internal::get_column_name(internal::get_prop(t, field_name));
-            sql << "`" << col_name << "`";
+            sql << plan.property(field_name).quoted_column;
 
             switch (op) {
                 case QueryOperator::__op_EQ: sql << " = ?"; params.push_back(values[0]); break;
@@ -409,40 +2334,118 @@ public:
                     }
                     sql << ")";
                     break;
+                case QueryOperator::__op_IN_SUBQUERY:
+                case QueryOperator::__op_NOT_IN_SUBQUERY:
+                    sql << (op == QueryOperator::__op_IN_SUBQUERY ? " IN (" : " NOT IN (")
+                        << std::get<std::string>(values[0]) << ")";
+                    break;
             }
         }
-        return {sql.str(), params};
+
+        if (grouped) sql << ')';
+        bool first = m_conditions.empty();
+        for (const auto& [predicate, values] : m_applied) {
+            if (!first) sql << " AND ";
+            sql << '(' << predicate << ')';
+            params.insert(params.end(), values.begin(), values.end());
+            first = false;
+        }
+        if (seek) {
+            if (!first) sql << " AND ";
+            writeSeekPredicate(sql, params, raw_order_columns);
+        }
     }
 
+public:
     SqlQueryResult getSelectSql(const std::vector<std::string>& select_cols = {"*"}) const {
-        std::stringstream sql;
+        std::string key = selectShapeKey(select_cols);
+        SqlQueryResult result;
+        if (loadCachedSql(key, result, Paging::Plain)) return result;
+        result = buildSelectSql(select_cols);
+        SqlShapeCache::instance().store(key, result.sql);
+        return result;
+    }
+
+    SqlQueryResult getCountSql() const {
+        std::string key = countShapeKey();
+        SqlQueryResult result;
+        if (loadCachedSql(key, result)) return result;
+        result = buildCountSql();
+        SqlShapeCache::instance().store(key, result.sql);
+        return result;
+    }
+
+    // 借用参数版本：参数引用包装器内的条件值，包装器须比返回值存活更久
+    SqlQueryView getSelectSqlView(const std::vector<std::string>& select_cols = {"*"}) const {
+        std::string key = selectShapeKey(select_cols);
+        SqlQueryView view;
+        if (auto cached = SqlShapeCache::instance().find(key)) {
+            view.sql = std::move(*cached);
+        } else {
+            view.sql = buildSelectSql(select_cols).sql;
+            SqlShapeCache::instance().store(key, view.sql);
+        }
+        collectConditionViews(view.params);
+        forEachPagingClause(Paging::Plain, [&](const char*, int value) { view.params.emplace_back(static_cast<long long>(value)); });
+        return view;
+    }
+
+    SqlQueryView getCountSqlView() const {
+        std::string key = countShapeKey();
+        SqlQueryView view;
+        if (auto cached = SqlShapeCache::instance().find(key)) {
+            view.sql = std::move(*cached);
+        } else {
+            view.sql = buildCountSql().sql;
+            SqlShapeCache::instance().store(key, view.sql);
+        }
+        collectConditionViews(view.params);
+        return view;
+    }
+
+private:
+    std::string selectShapeKey(const std::vector<std::string>& select_cols) const {
+        std::string key = shapeKeyPrefix('S');
+        for (const auto& col : select_cols) internal::append_key_part(key, col);
+        appendShapeKey(key);
+        return key;
+    }
+
+    std::string countShapeKey() const {
+        std::string key = shapeKeyPrefix('C');
+        appendShapeKey(key);
+        return key;
+    }
+
+    SqlQueryResult buildSelectSql(const std::vector<std::string>& select_cols) const {
+        internal::SqlWriter sql;
+        std::vector<ValueVariant> params;
         sql << "SELECT ";
         for(size_t i = 0; i < select_cols.size(); ++i) {
             sql << (i > 0 ? "," : "") << select_cols[i];
         }
-        sql << " FROM `" << internal::get_table_name(rttr::type::get<Entity>()) << "`";
+        const EntityPlan& plan = EntityPlan::of<Entity>();
+        sql << " FROM " << plan.quoted_table;
 
-        auto [cond_sql, params] = generateConditionSql();
-        sql << cond_sql;
+        writeConditionSql(sql, params);
 
         if (!m_order_by.empty()) {
             sql << " ORDER BY ";
             for (size_t i = 0; i < m_order_by.size(); ++i) {
                 if (i > 0) sql << ", ";
-                sql << "`" << internal::get_column_name(internal::get_prop(rttr::type::get<Entity>(), m_order_by[i].first)) << "`"
+                sql << plan.property(m_order_by[i].first).quoted_column
                     << (m_order_by[i].second == OrderDirection::ASC ? " ASC" : " DESC");
             }
         }
-        if (m_limit > -1) sql << " LIMIT " << m_limit;
-        if (m_offset > -1) sql << " OFFSET " << m_offset;
+        writePagingSql(sql, params, Paging::Plain);
         return {sql.str(), params};
     }
 
-    SqlQueryResult getCountSql() const {
-        std::stringstream sql;
-        sql << "SELECT COUNT(*) FROM `" << internal::get_table_name(rttr::type::get<Entity>()) << "`";
-        auto [cond_sql, params] = generateConditionSql();
-        sql << cond_sql;
+    SqlQueryResult buildCountSql() const {
+        internal::SqlWriter sql;
+        std::vector<ValueVariant> params;
+        sql << "SELECT COUNT(*) FROM " << EntityPlan::of<Entity>().quoted_table;
+        writeConditionSql(sql, params);
         return {sql.str(), params};
     }
 };
@@ -479,8 +2482,7 @@ public:
     // 添加INNER JOIN
     template<typename JoinEntity>
     JoinQueryWrapper& innerJoin(const std::string& alias) {
-        rttr::type t = rttr::type::get<JoinEntity>();
-        std::string tableName = internal::get_table_name(t);
+        const std::string& tableName = EntityPlan::of<JoinEntity>().table_name;
         m_joins.push_back({
             "INNER JOIN", 
             tableName, 
@@ -493,8 +2495,7 @@ public:
     // 添加LEFT JOIN
     template<typename JoinEntity>
     JoinQueryWrapper& leftJoin(const std::string& alias) {
-        rttr::type t = rttr::type::get<JoinEntity>();
-        std::string tableName = internal::get_table_name(t);
+        const std::string& tableName = EntityPlan::of<JoinEntity>().table_name;
         m_joins.push_back({
             "LEFT JOIN", 
             tableName, 
@@ -507,8 +2508,7 @@ public:
     // 添加RIGHT JOIN
     template<typename JoinEntity>
     JoinQueryWrapper& rightJoin(const std::string& alias) {
-        rttr::type t = rttr::type::get<JoinEntity>();
-        std::string tableName = internal::get_table_name(t);
+        const std::string& tableName = EntityPlan::of<JoinEntity>().table_name;
         m_joins.push_back({
             "RIGHT JOIN", 
             tableName, 
@@ -531,6 +2531,18 @@ public:
         m_selectColumns = columns;
         return *this;
     }
+
+    const std::vector<std::string>& selectColumns() const { return m_selectColumns; }
+    const std::string& mainAlias() const { return m_mainTableAlias; }
+
+    // 查询读取的全部表：主表与各连接表（去重）
+    std::vector<std::string> tables() const {
+        std::vector<std::string> result{EntityPlan::of<MainEntity>().table_name};
+        for (const auto& join : m_joins) {
+            if (std::find(result.begin(), result.end(), join.tableName) == result.end()) result.push_back(join.tableName);
+        }
+        return result;
+    }
     
     // 添加分组条件
     JoinQueryWrapper& groupBy(const std::string& field) {
@@ -552,9 +2564,50 @@ public:
     
     // 生成JOIN SQL
     SqlQueryResult getJoinSql() const {
-        std::string mainTable = internal::get_table_name(rttr::type::get<MainEntity>());
+        std::string key = joinShapeKey('J');
+        SqlQueryResult result;
+        if (this->loadCachedSql(key, result, QueryWrapper<MainEntity>::Paging::Join)) return result;
+        result = buildJoinSql();
+        SqlShapeCache::instance().store(key, result.sql);
+        return result;
+    }
+    
+    // 生成JOIN计数SQL
+    SqlQueryResult getJoinCountSql() const {
+        std::string key = joinShapeKey('K');
+        SqlQueryResult result;
+        if (this->loadCachedSql(key, result)) return result;
+        result = buildJoinCountSql();
+        SqlShapeCache::instance().store(key, result.sql);
+        return result;
+    }
+
+private:
+    // JOIN查询的形状键：主表别名、连接、查询列、分组与HAVING，再加上基类的条件形状
+    std::string joinShapeKey(char kind) const {
+        std::string key = this->shapeKeyPrefix(kind);
+        internal::append_key_part(key, m_mainTableAlias);
+        for (const auto& join : m_joins) {
+            internal::append_key_part(key, join.joinType);
+            internal::append_key_part(key, join.tableName);
+            internal::append_key_part(key, join.tableAlias);
+            internal::append_key_part(key, join.onCondition);
+        }
+        key += '|';
+        for (const auto& col : m_selectColumns) internal::append_key_part(key, col);
+        key += '|';
+        for (const auto& field : m_groupByFields) internal::append_key_part(key, field);
+        key += '|';
+        internal::append_key_part(key, m_having);
+        this->appendShapeKey(key);
+        return key;
+    }
+
+    SqlQueryResult buildJoinSql() const {
+        const std::string& mainTable = EntityPlan::of<MainEntity>().table_name;
         
-        std::stringstream sql;
+        internal::SqlWriter sql;
+        std::vector<ValueVariant> params;
         
         // 构建SELECT子句
         sql << "SELECT ";
@@ -577,10 +2630,7 @@ public:
         }
         
         // WHERE条件
-        auto [whereSql, params] = this->generateConditionSql();
-        if (!whereSql.empty()) {
-            sql << whereSql;
-        }
+        this->writeConditionSql(sql, params, true);
         
         // GROUP BY子句
         if (!m_groupByFields.empty()) {
@@ -607,21 +2657,16 @@ public:
         }
         
         // LIMIT和OFFSET子句
-        if (this->m_limit > 0) {
-            sql << " LIMIT " << this->m_limit;
-            if (this->m_offset >= 0) {
-                sql << " OFFSET " << this->m_offset;
-            }
-        }
+        this->writePagingSql(sql, params, QueryWrapper<MainEntity>::Paging::Join);
         
         return {sql.str(), params};
     }
     
-    // 生成JOIN计数SQL
-    SqlQueryResult getJoinCountSql() const {
-        std::string mainTable = internal::get_table_name(rttr::type::get<MainEntity>());
+    SqlQueryResult buildJoinCountSql() const {
+        const std::string& mainTable = EntityPlan::of<MainEntity>().table_name;
         
-        std::stringstream sql;
+        internal::SqlWriter sql;
+        std::vector<ValueVariant> params;
         
         // 构建COUNT查询
         sql << "SELECT COUNT(*) FROM `" << mainTable << "` " << m_mainTableAlias;
@@ -633,10 +2678,7 @@ public:
         }
         
         // WHERE条件
-        auto [whereSql, params] = this->generateConditionSql();
-        if (!whereSql.empty()) {
-            sql << whereSql;
-        }
+        this->writeConditionSql(sql, params, true);
         
         return {sql.str(), params};
     }
@@ -664,18 +2706,17 @@ public:
     // 添加实体映射
     template<typename EntityType>
     JoinResultMapper& addEntityMapping(const std::string& prefix) {
-        rttr::type entityType = rttr::type::get<EntityType>();
+        const EntityPlan& plan = EntityPlan::of<EntityType>();
         EntityMappings entityMappings;
         
-        for (auto& prop : entityType.get_properties()) {
-            std::string columnName = internal::get_column_name(prop);
+        for (const auto& p : plan.props) {
             entityMappings.push_back({
-                prefix + "." + columnName,
-                prop.get_name().to_string()
+                prefix + "." + p.column,
+                p.name
             });
         }
         
-        mappings[entityType] = std::move(entityMappings);
+        mappings[plan.type] = std::move(entityMappings);
         return *this;
     }
     
@@ -691,332 +2732,1214 @@ public:
         return *this;
     }
     
+    // 预编译的映射计划：结果列下标 -> 类型化的写入函数，按行执行时不再做字符串查找
+    template<typename T>
+    struct MappingPlan {
+        struct Step {
+            size_t column;                                  // 结果列下标
+            void (*field_setter)(T&, const ValueVariant&);  // 静态实体的字段写入函数
+            const PropertyPlan* prop;                       // 非静态实体的RTTR属性
+        };
+        std::vector<Step> steps;
+
+        void apply(T& obj, DbRowView row) const {
+            for (const auto& step : steps) {
+                const ValueVariant& value = row.getValue(step.column);
+                if (step.field_setter) {
+                    step.field_setter(obj, value);
+                } else {
+                    step.prop->write(obj, value);
+                }
+            }
+        }
+
+        T map(DbRowView row) const {
+            T obj{};
+            apply(obj, row);
+            return obj;
+        }
+    };
+
+    // 将类型T的映射规则绑定到结果集列结构，跳过不存在的列和属性
+    template<typename T>
+    MappingPlan<T> bindPlan(const ResultSchema& schema) const {
+        const EntityPlan& plan = EntityPlan::of<T>();
+        auto it = mappings.find(plan.type);
+        if (it == mappings.end()) {
+            throw std::runtime_error("No mapping defined for type: " + std::string(plan.type.get_name()));
+        }
+
+        MappingPlan<T> mappingPlan;
+        mappingPlan.steps.reserve(it->second.size());
+        for (const auto& mapping : it->second) {
+            int column = schema.indexOf(mapping.columnPrefix);
+            if (column < 0) continue;  // 跳过不存在的列
+            int propIndex = plan.indexOf(mapping.propertyName);
+            if (propIndex < 0) continue;  // 跳过不存在的属性
+
+            typename MappingPlan<T>::Step step{static_cast<size_t>(column), nullptr, &plan.props[propIndex]};
+            if constexpr (PfrEntity<T>) {
+                int field = internal::StaticPlan<T>::field_index(plan.props[propIndex].column);
+                if (field >= 0) {
+                    step.field_setter = internal::StaticPlan<T>::setters[field];
+                    step.prop = nullptr;
+                }
+            }
+            mappingPlan.steps.push_back(step);
+        }
+        return mappingPlan;
+    }
+
     // 从结果集映射单个对象
     template<typename T>
-    T mapToObject(const DbRow& row) const {
-        T obj;
-        rttr::type objType = rttr::type::get<T>();
+    T mapToObject(DbRowView row) const {
+        return bindPlan<T>(row.rowSchema()).map(row);
+    }
+    
+    // 从结果集映射到对象列表
+    template<typename T>
+    std::vector<T> mapToObjects(const ResultSet& resultSet) const {
+        std::vector<T> objects;
+        objects.reserve(resultSet.size());
         
-        auto it = mappings.find(objType);
-        if (it == mappings.end()) {
-            throw std::runtime_error("No mapping defined for type: " + std::string(objType.get_name()));
+        const auto plan = bindPlan<T>(resultSet.schema());
+        for (const auto& row : resultSet) {
+            objects.push_back(plan.map(row));
+        }
+        
+        return objects;
+    }
+    
+    // 映射连表查询结果到多个不同类型的对象
+    template<typename... Entities>
+    std::vector<std::tuple<Entities...>> mapToTuples(const ResultSet& resultSet) const {
+        std::vector<std::tuple<Entities...>> tuples;
+        tuples.reserve(resultSet.size());
+        
+        const std::tuple<MappingPlan<Entities>...> plans{bindPlan<Entities>(resultSet.schema())...};
+        for (const auto& row : resultSet) {
+            tuples.push_back(std::apply([&row](const auto&... plan) {
+                return std::tuple<Entities...>{plan.map(row)...};
+            }, plans));
+        }
+        
+        return tuples;
+    }
+};
+
+// ========== 脏字段跟踪 ==========
+// 加载后记录各属性的快照，OrmService::updateChanged只为发生变化的列生成UPDATE
+template<typename Entity>
+class Tracked {
+private:
+    Entity m_entity;
+    std::vector<ValueVariant> m_snapshot;  // 按实体计划属性顺序保存的原始值
+
+public:
+    explicit Tracked(Entity entity) : m_entity(std::move(entity)) {
+        markClean();
+    }
+
+    Entity& get() { return m_entity; }
+    const Entity& get() const { return m_entity; }
+    Entity* operator->() { return &m_entity; }
+    const Entity* operator->() const { return &m_entity; }
+    Entity& operator*() { return m_entity; }
+    const Entity& operator*() const { return m_entity; }
+
+    const std::vector<ValueVariant>& snapshot() const { return m_snapshot; }
+
+    // 与快照不同的属性下标，按实体计划顺序排列
+    std::vector<size_t> changedIndexes() const {
+        const EntityPlan& plan = EntityPlan::of<Entity>();
+        std::vector<size_t> changed;
+        for (size_t i = 0; i < plan.props.size(); ++i) {
+            if (plan.props[i].read(m_entity) != m_snapshot[i]) changed.push_back(i);
+        }
+        return changed;
+    }
+
+    // 发生变化的属性名，按实体计划顺序排列
+    std::vector<std::string> changedFields() const {
+        const EntityPlan& plan = EntityPlan::of<Entity>();
+        std::vector<std::string> fields;
+        for (size_t idx : changedIndexes()) fields.push_back(plan.props[idx].name);
+        return fields;
+    }
+
+    bool isDirty() const {
+        const EntityPlan& plan = EntityPlan::of<Entity>();
+        for (size_t i = 0; i < plan.props.size(); ++i) {
+            if (plan.props[i].read(m_entity) != m_snapshot[i]) return true;
+        }
+        return false;
+    }
+
+    // 以当前状态作为新的快照（加载后或更新语句执行成功后调用）
+    void markClean() {
+        const EntityPlan& plan = EntityPlan::of<Entity>();
+        m_snapshot.clear();
+        m_snapshot.reserve(plan.props.size());
+        for (const auto& p : plan.props) m_snapshot.push_back(p.read(m_entity));
+    }
+};
+
+// ========== 实体缓存 ==========
+
+namespace internal {
+    // 主键缓存键：整数主键统一按long long编码，getById(int)与实体中读出的主键命中同一条目
+    inline std::string entity_cache_key(const ValueVariant& id) {
+        std::string key;
+        if (std::holds_alternative<int>(id) || std::holds_alternative<long>(id)) {
+            append_value_key(key, value_to_long_long(id));
+        } else {
+            append_value_key(key, id);
+        }
+        return key;
+    }
+}
+
+// 请求级标识映射：同一请求内按主键重复加载的实体只查询一次；非线程安全，随请求创建与销毁。
+// 请求内对实体的写操作后应调用forget
+class IdentityMap {
+public:
+    template<typename Entity>
+    std::shared_ptr<const Entity> find(const ValueVariant& id) const {
+        auto it = m_entries.find(key<Entity>(id));
+        if (it == m_entries.end()) return nullptr;
+        return std::static_pointer_cast<const Entity>(it->second);
+    }
+
+    template<typename Entity>
+    void put(const ValueVariant& id, std::shared_ptr<const Entity> entity) {
+        m_entries[key<Entity>(id)] = std::move(entity);
+    }
+
+    template<typename Entity>
+    void forget(const ValueVariant& id) {
+        m_entries.erase(key<Entity>(id));
+    }
+
+    size_t size() const { return m_entries.size(); }
+    void clear() { m_entries.clear(); }
+
+private:
+    template<typename Entity>
+    static std::string key(const ValueVariant& id) {
+        return std::to_string(reinterpret_cast<uintptr_t>(&EntityPlan::of<Entity>())) + '|' + internal::entity_cache_key(id);
+    }
+
+    std::unordered_map<std::string, std::shared_ptr<const void>> m_entries;
+};
+
+// 二级实体缓存：进程内共享，按主键分片加锁，默认关闭，按实体类型用setEnabled开启。
+// OrmService按主键生成的更新、删除语句会留下失效标记（带序号），查询开始后发生的写入使该次查询结果不被保存；
+// 语句执行成功后（completeWrite）再留一次标记，生成与执行之间开始的查询读到的旧行随之失效；
+// 启用乐观锁版本的实体不会被较旧版本覆盖，读取时也可要求不低于已知版本
+template<typename Entity>
+class EntityCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t stale = 0;          // 因版本过旧被拒绝
+        uint64_t invalidations = 0;
+    };
+
+    // 查找结果；未命中时保留键与查询前的序号，加载后交给store
+    struct Lookup {
+        std::string key;
+        uint64_t sequence = 0;
+        std::shared_ptr<const Entity> entity;
+    };
+
+    static EntityCache& instance() {
+        static EntityCache cache;
+        return cache;
+    }
+
+    Lookup lookup(const ValueVariant& id, long long min_version = -1) {
+        Lookup result;
+        result.key = internal::entity_cache_key(id);
+        result.sequence = m_sequence.load(std::memory_order_acquire);
+        if (!m_enabled.load(std::memory_order_relaxed)) return result;
+
+        Shard& shard = shardOf(result.key);
+        {
+            std::lock_guard lock(shard.mutex);
+            auto it = shard.slots.find(result.key);
+            if (it != shard.slots.end() && it->second.entity) {
+                if (min_version < 0 || it->second.version >= min_version) {
+                    m_hits.fetch_add(1, std::memory_order_relaxed);
+                    result.entity = it->second.entity;
+                    return result;
+                }
+                m_stale.fetch_add(1, std::memory_order_relaxed);
+                shard.slots.erase(it);
+            }
+        }
+        m_misses.fetch_add(1, std::memory_order_relaxed);
+        return result;
+    }
+
+    // 保存加载到的实体并返回共享指针；查询开始后该主键被写入，或已缓存更新版本时不保存
+    std::shared_ptr<const Entity> store(const Lookup& lookup, Entity entity) {
+        auto shared = std::make_shared<const Entity>(std::move(entity));
+        if (!m_enabled.load(std::memory_order_relaxed)) return shared;
+        const long long version = versionOf(*shared);
+
+        Shard& shard = shardOf(lookup.key);
+        std::lock_guard lock(shard.mutex);
+        if (lookup.sequence < shard.floor) return shared;
+        auto it = shard.slots.find(lookup.key);
+        if (it != shard.slots.end()) {
+            const Slot& slot = it->second;
+            if (!slot.entity && slot.sequence > lookup.sequence) return shared;
+            if (slot.entity && slot.version > version) {
+                m_stale.fetch_add(1, std::memory_order_relaxed);
+                return shared;
+            }
+        } else {
+            makeRoom(shard);
+        }
+        shard.slots[lookup.key] = {shared, version, lookup.sequence};
+        return shared;
+    }
+
+    // 主键对应的行已被写入：留下失效标记
+    void invalidate(const ValueVariant& id) {
+        if (!m_enabled.load(std::memory_order_relaxed)) return;
+        const std::string key = internal::entity_cache_key(id);
+        const uint64_t sequence = m_sequence.fetch_add(1, std::memory_order_acq_rel) + 1;
+        Shard& shard = shardOf(key);
+        std::lock_guard lock(shard.mutex);
+        auto it = shard.slots.find(key);
+        if (it == shard.slots.end()) makeRoom(shard);
+        shard.slots[key] = {nullptr, -1, sequence};
+        m_invalidations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 清空全部条目，进行中的查询结果不再保存
+    void clear() {
+        const uint64_t sequence = m_sequence.fetch_add(1, std::memory_order_acq_rel) + 1;
+        for (Shard& shard : m_shards) {
+            std::lock_guard lock(shard.mutex);
+            shard.slots.clear();
+            shard.floor = sequence;
+        }
+    }
+
+    Stats stats() const {
+        return {m_hits.load(std::memory_order_relaxed), m_misses.load(std::memory_order_relaxed),
+                m_stale.load(std::memory_order_relaxed), m_invalidations.load(std::memory_order_relaxed)};
+    }
+
+    size_t size() const {
+        size_t total = 0;
+        for (const Shard& shard : m_shards) {
+            std::lock_guard lock(shard.mutex);
+            for (const auto& [key, slot] : shard.slots) total += slot.entity ? 1 : 0;
+        }
+        return total;
+    }
+
+    void setEnabled(bool enabled) {
+        if (!enabled) clear();
+        m_enabled = enabled;
+    }
+
+    bool enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    // 每个分片的条目上限（含失效标记）
+    void setShardCapacity(size_t capacity) { m_shard_capacity = std::max<size_t>(1, capacity); }
+
+private:
+    static constexpr size_t SHARD_COUNT = 16;
+
+    struct Slot {
+        std::shared_ptr<const Entity> entity;  // 为空表示失效标记
+        long long version = -1;
+        uint64_t sequence = 0;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, Slot> slots;
+        uint64_t floor = 0;  // 早于该序号开始的查询结果不再保存（被淘汰的失效标记）
+    };
+
+    EntityCache() = default;
+
+    Shard& shardOf(const std::string& key) { return m_shards[std::hash<std::string>{}(key) % SHARD_COUNT]; }
+
+    // 分片已满时淘汰任意一个条目；淘汰失效标记时提高floor，保证其效果不丢失
+    void makeRoom(Shard& shard) {
+        if (shard.slots.size() < m_shard_capacity) return;
+        auto victim = shard.slots.begin();
+        if (!victim->second.entity) shard.floor = std::max(shard.floor, victim->second.sequence);
+        shard.slots.erase(victim);
+    }
+
+    static long long versionOf(const Entity& entity) {
+        const EntityPlan& plan = EntityPlan::of<Entity>();
+        if (!plan.use_version || plan.version_index < 0) return -1;
+        return internal::value_to_long_long(plan.props[plan.version_index].read(entity));
+    }
+
+    std::array<Shard, SHARD_COUNT> m_shards;
+    std::atomic<uint64_t> m_sequence{0};
+    std::atomic<uint64_t> m_hits{0};
+    std::atomic<uint64_t> m_misses{0};
+    std::atomic<uint64_t> m_stale{0};
+    std::atomic<uint64_t> m_invalidations{0};
+    std::atomic<bool> m_enabled{false};
+    std::atomic<size_t> m_shard_capacity{1024};
+};
+
+// ========== 大IN列表执行计划 ==========
+// Single：queries中只有一条语句；Split：queries中每条语句覆盖一段取值，结果需经mergeSplitResults合并；
+// TempTable：setup、queries、cleanup须在同一连接上依次执行（临时表仅对当前会话可见）
+struct InListPlan {
+    enum class Kind { Single, Split, TempTable };
+    Kind kind = Kind::Single;
+    std::vector<SqlQueryResult> setup;
+    std::vector<SqlQueryResult> queries;
+    std::vector<SqlQueryResult> cleanup;
+};
+
+namespace internal {
+    // 临时表取值列的类型，按取值的实际类型确定
+    inline const char* in_table_column_type(const ValueVariant& value) {
+        switch (value.index()) {
+            case 4: return "DOUBLE";
+            case 5: return "VARCHAR(768)";
+            case 6: return "TINYINT(1)";
+            case 7: return "DATETIME(6)";
+            default: return "BIGINT";
+        }
+    }
+}
+
+// ========== ORM服务类 ==========
+template<typename Entity>
+class OrmService {
+private:
+    // 自动填充时间戳和版本号
+    static void auto_fill_insert(Entity& entity) {
+        const EntityPlan& plan = EntityPlan::of<Entity>();
+        auto now = std::chrono::system_clock::now();
+        if (plan.create_time_index >= 0) plan.props[plan.create_time_index].prop.set_value(entity, now);
+        if (plan.update_time_index >= 0) plan.props[plan.update_time_index].prop.set_value(entity, now);
+        if (plan.use_version && plan.version_index >= 0) plan.props[plan.version_index].prop.set_value(entity, 1);
+    }
+
+    // 批量插入或更新的自动填充：更新时间总是刷新；创建时间只在未设置时填充（冲突时数据库保留原值）；
+    // 版本号未设置（<=0）视为新行取1，否则取原值加1，与冲突分支的 version = version + 1 结果一致
+    static void auto_fill_upsert(Entity& entity, std::chrono::system_clock::time_point now) {
+        const EntityPlan& plan = EntityPlan::of<Entity>();
+        if (plan.update_time_index >= 0) plan.props[plan.update_time_index].write(entity, now);
+        if (plan.create_time_index >= 0) {
+            const PropertyPlan& cp = plan.props[plan.create_time_index];
+            const ValueVariant created = cp.read(entity);
+            const auto* time = std::get_if<std::chrono::system_clock::time_point>(&created);
+            if (!time || time->time_since_epoch().count() == 0) cp.write(entity, now);
+        }
+        if (plan.use_version && plan.version_index >= 0) {
+            const PropertyPlan& vp = plan.props[plan.version_index];
+            const long long version = internal::value_to_long_long(vp.read(entity));
+            vp.write(entity, version > 0 ? version + 1 : 1LL);
+        }
+    }
+
+    // 按分块选项切分行：readRow读取一行参数，emit接收一块内各行的参数；
+    // params_per_row为最终语句中每行占用的占位符数，用于套用占位符上限
+    template<typename ReadRow, typename Emit>
+    static void forEachRowChunk(std::vector<Entity>& entities, const BatchOptions& options, size_t params_per_row,
+                                ReadRow&& readRow, Emit&& emit) {
+        const size_t max_rows = std::max<size_t>(1, std::min(options.max_rows, options.max_params / std::max<size_t>(params_per_row, 1)));
+        std::vector<std::vector<ValueVariant>> rows;
+        size_t bytes = 0;
+        for (Entity& entity : entities) {
+            std::vector<ValueVariant> row;
+            readRow(entity, row);
+            size_t row_bytes = 4 * params_per_row;
+            for (const auto& value : row) row_bytes += internal::estimate_param_bytes(value);
+            if (!rows.empty() && (rows.size() >= max_rows || bytes + row_bytes > options.max_bytes)) {
+                emit(rows);
+                rows.clear();
+                bytes = 0;
+            }
+            rows.push_back(std::move(row));
+            bytes += row_bytes;
+        }
+        if (!rows.empty()) emit(rows);
+    }
+
+    // 生成批量更新语句：SET各列使用CASE主键分支，整块取值相同时折叠为单个占位符；
+    // 每行参数为[主键, 原版本号(启用版本时), 各列的值...]
+    static SqlQueryResult buildBatchUpdate(const std::vector<size_t>& columns, std::vector<std::vector<ValueVariant>>& rows) {
+        const EntityPlan& plan = EntityPlan::of<Entity>();
+        const bool versioned = plan.use_version && plan.version_index >= 0;
+        const size_t first_value = versioned ? 2 : 1;
+        const std::string& pk_col = plan.primaryKey().quoted_column;
+
+        internal::SqlWriter sql;
+        std::vector<ValueVariant> params;
+        sql << "UPDATE " << plan.quoted_table << " SET ";
+        bool first = true;
+        for (size_t c = 0; c < columns.size(); ++c) {
+            const std::string& col = plan.props[columns[c]].quoted_column;
+            const size_t pos = first_value + c;
+            const ValueVariant* shared = nullptr;
+            size_t present = 0;
+            bool uniform = true;
+            for (const auto& row : rows) {
+                if (std::holds_alternative<std::monostate>(row[pos])) continue;
+                if (!shared) {
+                    shared = &row[pos];
+                } else if (uniform && row[pos] != *shared) {
+                    uniform = false;
+                }
+                ++present;
+            }
+            if (present == 0) continue;  // 整块均为空值，保持原值
+
+            if (!first) sql << ", ";
+            first = false;
+            if (present == rows.size() && uniform) {
+                sql << col << " = ?";
+                params.push_back(std::move(rows.front()[pos]));
+                continue;
+            }
+            sql << col << " = CASE " << pk_col;
+            for (auto& row : rows) {
+                if (std::holds_alternative<std::monostate>(row[pos])) continue;
+                sql << " WHEN ? THEN ?";
+                params.push_back(row[0]);
+                params.push_back(std::move(row[pos]));
+            }
+            sql << " ELSE " << col << " END";
+        }
+        if (first) throw std::runtime_error("No fields to update.");
+
+        if (versioned) {
+            const std::string& ver_col = plan.props[plan.version_index].quoted_column;
+            sql << ", " << ver_col << " = " << ver_col << " + 1";
+            sql << " WHERE (" << pk_col << ", " << ver_col << ") IN (";
+            for (size_t i = 0; i < rows.size(); ++i) {
+                sql << (i > 0 ? ",(?,?)" : "(?,?)");
+                params.push_back(std::move(rows[i][0]));
+                params.push_back(std::move(rows[i][1]));
+            }
+        } else {
+            sql << " WHERE " << pk_col << " IN (";
+            for (size_t i = 0; i < rows.size(); ++i) {
+                sql << (i > 0 ? ",?" : "?");
+                params.push_back(std::move(rows[i][0]));
+            }
+        }
+        sql << ')';
+
+        if (plan.use_logical_delete) {
+            sql << " AND `" << plan.logical_delete_field << "` != 1";
+        }
+        return {sql.str(), std::move(params)};
+    }
+
+    static std::vector<SqlQueryResult> batchUpdateColumns(std::vector<Entity>& entities, const std::vector<size_t>& columns,
+                                                          const BatchOptions& options) {
+        const EntityPlan& plan = EntityPlan::of<Entity>();
+        std::vector<SqlQueryResult> chunks;
+        if (entities.empty()) return chunks;
+
+        const bool versioned = plan.use_version && plan.version_index >= 0;
+        const PropertyPlan& pk = plan.primaryKey();
+        const auto now = std::chrono::system_clock::now();
+
+        forEachRowChunk(entities, options, 2 * columns.size() + (versioned ? 2 : 1),
+            [&](Entity& entity, std::vector<ValueVariant>& row) {
+                // 自动填充更新时间和版本
+                if (plan.update_time_index >= 0) plan.props[plan.update_time_index].write(entity, now);
+                row.reserve(columns.size() + 2);
+                row.push_back(pk.read(entity));
+                if (versioned) {
+                    const PropertyPlan& vp = plan.props[plan.version_index];
+                    ValueVariant original = vp.read(entity);
+                    vp.write(entity, internal::value_to_long_long(original) + 1);
+                    row.push_back(std::move(original));
+                }
+                for (size_t idx : columns) row.push_back(plan.props[idx].read(entity, true));
+            },
+            [&](std::vector<std::vector<ValueVariant>>& rows) {
+                chunks.push_back(buildBatchUpdate(columns, rows));
+            });
+        auto effect = touchTable(evictCached(entities), changeOf(ChangeOp::Update, entities.begin(), entities.end()));
+        for (auto& chunk : chunks) chunk.effect = effect;
+        return chunks;
+    }
+
+    // 按主键写入的行从二级缓存中失效，返回其主键供执行后再次失效；缓存未启用时为空
+    static std::vector<ValueVariant> evictCached(std::vector<ValueVariant> ids) {
+        if (!EntityCache<Entity>::instance().enabled()) return {};
+        evictIds(ids);
+        return ids;
+    }
+
+    static std::vector<ValueVariant> evictCached(const Entity& entity) {
+        const EntityPlan& plan = EntityPlan::of<Entity>();
+        if (!EntityCache<Entity>::instance().enabled() || plan.pk_index < 0) return {};
+        return evictCached(std::vector<ValueVariant>{plan.props[plan.pk_index].read(entity)});
+    }
+
+    static std::vector<ValueVariant> evictCached(const std::vector<Entity>& entities) {
+        const EntityPlan& plan = EntityPlan::of<Entity>();
+        if (!EntityCache<Entity>::instance().enabled() || plan.pk_index < 0) return {};
+        std::vector<ValueVariant> ids;
+        ids.reserve(entities.size());
+        for (const Entity& entity : entities) ids.push_back(plan.props[plan.pk_index].read(entity));
+        return evictCached(std::move(ids));
+    }
+
+    static void evictIds(const std::vector<ValueVariant>& ids) {
+        EntityCache<Entity>& cache = EntityCache<Entity>::instance();
+        for (const auto& id : ids) cache.invalidate(id);
+    }
+
+    // 写语句的变更事件，随语句携带、执行成功后由completeWrite发布；没有订阅者时不提取主键
+    template<typename CollectKeys>
+    static std::optional<ChangeEvent> changeKeys(ChangeOp op, CollectKeys&& collect_keys) {
+        if (!ChangeEventBus::instance().active()) return std::nullopt;
+        ChangeEvent event;
+        if constexpr (PfrEntity<Entity>) {
+            event.table = StaticEntity<Entity>::table;
+        } else {
+            event.table = EntityPlan::of<Entity>().table_name;
+        }
+        event.op = op;
+        collect_keys(event.keys);
+        return event;
+    }
+
+    static std::optional<ChangeEvent> changeOf(ChangeOp op, const Entity& entity) {
+        return changeOf(op, &entity, &entity + 1);
+    }
+
+    // 自增主键的插入（以及主键为0的upsert行）在执行前拿不到数据库生成的主键：
+    // 不携带主键并标记为不完整，订阅方按表重新载入，不会看到虚假的ID
+    template<typename It>
+    static std::optional<ChangeEvent> changeOf(ChangeOp op, It first, It last) {
+        const bool generated = generatedKey();
+        auto change = changeKeys(op, [&](auto& keys) {
+            if (generated && op == ChangeOp::Insert) return;
+            for (It it = first; it != last; ++it) keys.push_back(rowKey(*it));
+        });
+        if (!change || !generated) return change;
+        if (op == ChangeOp::Insert ||
+            (op == ChangeOp::Upsert && std::any_of(change->keys.begin(), change->keys.end(), [](const auto& key) {
+                 return key.empty() || internal::value_to_long_long(key[0]) == 0;
+             }))) {
+            change->keys.clear();
+            change->complete = false;
         }
-        
-        for (const auto& mapping : it->second) {
-            if (!row.hasColumn(mapping.columnPrefix)) {
-                continue;  // 跳过不存在的列
-            }
-            
-            auto prop = objType.get_property(mapping.propertyName);
-            if (!prop.is_valid()) {
-                continue;  // 跳过不存在的属性
-            }
-            
-            const ValueVariant& value = row.getValue(mapping.columnPrefix);
-            // 将ValueVariant转换为rttr::variant并设置属性值
-            rttr::variant var;
-            if (std::holds_alternative<std::monostate>(value)) {
-                // 空值处理
-                // var = rttr::variant(); // 默认无效值
-            } 
-            else if (std::holds_alternative<int>(value)) {
-                var = std::get<int>(value);
-            }
-            else if (std::holds_alternative<long>(value)) {
-                var = std::get<long>(value);
-            }
-            else if (std::holds_alternative<long long>(value)) {
-                var = std::get<long long>(value);
-            }
-            else if (std::holds_alternative<double>(value)) {
-                var = std::get<double>(value);
-            }
-            else if (std::holds_alternative<std::string>(value)) {
-                var = std::get<std::string>(value);
-            }
-            else if (std::holds_alternative<bool>(value)) {
-                var = std::get<bool>(value);
-            }
-            else if (std::holds_alternative<std::chrono::system_clock::time_point>(value)) {
-                var = std::get<std::chrono::system_clock::time_point>(value);
-            }
-            
-            if (var.is_valid()) {
-                prop.set_value(obj, var);
-            }
+        return change;
+    }
+
+    // 主键是否由数据库自增生成（复合主键看第一个主键列）
+    static bool generatedKey() {
+        if constexpr (PfrEntity<Entity>) {
+            return StaticEntity<Entity>::pk_auto_increment;
+        } else {
+            const EntityPlan& plan = EntityPlan::of<Entity>();
+            return plan.pk_index >= 0 && plan.props[plan.pk_index].auto_increment;
         }
-        
-        return obj;
     }
-    
-    // 从结果集映射到对象列表
-    template<typename T>
-    std::vector<T> mapToObjects(const ResultSet& resultSet) const {
-        std::vector<T> objects;
-        objects.reserve(resultSet.size());
-        
-        for (const auto& row : resultSet) {
-            objects.push_back(mapToObject<T>(row));
+
+    // 行的主键值：复合主键按声明顺序
+    static std::vector<ValueVariant> rowKey(const Entity& entity) {
+        if constexpr (PfrEntity<Entity>) {
+            return {internal::to_value_variant(boost::pfr::get<StaticEntity<Entity>::pk_index>(entity))};
+        } else {
+            std::vector<ValueVariant> key;
+            for (const auto& p : EntityPlan::of<Entity>().props) {
+                if (p.primary_key) key.push_back(p.read(entity));
+            }
+            return key;
         }
-        
-        return objects;
     }
-    
-    // 映射连表查询结果到多个不同类型的对象
-    template<typename... Entities>
-    std::vector<std::tuple<Entities...>> mapToTuples(const ResultSet& resultSet) const {
-        std::vector<std::tuple<Entities...>> tuples;
-        tuples.reserve(resultSet.size());
-        
-        for (const auto& row : resultSet) {
-            tuples.push_back(mapRowToTuple<Entities...>(row));
+
+    static std::string_view tableName() {
+        if constexpr (PfrEntity<Entity>) return StaticEntity<Entity>::table;
+        else return EntityPlan::of<Entity>().table_name;
+    }
+
+    // 生成写语句时递增表写入代数，使依赖该表的缓存失效；返回的后续处理随语句交给执行方，
+    // 执行后再递增一次，evicted中的主键（evictCached的返回值）在实体缓存中再次失效，并发布change
+    static std::shared_ptr<const WriteEffect> touchTable(std::vector<ValueVariant> evicted = {},
+                                                         std::optional<ChangeEvent> change = std::nullopt) {
+        auto effect = std::make_shared<WriteEffect>();
+        effect->table = tableName();
+        effect->change = std::move(change);
+        if (!evicted.empty()) {
+            effect->ids = std::move(evicted);
+            effect->evict = &evictIds;
         }
-        
-        return tuples;
+        TableGeneration::instance().bump(effect->table);
+        return effect;
     }
 
-private:
-    // 递归辅助函数：映射行到元组
-    template<typename FirstEntity, typename... RestEntities>
-    std::tuple<FirstEntity, RestEntities...> mapRowToTuple(const DbRow& row) const {
-        if constexpr (sizeof...(RestEntities) == 0) {
-            return std::make_tuple(mapToObject<FirstEntity>(row));
+    // 批量插入的语句前缀与单行占位符
+    static std::string_view batchInsertPrefix() {
+        if constexpr (PfrEntity<Entity>) return internal::StaticPlan<Entity>::get().insert_prefix;
+        else return EntityPlan::of<Entity>().batch_insert_prefix;
+    }
+
+    static std::string_view batchRowSql() {
+        if constexpr (PfrEntity<Entity>) return internal::StaticPlan<Entity>::get().batch_placeholders;
+        else return EntityPlan::of<Entity>().batch_row_sql;
+    }
+
+    static size_t insertParamCount() {
+        if constexpr (PfrEntity<Entity>) return internal::StaticPlan<Entity>::get().insert_count;
+        else return EntityPlan::of<Entity>().insert_indices.size();
+    }
+
+    // 自动填充后追加一行插入参数
+    static void appendInsertRow(Entity& entity, std::vector<ValueVariant>& params) {
+        if constexpr (PfrEntity<Entity>) {
+            internal::StaticPlan<Entity>::auto_fill_insert(entity);
+            internal::StaticPlan<Entity>::append_insert_params(entity, params);
         } else {
-            return std::tuple_cat(
-                std::make_tuple(mapToObject<FirstEntity>(row)),
-                mapRowToTuple<RestEntities...>(row)
-            );
+            auto_fill_insert(entity);
+            const EntityPlan& plan = EntityPlan::of<Entity>();
+            for (size_t idx : plan.insert_indices) {
+                params.push_back(plan.props[idx].read(entity));
+            }
         }
     }
-};
 
-// ========== ORM服务类 ==========
-template<typename Entity>
-class OrmService {
-private:
-    // 自动填充时间戳和版本号
-    static void auto_fill_insert(Entity& entity) {
-        rttr::type t = rttr::type::get(entity);
-        auto now = std::chrono::system_clock::now();
-        if (auto meta = t.get_metadata(meta::CREATE_TIME_FIELD); meta) {
-            if (auto prop = t.get_property(meta.to_string()); prop) prop.set_value(entity, now);
+    // 按实体计划顺序生成UPDATE，include决定候选字段，跳过主键与空值字段，保证SQL文本稳定
+    template<typename Include>
+    static SqlQueryResult buildUpdateById(Entity& entity, Include&& include) {
+        const EntityPlan& plan = EntityPlan::of<Entity>();
+        internal::SqlWriter sql;
+        std::vector<ValueVariant> params;
+
+        // 自动填充更新时间和版本
+        rttr::variant original_version;
+        if (plan.update_time_index >= 0) {
+            plan.props[plan.update_time_index].prop.set_value(entity, std::chrono::system_clock::now());
         }
-        if (auto meta = t.get_metadata(meta::UPDATE_TIME_FIELD); meta) {
-            if (auto prop = t.get_property(meta.to_string()); prop) prop.set_value(entity, now);
+        if (plan.use_version && plan.version_index >= 0) {
+            const auto& prop = plan.props[plan.version_index].prop;
+            original_version = prop.get_value(entity);
+            long long new_version = original_version.get_value<long long>() + 1;
+            prop.set_value(entity, new_version);
         }
-        if (auto meta = t.get_metadata(meta::USE_VERSION); meta.to_bool()) {
-            if (auto v_meta = t.get_metadata(meta::VERSION_FIELD); v_meta) {
-                if (auto prop = t.get_property(v_meta.to_string()); prop) prop.set_value(entity, 1);
-            }
+
+        // 生成SQL
+        sql << "UPDATE " << plan.quoted_table << " SET ";
+        bool first = true;
+        for (const auto& p : plan.props) {
+            if (p.primary_key || !include(p)) continue;
+            ValueVariant value = p.read(entity, true);
+            if (std::holds_alternative<std::monostate>(value)) continue;
+
+            if (!first) sql << ", ";
+            sql << p.quoted_column << " = ?";
+            params.push_back(std::move(value));
+            first = false;
         }
+
+        if (params.empty()) throw std::runtime_error("No fields to update.");
+
+        const PropertyPlan& pk = plan.primaryKey();
+        sql << " WHERE " << pk.quoted_column << " = ?";
+        params.push_back(pk.read(entity));
+
+        if (plan.use_version && original_version.is_valid()) {
+            sql << " AND `" << plan.version_field << "` = ?";
+            params.push_back(internal::rttr_to_value_variant(original_version));
+        }
+
+        // 语句完整生成后才使缓存失效
+        SqlQueryResult result{sql.str(), std::move(params)};
+        result.effect = touchTable(evictCached(entity), changeOf(ChangeOp::Update, entity));
+        return result;
     }
 
 public:
     // 插入操作
     static SqlQueryResult insert(Entity& entity) {
+        if constexpr (PfrEntity<Entity>) {
+            using Static = internal::StaticPlan<Entity>;
+            const Static& sp = Static::get();
+            Static::auto_fill_insert(entity);
+            std::vector<ValueVariant> params;
+            params.reserve(sp.insert_count);
+            Static::append_insert_params(entity, params);
+            SqlQueryResult result{sp.insert_prefix + sp.row_placeholders, std::move(params)};
+            result.effect = touchTable({}, changeOf(ChangeOp::Insert, entity));
+            return result;
+        }
+
         auto_fill_insert(entity);
-        rttr::type t = rttr::type::get(entity);
-        std::stringstream cols_sql, vals_sql;
+        const EntityPlan& plan = EntityPlan::of<Entity>();
+        internal::SqlWriter sql(plan.quoted_table.size() + plan.insert_columns_sql.size() + 3 * plan.insert_indices.size() + 32);
         std::vector<ValueVariant> params;
+        params.reserve(plan.insert_indices.size());
 
+        sql << "INSERT INTO " << plan.quoted_table << " (" << plan.insert_columns_sql << ") VALUES (";
         bool first = true;
-        for (auto& prop : t.get_properties()) {
-            // 跳过自增主键
-            if (prop.get_metadata(meta::AUTO_INCREMENT).to_bool()) continue;
-
-            if (!first) { cols_sql << ", "; vals_sql << ", "; }
-            cols_sql << "`" << internal::get_column_name(prop) << "`";
-            vals_sql << "?";
-            params.push_back(internal::rttr_to_value_variant(prop.get_value(entity)));
+        for (size_t idx : plan.insert_indices) {
+            if (!first) sql << ", ";
+            sql << '?';
+            params.push_back(plan.props[idx].read(entity));
             first = false;
         }
-
-        std::string sql = "INSERT INTO `" + internal::get_table_name(t) + "` (" + cols_sql.str() + ") VALUES (" + vals_sql.str() + ")";
-        return {sql, params};
+        sql << ')';
+        SqlQueryResult result{sql.str(), std::move(params)};
+        result.effect = touchTable({}, changeOf(ChangeOp::Insert, entity));
+        return result;
     }
 
     // 批量插入
     static SqlQueryResult batchInsert(std::vector<Entity>& entities) {
         if (entities.empty()) return {"", {}};
 
-        rttr::type t = rttr::type::get<Entity>();
-        std::stringstream cols_sql, vals_sql;
+        const std::string_view prefix = batchInsertPrefix();
+        const std::string_view row_sql = batchRowSql();
+        internal::SqlWriter sql(prefix.size() + (row_sql.size() + 1) * entities.size());
         std::vector<ValueVariant> params;
-        std::vector<rttr::property> props;
+        params.reserve(insertParamCount() * entities.size());
 
-        bool first = true;
-        for (auto& prop : t.get_properties()) {
-            if (prop.get_metadata(meta::AUTO_INCREMENT).to_bool()) continue;
-            if (!first) cols_sql << ", ";
-            cols_sql << "`" << internal::get_column_name(prop) << "`";
-            props.push_back(prop);
-            first = false;
+        sql << prefix;
+        for (size_t i = 0; i < entities.size(); ++i) {
+            if (i > 0) sql << ',';
+            sql << row_sql;
+            appendInsertRow(entities[i], params);
         }
+        SqlQueryResult result{sql.str(), std::move(params)};
+        result.effect = touchTable({}, changeOf(ChangeOp::Insert, entities.begin(), entities.end()));
+        return result;
+    }
 
-        for (Entity& entity : entities) {
-            auto_fill_insert(entity);
-            if (!vals_sql.str().empty()) vals_sql << ",";
-            vals_sql << "(";
-            first = true;
-            for (const auto& prop : props) {
-                if (!first) vals_sql << ",";
-                vals_sql << "?";
-                params.push_back(internal::rttr_to_value_variant(prop.get_value(entity)));
-                first = false;
+    // 借用参数的插入：参数直接引用实体字段，实体须比返回值存活更久且期间不被修改
+    static SqlQueryView insertView(Entity& entity) requires PfrEntity<Entity> {
+        using Static = internal::StaticPlan<Entity>;
+        const Static& sp = Static::get();
+        Static::auto_fill_insert(entity);
+        SqlQueryView view{sp.insert_prefix + sp.row_placeholders, {}};
+        view.params.reserve(sp.insert_count);
+        Static::append_insert_views(entity, view.params);
+        view.effect = touchTable({}, changeOf(ChangeOp::Insert, entity));
+        return view;
+    }
+
+    // 借用参数的批量插入，生命周期要求同insertView
+    static SqlQueryView batchInsertView(std::vector<Entity>& entities) requires PfrEntity<Entity> {
+        if (entities.empty()) return {"", {}};
+
+        using Static = internal::StaticPlan<Entity>;
+        const Static& sp = Static::get();
+        internal::SqlWriter sql(sp.insert_prefix.size() + (sp.batch_placeholders.size() + 1) * entities.size());
+        SqlQueryView view;
+        view.params.reserve(sp.insert_count * entities.size());
+
+        sql << sp.insert_prefix;
+        for (size_t i = 0; i < entities.size(); ++i) {
+            Static::auto_fill_insert(entities[i]);
+            if (i > 0) sql << ',';
+            sql << sp.batch_placeholders;
+            Static::append_insert_views(entities[i], view.params);
+        }
+        view.sql = sql.str();
+        view.effect = touchTable({}, changeOf(ChangeOp::Insert, entities.begin(), entities.end()));
+        return view;
+    }
+
+    // 分块批量插入游标：按行数、参数数与字节预算惰性切分，满块语句复用同一份SQL文本
+    class BatchInsertCursor {
+    public:
+        BatchInsertCursor(std::vector<Entity>& entities, const BatchOptions& options)
+            : m_entities(&entities), m_options(options) {
+            const size_t per_row = std::max<size_t>(insertParamCount(), 1);
+            m_rowsPerChunk = std::max<size_t>(1, std::min(options.max_rows, options.max_params / per_row));
+        }
+
+        bool done() const { return !m_hasPending && m_pos >= m_entities->size(); }
+        size_t rowsPerChunk() const { return m_rowsPerChunk; }
+
+        // 生成下一块写入chunk（复用其缓冲区），没有剩余行时返回false
+        bool next(SqlQueryResult& chunk) {
+            if (done()) return false;
+
+            const std::string_view prefix = batchInsertPrefix();
+            const size_t row_sql_bytes = batchRowSql().size() + 1;
+            chunk.params.clear();
+            chunk.params.reserve(insertParamCount() * std::min(m_rowsPerChunk, m_entities->size() - m_pos + 1));
+
+            size_t rows = 0;
+            size_t bytes = prefix.size();
+            while (rows < m_rowsPerChunk) {
+                if (!m_hasPending) {
+                    if (m_pos >= m_entities->size()) break;
+                    m_rowParams.clear();
+                    appendInsertRow((*m_entities)[m_pos++], m_rowParams);
+                    m_hasPending = true;
+                }
+                size_t row_bytes = row_sql_bytes;
+                for (const auto& value : m_rowParams) row_bytes += internal::estimate_param_bytes(value);
+                // 单行超出预算时仍单独成块，否则留到下一块
+                if (rows > 0 && bytes + row_bytes > m_options.max_bytes) break;
+
+                std::move(m_rowParams.begin(), m_rowParams.end(), std::back_inserter(chunk.params));
+                m_hasPending = false;
+                bytes += row_bytes;
+                ++rows;
+            }
+
+            if (rows == m_rowsPerChunk) {
+                if (m_fullSql.empty()) buildSql(m_fullSql, rows);
+                chunk.sql.assign(m_fullSql);
+            } else {
+                buildSql(chunk.sql, rows);
+            }
+            // 本块的行：已取出的行中除去留到下一块的一行
+            auto last = m_entities->begin() + static_cast<std::ptrdiff_t>(m_pos - (m_hasPending ? 1 : 0));
+            chunk.effect = touchTable({}, changeOf(ChangeOp::Insert, last - static_cast<std::ptrdiff_t>(rows), last));
+            return true;
+        }
+
+        std::optional<SqlQueryResult> next() {
+            SqlQueryResult chunk;
+            if (!next(chunk)) return std::nullopt;
+            return chunk;
+        }
+
+    private:
+        static void buildSql(std::string& out, size_t rows) {
+            const std::string_view prefix = batchInsertPrefix();
+            const std::string_view row_sql = batchRowSql();
+            out.clear();
+            out.reserve(prefix.size() + (row_sql.size() + 1) * rows);
+            out.append(prefix);
+            for (size_t i = 0; i < rows; ++i) {
+                if (i > 0) out.push_back(',');
+                out.append(row_sql);
             }
-            vals_sql << ")";
         }
 
-        std::string sql = "INSERT INTO `" + internal::get_table_name(t) + "` (" + cols_sql.str() + ") VALUES " + vals_sql.str();
-        return {sql, params};
+        std::vector<Entity>* m_entities;
+        BatchOptions m_options;
+        size_t m_rowsPerChunk = 1;
+        size_t m_pos = 0;
+        std::vector<ValueVariant> m_rowParams;   // 已读取但未放入当前块的一行参数
+        bool m_hasPending = false;
+        std::string m_fullSql;                   // 满块语句文本，首次需要时生成
+    };
+
+    // 分块批量插入，惰性逐块生成
+    static BatchInsertCursor batchInsertCursor(std::vector<Entity>& entities, const BatchOptions& options = {}) {
+        return BatchInsertCursor(entities, options);
+    }
+
+    // 分块批量插入，一次性生成全部语句
+    static std::vector<SqlQueryResult> batchInsert(std::vector<Entity>& entities, const BatchOptions& options) {
+        std::vector<SqlQueryResult> chunks;
+        BatchInsertCursor cursor(entities, options);
+        SqlQueryResult chunk;
+        while (cursor.next(chunk)) {
+            chunks.push_back(std::move(chunk));
+            chunk = {};
+        }
+        return chunks;
     }
 
     // 根据ID更新所有字段
     static SqlQueryResult updateById(Entity& entity) {
-        std::unordered_set<std::string> fields_to_update;
-        rttr::type t = rttr::type::get(entity);
-        for(auto& prop : t.get_properties()) {
-            fields_to_update.insert(prop.get_name().to_string());
-        }
-        return updateFieldsById(entity, fields_to_update);
+        return buildUpdateById(entity, [](const PropertyPlan&) { return true; });
     }
 
     // 根据ID更新指定字段
     static SqlQueryResult updateFieldsById(Entity& entity, const std::unordered_set<std::string>& fields_to_update) {
-        rttr::type t = rttr::type::get(entity);
-        std::stringstream set_sql;
-        std::vector<ValueVariant> params;
+        const EntityPlan& plan = EntityPlan::of<Entity>();
+        for (const auto& field_name : fields_to_update) {
+            plan.property(field_name);  // 校验字段存在
+        }
+        return buildUpdateById(entity, [&](const PropertyPlan& p) { return fields_to_update.count(p.name) > 0; });
+    }
 
-        // 自动填充更新时间和版本
-        rttr::variant original_version;
-        if (auto meta = t.get_metadata(meta::UPDATE_TIME_FIELD); meta) {
-            if (auto prop = t.get_property(meta.to_string()); prop) {
-                prop.set_value(entity, std::chrono::system_clock::now());
-            }
+    // 只更新快照以来发生变化的列，没有变化时返回空；语句执行成功后应调用tracked.markClean()
+    static std::optional<SqlQueryResult> updateChanged(Tracked<Entity>& tracked) {
+        const EntityPlan& plan = EntityPlan::of<Entity>();
+        Entity& entity = tracked.get();
+        std::vector<size_t> changed = tracked.changedIndexes();
+        // 只有主键发生变化时不生成语句，也不改动实体
+        if (std::all_of(changed.begin(), changed.end(), [&](size_t idx) { return plan.props[idx].primary_key; })) {
+            return std::nullopt;
         }
-        if (t.get_metadata(meta::USE_VERSION).to_bool()) {
-            if (auto v_meta = t.get_metadata(meta::VERSION_FIELD); v_meta) {
-                auto prop = t.get_property(v_meta.to_string());
-                if(prop) {
-                    original_version = prop.get_value(entity);
-                    long long new_version = original_version.get_value<long long>() + 1;
-                    prop.set_value(entity, new_version);
-                }
-            }
+
+        // 有实际变化时才填充更新时间和版本
+        ValueVariant original_version;
+        if (plan.update_time_index >= 0) {
+            plan.props[plan.update_time_index].write(entity, std::chrono::system_clock::now());
         }
+        if (plan.use_version && plan.version_index >= 0) {
+            original_version = tracked.snapshot()[plan.version_index];
+            plan.props[plan.version_index].write(entity, internal::value_to_long_long(original_version) + 1);
+        }
+        changed = tracked.changedIndexes();
 
-        // 只保留非空字段
-        std::unordered_set<std::string> effective_fields;
-        for (const auto& field_name : fields_to_update) {
-            auto prop = internal::get_prop(t, field_name);
-            // 跳过主键
-            if (prop.get_metadata(meta::PRIMARY_KEY).to_bool()) {
-                continue;
-            }
+        std::string key = "U" + std::to_string(reinterpret_cast<uintptr_t>(&plan)) + '|';
+        for (size_t idx : changed) internal::append_key_part(key, static_cast<long long>(idx));
 
-            // 获取属性值并直接使用属性对象进行检测
-            rttr::variant value = prop.get_value(entity);
-            ValueVariant val_variant = internal::rttr_to_value_variant(value, &prop);
-            
-            // 如果不是空值，则加入有效字段集合
-            if (!std::holds_alternative<std::monostate>(val_variant)) {
-                effective_fields.insert(field_name);
+        SqlQueryResult result;
+        auto cached = SqlShapeCache::instance().find(key);
+        internal::SqlWriter sql;
+        if (!cached) sql << "UPDATE " << plan.quoted_table << " SET ";
+        bool first = true;
+        for (size_t idx : changed) {
+            const PropertyPlan& p = plan.props[idx];
+            if (p.primary_key) continue;
+            if (!cached) {
+                if (!first) sql << ", ";
+                sql << p.quoted_column << " = ?";
             }
+            result.params.push_back(p.read(entity, true));
+            first = false;
         }
 
-        // 生成SQL
-        bool first = true;
-        for (const auto& field_name : effective_fields) {
-            auto prop = internal::get_prop(t, field_name);
-            
-            if (!first) set_sql << ", ";
-            set_sql << "`" << internal::get_column_name(prop) << "` = ?";
-            params.push_back(internal::rttr_to_value_variant(prop.get_value(entity), &prop));
-            first = false;
+        const PropertyPlan& pk = plan.primaryKey();
+        result.params.push_back(tracked.snapshot()[plan.pk_index]);
+        if (!cached) sql << " WHERE " << pk.quoted_column << " = ?";
+
+        if (plan.use_version && plan.version_index >= 0) {
+            if (!cached) sql << " AND `" << plan.version_field << "` = ?";
+            result.params.push_back(original_version);
         }
 
-        if (params.empty()) throw std::runtime_error("No fields to update.");
+        if (cached) {
+            result.sql = std::move(*cached);
+        } else {
+            result.sql = sql.str();
+            SqlShapeCache::instance().store(key, result.sql);
+        }
+        auto change = changeKeys(ChangeOp::Update, [&](auto& keys) {
+            std::vector<ValueVariant> key;
+            for (size_t i = 0; i < plan.props.size(); ++i) {
+                if (plan.props[i].primary_key) key.push_back(tracked.snapshot()[i]);
+            }
+            keys.push_back(std::move(key));
+        });
+        result.effect = touchTable(evictCached(std::vector<ValueVariant>{tracked.snapshot()[plan.pk_index]}), std::move(change));
+        return result;
+    }
 
-        auto pk_prop = internal::get_primary_key_prop(t);
-        set_sql << " WHERE `" << internal::get_column_name(pk_prop) << "` = ?";
-        params.push_back(internal::rttr_to_value_variant(pk_prop.get_value(entity)));
+    // 批量插入或更新（MySQL ON DUPLICATE KEY UPDATE）：按主键或唯一键冲突时更新其余列，
+    // 创建时间与逻辑删除列保留原值，版本号在库中原值基础上加1。
+    // 冲突分支不做乐观锁版本校验，直接覆盖；实体中的版本号按auto_fill_upsert推算，
+    // 只有与库中版本一致的已有行和新行才准确，其余行在按版本更新前应重新加载
+    static std::vector<SqlQueryResult> batchUpsert(std::vector<Entity>& entities, const BatchOptions& options = {}) {
+        const EntityPlan& plan = EntityPlan::of<Entity>();
+        std::vector<SqlQueryResult> chunks;
+        if (entities.empty()) return chunks;
+        const auto now = std::chrono::system_clock::now();
 
-        if (t.get_metadata(meta::USE_VERSION).to_bool() && original_version.is_valid()) {
-            set_sql << " AND `" << t.get_metadata(meta::VERSION_FIELD).to_string() << "` = ?";
-            params.push_back(internal::rttr_to_value_variant(original_version));
+        // 主键也写入，用于命中已存在的行
+        std::string columns_sql, update_sql, row_sql = "(";
+        for (size_t i = 0; i < plan.props.size(); ++i) {
+            const PropertyPlan& p = plan.props[i];
+            if (i > 0) {
+                columns_sql += ", ";
+                row_sql += ",";
+            }
+            columns_sql += p.quoted_column;
+            row_sql += "?";
+
+            const int idx = static_cast<int>(i);
+            if (p.primary_key || idx == plan.create_time_index) continue;
+            if (plan.use_logical_delete && idx == plan.logical_delete_index) continue;
+            if (!update_sql.empty()) update_sql += ", ";
+            if (plan.use_version && idx == plan.version_index) {
+                update_sql += p.quoted_column + " = " + p.quoted_column + " + 1";
+            } else {
+                update_sql += p.quoted_column + " = VALUES(" + p.quoted_column + ")";
+            }
+        }
+        row_sql += ")";
+
+        forEachRowChunk(entities, options, plan.props.size(),
+            [&](Entity& entity, std::vector<ValueVariant>& row) {
+                auto_fill_upsert(entity, now);
+                row.reserve(plan.props.size());
+                for (const auto& p : plan.props) row.push_back(p.read(entity));
+            },
+            [&](std::vector<std::vector<ValueVariant>>& rows) {
+                internal::SqlWriter sql(plan.quoted_table.size() + columns_sql.size() + update_sql.size() +
+                                        (row_sql.size() + 1) * rows.size() + 64);
+                std::vector<ValueVariant> params;
+                params.reserve(plan.props.size() * rows.size());
+                sql << "INSERT INTO " << plan.quoted_table << " (" << columns_sql << ") VALUES ";
+                for (size_t i = 0; i < rows.size(); ++i) {
+                    if (i > 0) sql << ',';
+                    sql << row_sql;
+                    std::move(rows[i].begin(), rows[i].end(), std::back_inserter(params));
+                }
+                if (!update_sql.empty()) sql << " ON DUPLICATE KEY UPDATE " << update_sql;
+                chunks.push_back({sql.str(), std::move(params)});
+            });
+        auto effect = touchTable(evictCached(entities), changeOf(ChangeOp::Upsert, entities.begin(), entities.end()));
+        for (auto& chunk : chunks) chunk.effect = effect;
+        return chunks;
+    }
+
+    // 按ID批量更新指定字段：每块生成一条UPDATE ... CASE语句，空值字段保持原值；
+    // 自动填充更新时间，启用版本时按(主键, 版本)匹配并递增版本，跳过已逻辑删除的行
+    static std::vector<SqlQueryResult> batchUpdateById(std::vector<Entity>& entities,
+                                                       const std::unordered_set<std::string>& fields_to_update,
+                                                       const BatchOptions& options = {}) {
+        const EntityPlan& plan = EntityPlan::of<Entity>();
+        for (const auto& field_name : fields_to_update) {
+            plan.property(field_name);  // 校验字段存在
         }
+        std::vector<size_t> columns;
+        for (size_t i = 0; i < plan.props.size(); ++i) {
+            const int idx = static_cast<int>(i);
+            if (plan.props[i].primary_key || (plan.use_version && idx == plan.version_index)) continue;
+            if (fields_to_update.count(plan.props[i].name) > 0 || idx == plan.update_time_index) columns.push_back(i);
+        }
+        return batchUpdateColumns(entities, columns, options);
+    }
 
-        std::string sql = "UPDATE `" + internal::get_table_name(t) + "` SET " + set_sql.str();
-        return {sql, params};
+    // 按ID批量更新全部字段（创建时间与逻辑删除列除外）
+    static std::vector<SqlQueryResult> batchUpdateById(std::vector<Entity>& entities, const BatchOptions& options = {}) {
+        const EntityPlan& plan = EntityPlan::of<Entity>();
+        std::vector<size_t> columns;
+        for (size_t i = 0; i < plan.props.size(); ++i) {
+            const int idx = static_cast<int>(i);
+            if (plan.props[i].primary_key || idx == plan.create_time_index) continue;
+            if (plan.use_version && idx == plan.version_index) continue;
+            if (plan.use_logical_delete && idx == plan.logical_delete_index) continue;
+            columns.push_back(i);
+        }
+        return batchUpdateColumns(entities, columns, options);
     }
 
     // 根据ID删除
     template<typename IdType>
     static SqlQueryResult deleteById(IdType id, long long version = -1) {
-        rttr::type t = rttr::type::get<Entity>();
-        auto pk_prop = internal::get_primary_key_prop(t);
-        std::string pk_col = internal::get_column_name(pk_prop);
+        const EntityPlan& plan = EntityPlan::of<Entity>();
+        const std::string& pk_col = plan.primaryKey().quoted_column;
         std::vector<ValueVariant> params;
 
-        if (t.get_metadata(meta::USE_LOGICAL_DELETE).to_bool()) {
-            std::string ld_field = t.get_metadata(meta::LOGICAL_DELETE_FIELD).to_string();
-            std::string sql = "UPDATE `" + internal::get_table_name(t) + "` SET `" + ld_field + "` = 1";
+        internal::SqlWriter sql;
+
+        if (plan.use_logical_delete) {
+            sql << "UPDATE " << plan.quoted_table << " SET `" << plan.logical_delete_field << "` = 1";
 
-            if (auto meta = t.get_metadata(meta::UPDATE_TIME_FIELD); meta) {
-                sql += ", `" + meta.to_string() + "` = ?";
+            if (!plan.update_time_field.empty()) {
+                sql << ", `" << plan.update_time_field << "` = ?";
                 params.push_back(std::chrono::system_clock::now());
             }
-            sql += " WHERE `" + pk_col + "` = ?";
-            params.push_back(id);
-            if (t.get_metadata(meta::USE_VERSION).to_bool() && version > -1) {
-                sql += " AND `" + t.get_metadata(meta::VERSION_FIELD).to_string() + "` = ?";
-                params.push_back(version);
-            }
-            return {sql, params};
+            sql << " WHERE " << pk_col << " = ?";
         } else {
-            std::string sql = "DELETE FROM `" + internal::get_table_name(t) + "` WHERE `" + pk_col + "` = ?";
-            params.push_back(id);
-            if (t.get_metadata(meta::USE_VERSION).to_bool() && version > -1) {
-                sql += " AND `" + t.get_metadata(meta::VERSION_FIELD).to_string() + "` = ?";
-                params.push_back(version);
-            }
-            return {sql, params};
+            sql << "DELETE FROM " << plan.quoted_table << " WHERE " << pk_col << " = ?";
         }
+        params.push_back(id);
+        if (plan.use_version && version > -1) {
+            sql << " AND `" << plan.version_field << "` = ?";
+            params.push_back(version);
+        }
+        SqlQueryResult result{sql.str(), std::move(params)};
+        result.effect = touchTable(evictCached(std::vector<ValueVariant>{ValueVariant(id)}),
+                                   changeKeys(ChangeOp::Delete, [&](auto& keys) { keys.push_back({ValueVariant(id)}); }));
+        return result;
     }
 
-    // 根据ID查询
+    // 根据ID查询（可配合IdentityMap与EntityCache使用，带锁读取须直接查询）
     template<typename IdType>
     static SqlQueryResult getById(IdType id, LockMode lock = LockMode::None) {
-        rttr::type t = rttr::type::get<Entity>();
-        auto pk_prop = internal::get_primary_key_prop(t);
-        std::string pk_col = internal::get_column_name(pk_prop);
+        const EntityPlan& plan = EntityPlan::of<Entity>();
 
-        std::string sql = "SELECT * FROM `" + internal::get_table_name(t) + "` WHERE `" + pk_col + "` = ?";
+        internal::SqlWriter sql;
+        sql << "SELECT * FROM " << plan.quoted_table << " WHERE " << plan.primaryKey().quoted_column << " = ?";
         std::vector<ValueVariant> params = {id};
 
-        if (t.get_metadata(meta::USE_LOGICAL_DELETE).to_bool()) {
-            sql += " AND `" + t.get_metadata(meta::LOGICAL_DELETE_FIELD).to_string() + "` != 1";
+        if (plan.use_logical_delete) {
+            sql << " AND `" << plan.logical_delete_field << "` != 1";
+        }
+        if (lock == LockMode::ForUpdate) sql << " FOR UPDATE";
+        if (lock == LockMode::ForShare) sql << " FOR SHARE";
+        return {sql.str(), params, internal::route_for(lock)};
+    }
+
+    // 将结果行映射为实体，按列名匹配属性（静态实体直接访问字段）
+    static Entity mapRow(DbRowView row) {
+        if constexpr (PfrEntity<Entity>) {
+            using Static = internal::StaticPlan<Entity>;
+            return Static::map_row(row, Static::bind(row.rowSchema()));
+        } else {
+            return mapRowByIndexes(row, bindColumns(row.rowSchema()));
+        }
+    }
+
+    // 将结果集映射为实体列表，列下标只绑定一次
+    static std::vector<Entity> mapRows(const ResultSet& resultSet) {
+        std::vector<Entity> objects;
+        objects.reserve(resultSet.size());
+        if constexpr (PfrEntity<Entity>) {
+            using Static = internal::StaticPlan<Entity>;
+            const auto indexes = Static::bind(resultSet.schema());
+            for (const auto& row : resultSet) {
+                objects.push_back(Static::map_row(row, indexes));
+            }
+        } else {
+            const auto indexes = bindColumns(resultSet.schema());
+            for (const auto& row : resultSet) {
+                objects.push_back(mapRowByIndexes(row, indexes));
+            }
+        }
+        return objects;
+    }
+
+private:
+    // 计划中各属性对应的结果列下标，-1表示结果中没有该列
+    static std::vector<int> bindColumns(const ResultSchema& schema) {
+        const EntityPlan& plan = EntityPlan::of<Entity>();
+        std::vector<int> indexes(plan.props.size());
+        for (size_t i = 0; i < plan.props.size(); ++i) indexes[i] = schema.indexOf(plan.props[i].column);
+        return indexes;
+    }
+
+    static Entity mapRowByIndexes(DbRowView row, const std::vector<int>& indexes) {
+        const EntityPlan& plan = EntityPlan::of<Entity>();
+        Entity obj{};
+        for (size_t i = 0; i < plan.props.size(); ++i) {
+            if (indexes[i] < 0) continue;
+            plan.props[i].write(obj, row.getValue(static_cast<size_t>(indexes[i])));
         }
-        if (lock == LockMode::ForUpdate) sql += " FOR UPDATE";
-        if (lock == LockMode::ForShare) sql += " FOR SHARE";
-        return {sql, params};
+        return obj;
     }
 
+public:
     // 条件查询
     static SqlQueryResult selectByCondition(const QueryWrapper<Entity>& wrapper, LockMode lock = LockMode::None) {
-        rttr::type t = rttr::type::get<Entity>();
-        auto result = wrapper.getSelectSql();
-        
+        return finishSelect(wrapper.getSelectSql(), lock);
+    }
+
+private:
+    // 为单表查询补充逻辑删除条件与读写锁
+    static SqlQueryResult finishSelect(SqlQueryResult result, LockMode lock) {
+        const EntityPlan& plan = EntityPlan::of<Entity>();
+
         // 添加逻辑删除条件
-        if (t.get_metadata(meta::USE_LOGICAL_DELETE).to_bool()) {
-            std::string ld_cond = " `" + t.get_metadata(meta::LOGICAL_DELETE_FIELD).to_string() + "` != 1";
+        if (plan.use_logical_delete) {
+            std::string ld_cond = " `" + plan.logical_delete_field + "` != 1";
+            // 条件须插在ORDER BY/LIMIT之前
+            size_t tail_pos = std::min(result.sql.find(" ORDER BY"), result.sql.find(" LIMIT "));
+            if (tail_pos == std::string::npos) tail_pos = result.sql.length();
             size_t where_pos = result.sql.find(" WHERE ");
-            if (where_pos == std::string::npos) {
-                result.sql += " WHERE" + ld_cond;
-            } else {
-                size_t order_pos = result.sql.find(" ORDER BY");
-                result.sql.insert(order_pos == std::string::npos ? result.sql.length() : order_pos, " AND" + ld_cond);
-            }
+            result.sql.insert(tail_pos, (where_pos == std::string::npos ? " WHERE" : " AND") + ld_cond);
         }
         
         // 添加读写锁
@@ -1025,10 +3948,30 @@ public:
         } else if (lock == LockMode::ForShare) {
             result.sql += " FOR SHARE";
         }
+        result.route = internal::route_for(lock);
         
         return result;
     }
 
+    // 分页的数据列：Window模式追加总数列，FoundRows模式在首列前加 SQL_CALC_FOUND_ROWS
+    static std::vector<std::string> pageSelectColumns(std::vector<std::string> columns, PageCountMode mode) {
+        if (mode == PageCountMode::Window) {
+            columns.push_back(std::string("COUNT(*) OVER() AS `") + PAGE_TOTAL_COLUMN + "`");
+        } else if (mode == PageCountMode::FoundRows) {
+            columns.front() = "SQL_CALC_FOUND_ROWS " + columns.front();
+        }
+        return columns;
+    }
+
+    static int pageLimit(const PageParam& page, PageCountMode mode) {
+        return mode == PageCountMode::SkipCount ? page.page_size + 1 : page.page_size;
+    }
+
+    static std::optional<SqlQueryResult> foundRowsQuery() {
+        return SqlQueryResult{"SELECT FOUND_ROWS()", {}};
+    }
+
+public:
     // 分页查询
     static std::pair<SqlQueryResult, SqlQueryResult> selectPage(const QueryWrapper<Entity>& wrapper, const PageParam& page, LockMode lock = LockMode::None) {
         auto count_wrapper = wrapper;
@@ -1042,6 +3985,92 @@ public:
     static SqlQueryResult count(const QueryWrapper<Entity>& wrapper) {
         return wrapper.getCountSql();
     }
+
+    // 计数语句（可配合CountCache使用）：Approximate模式下无过滤条件时读取表统计信息中的估计行数
+    static CountQuery countQuery(const QueryWrapper<Entity>& wrapper, CountMode mode = CountMode::Exact) {
+        const EntityPlan& plan = EntityPlan::of<Entity>();
+        if (mode == CountMode::Approximate && !wrapper.hasConditions()) {
+            return {{"SELECT TABLE_ROWS FROM information_schema.TABLES WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME = ?",
+                     {plan.table_name}},
+                    plan.table_name, false};
+        }
+        return {wrapper.getCountSql(), plan.table_name, true};
+    }
+
+    // 大IN列表查询计划：取值最多的IN/NOT IN条件超过拆分阈值时，IN拆为多条语句，
+    // NOT IN或超过临时表阈值时将取值写入会话临时表并改写为子查询；含NULL取值时保持原样
+    static InListPlan planInList(const QueryWrapper<Entity>& wrapper, LockMode lock = LockMode::None) {
+        const InListPolicy& policy = InListPolicy::global();
+        const auto& conditions = wrapper.conditions();
+        InListPlan result;
+
+        size_t target = conditions.size(), largest = 0;
+        for (size_t i = 0; i < conditions.size(); ++i) {
+            const auto& [field_name, op, values] = conditions[i];
+            if ((op == QueryOperator::__op_IN || op == QueryOperator::__op_NOT_IN) && values.size() > largest) {
+                target = i;
+                largest = values.size();
+            }
+        }
+
+        std::vector<ValueVariant> distinct;
+        if (target < conditions.size()) {
+            distinct = std::get<2>(conditions[target]);
+            std::sort(distinct.begin(), distinct.end());
+            distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+        }
+        if (distinct.size() <= policy.split_threshold || std::holds_alternative<std::monostate>(distinct.front())) {
+            result.queries.push_back(selectByCondition(wrapper, lock));
+            return result;
+        }
+
+        const auto& [field_name, op, values] = conditions[target];
+        if (op == QueryOperator::__op_IN && distinct.size() <= policy.temp_table_threshold) {
+            // 各段结果的并集即原结果；分页改在合并后进行，每段取前 offset+limit 行
+            result.kind = InListPlan::Kind::Split;
+            auto chunk_wrapper = wrapper;
+            if (wrapper.limitValue() >= 0) {
+                chunk_wrapper.limit(wrapper.limitValue() + std::max(wrapper.offsetValue(), 0)).offset(-1);
+            } else {
+                chunk_wrapper.offset(-1);
+            }
+            for (size_t begin = 0; begin < distinct.size(); begin += policy.split_threshold) {
+                const size_t end = std::min(distinct.size(), begin + policy.split_threshold);
+                std::vector<ValueVariant> chunk(distinct.begin() + static_cast<std::ptrdiff_t>(begin),
+                                                distinct.begin() + static_cast<std::ptrdiff_t>(end));
+                internal::bucket_in_values(chunk);
+                chunk_wrapper.setConditionValues(target, std::move(chunk));
+                result.queries.push_back(selectByCondition(chunk_wrapper, lock));
+            }
+            return result;
+        }
+
+        result.kind = InListPlan::Kind::TempTable;
+        std::string table = "__in_";
+        for (char c : field_name) table += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+        const std::string quoted = "`" + table + "`";
+
+        result.setup.push_back({"DROP TEMPORARY TABLE IF EXISTS " + quoted, {}});
+        result.setup.push_back({"CREATE TEMPORARY TABLE " + quoted + " (`v` " + internal::in_table_column_type(distinct.front())
+                                + " NOT NULL PRIMARY KEY) ENGINE=MEMORY", {}});
+        // 末段以重复末值补满，INSERT IGNORE去重，各段复用同一SQL文本
+        const size_t rows = std::max<size_t>(1, policy.split_threshold);
+        std::string insert_sql = "INSERT IGNORE INTO " + quoted + " (`v`) VALUES ";
+        for (size_t i = 0; i < rows; ++i) insert_sql += i == 0 ? "(?)" : ",(?)";
+        for (size_t begin = 0; begin < distinct.size(); begin += rows) {
+            const size_t end = std::min(distinct.size(), begin + rows);
+            std::vector<ValueVariant> params(distinct.begin() + static_cast<std::ptrdiff_t>(begin),
+                                             distinct.begin() + static_cast<std::ptrdiff_t>(end));
+            params.resize(rows, params.back());
+            result.setup.push_back({insert_sql, std::move(params)});
+        }
+
+        auto rewritten = wrapper;
+        rewritten.setConditionSubquery(target, "SELECT `v` FROM " + quoted);
+        result.queries.push_back(selectByCondition(rewritten, lock));
+        result.cleanup.push_back({"DROP TEMPORARY TABLE IF EXISTS " + quoted, {}});
+        return result;
+    }
     
     // 连表查询
     static SqlQueryResult selectWithJoin(const JoinQueryWrapper<Entity>& wrapper, LockMode lock = LockMode::None) {
@@ -1055,10 +4084,20 @@ public:
         } else if (lock == LockMode::ForShare) {
             result.sql += " FOR SHARE";
         }
+        result.route = internal::route_for(lock);
         
         return result;
     }
     
+    // 可缓存的查询语句（配合QueryResultCache使用），带锁读取不经过缓存因此不提供锁参数
+    static TaggedQuery taggedSelect(const QueryWrapper<Entity>& wrapper) {
+        return {selectByCondition(wrapper), {EntityPlan::of<Entity>().table_name}};
+    }
+
+    static TaggedQuery taggedJoinSelect(const JoinQueryWrapper<Entity>& wrapper) {
+        return {selectWithJoin(wrapper), wrapper.tables()};
+    }
+
     // 连表分页查询
     static std::pair<SqlQueryResult, SqlQueryResult> selectJoinPage(
         const JoinQueryWrapper<Entity>& wrapper, 
@@ -1073,6 +4112,80 @@ public:
         
         return {count_sql, data_sql};
     }
+
+    // 按计数方式生成分页语句：Window与SkipCount只需一次往返，
+    // Window结果用PageResult::build(records, resultSet, page)读取总数，SkipCount用PageResult::buildSkipCount
+    static PageQuery selectPage(const QueryWrapper<Entity>& wrapper, const PageParam& page, PageCountMode mode, LockMode lock = LockMode::None) {
+        if (mode == PageCountMode::Separate) {
+            auto [count_sql, data_sql] = selectPage(wrapper, page, lock);
+            return {std::move(data_sql), std::move(count_sql), mode};
+        }
+
+        auto data_wrapper = wrapper;
+        data_wrapper.limit(pageLimit(page, mode)).offset((page.page_index - 1) * page.page_size);
+        auto data_sql = finishSelect(data_wrapper.getSelectSql(pageSelectColumns({"*"}, mode)), lock);
+        return {std::move(data_sql), mode == PageCountMode::FoundRows ? foundRowsQuery() : std::nullopt, mode};
+    }
+
+    // 连表分页查询，计数方式同selectPage
+    static PageQuery selectJoinPage(const JoinQueryWrapper<Entity>& wrapper, const PageParam& page, PageCountMode mode, LockMode lock = LockMode::None) {
+        if (mode == PageCountMode::Separate) {
+            auto [count_sql, data_sql] = selectJoinPage(wrapper, page, lock);
+            return {std::move(data_sql), std::move(count_sql), mode};
+        }
+
+        auto data_wrapper = wrapper;
+        std::vector<std::string> columns = wrapper.selectColumns();
+        if (columns.empty()) columns.push_back(wrapper.mainAlias() + ".*");
+        data_wrapper.select(pageSelectColumns(std::move(columns), mode));
+        data_wrapper.limit(pageLimit(page, mode)).offset((page.page_index - 1) * page.page_size);
+        auto data_sql = selectWithJoin(data_wrapper, lock);
+        return {std::move(data_sql), mode == PageCountMode::FoundRows ? foundRowsQuery() : std::nullopt, mode};
+    }
+
+    // 游标分页查询：从续页令牌对应的位置之后读取，多取一行用于判断是否有下一页；
+    // 排序字段末尾应包含主键等唯一列，保证翻页稳定
+    static SqlQueryResult selectSeekPage(const QueryWrapper<Entity>& wrapper, const SeekParam& page, LockMode lock = LockMode::None) {
+        auto data_wrapper = wrapper;
+        prepareSeek(data_wrapper, page);
+        return selectByCondition(data_wrapper, lock);
+    }
+
+    // 连表游标分页查询，游标谓词直接使用orderBy中的字段原文（如 u.create_time）
+    static SqlQueryResult selectJoinSeekPage(const JoinQueryWrapper<Entity>& wrapper, const SeekParam& page, LockMode lock = LockMode::None) {
+        auto data_wrapper = wrapper;
+        prepareSeek(data_wrapper, page);
+        return selectWithJoin(data_wrapper, lock);
+    }
+
+    // 由selectSeekPage的查询结果构建游标分页结果，续页令牌取自末行实体的排序字段
+    static CursorPageResult<Entity> buildSeekPage(std::vector<Entity> records, const QueryWrapper<Entity>& wrapper, const SeekParam& page) {
+        const EntityPlan& plan = EntityPlan::of<Entity>();
+        std::vector<const PropertyPlan*> keys;
+        for (const auto& [field_name, dir] : wrapper.orderFields()) keys.push_back(&plan.property(field_name));
+        return CursorPageResult<Entity>::build(std::move(records), page, [&keys](const Entity& entity) {
+            std::vector<ValueVariant> values;
+            values.reserve(keys.size());
+            for (const PropertyPlan* key : keys) values.push_back(key->read(entity));
+            return values;
+        });
+    }
+
+private:
+    template<typename Wrapper>
+    static void prepareSeek(Wrapper& wrapper, const SeekParam& page) {
+        if (wrapper.orderFields().empty()) {
+            throw std::runtime_error("Seek pagination requires ORDER BY fields");
+        }
+        if (!page.cursor.empty()) {
+            auto keys = internal::decode_seek_cursor(page.cursor);
+            if (keys.size() != wrapper.orderFields().size()) {
+                throw std::runtime_error("Page cursor does not match ORDER BY fields");
+            }
+            wrapper.seekAfter(std::move(keys));
+        }
+        wrapper.limit(page.page_size + 1).offset(-1);
+    }
 };
 
 } // namespace orm_rttr
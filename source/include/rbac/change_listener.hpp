@@ -0,0 +1,146 @@
+#ifndef RBAC_CHANGE_LISTENER_HPP
+#define RBAC_CHANGE_LISTENER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "orm_rttr.hpp"
+#include "rbac/data_scope.hpp"
+#include "rbac/dept_tree.hpp"
+#include "rbac/menu_tree.hpp"
+#include "rbac/permission_index.hpp"
+
+namespace rbac {
+
+// ========== 变更监听 ==========
+// 订阅RBAC相关表的变更事件，将关联表的增删直接应用到内存结构：用户角色变化只重新组合该用户，
+// 角色菜单与角色部门变化只丢弃包含该角色的缓存条目，部门删除只摘除对应子树。
+// 事件只携带主键，无法据此更新的变化（菜单、角色行本身，部门新增与修改）以及执行结果未知的语句
+// 记入待重新载入的表，由调用方全量reload
+
+class RbacChangeListener {
+public:
+    struct Stats {
+        uint64_t applied = 0;   // 定向处理的事件数
+        uint64_t deferred = 0;  // 需要全量重新载入的事件数
+    };
+
+    // 任一组件可为空，对应的变化不处理
+    RbacChangeListener(PermissionIndex* index, DataScopeCompiler* scopes, MenuTreeService* menus, DeptTree* depts)
+        : m_index(index), m_scopes(scopes), m_menus(menus), m_depts(depts) {
+        m_subscription = orm_rttr::ChangeEventBus::instance().subscribe(
+            {"sys_user_role", "sys_role_menu", "sys_role_dept", "sys_dept", "sys_role", "sys_menu"},
+            [this](const orm_rttr::ChangeEvent& event) { onChange(event); });
+    }
+
+    RbacChangeListener(const RbacChangeListener&) = delete;
+    RbacChangeListener& operator=(const RbacChangeListener&) = delete;
+
+    // 已处理的最后一个事件的代数；读取方记下该值，之后比较即可无锁判断是否有相关变更
+    uint64_t generation() const { return m_generation.load(std::memory_order_acquire); }
+
+    // 收到过无法定向处理的变更、需要全量重新载入的表
+    std::vector<std::string> pendingReload() const {
+        std::lock_guard lock(m_mutex);
+        std::vector<std::string> tables;
+        tables.reserve(m_pending.size());
+        for (const auto& [table, generation] : m_pending) tables.push_back(table);
+        return tables;
+    }
+
+    // 调用方完成对应的reload后确认；generation为开始读取该表之前的generation()，
+    // 重新载入期间又收到的待处理变更保留，留给下一次reload
+    void markReloaded(const std::string& table, uint64_t generation) {
+        std::lock_guard lock(m_mutex);
+        auto it = m_pending.find(table);
+        if (it != m_pending.end() && it->second <= generation) m_pending.erase(it);
+    }
+
+    Stats stats() const { return {m_applied.load(), m_deferred.load()}; }
+
+private:
+    // 关联表事件按行拆分：有两列的是单个关联，按ID删除的只有第一列，表示该ID的全部关联
+    struct Links {
+        std::vector<PermissionIndex::Link> pairs;
+        std::vector<int64_t> owners;
+    };
+
+    static Links splitKeys(const orm_rttr::ChangeEvent& event) {
+        Links links;
+        links.pairs.reserve(event.keys.size());
+        for (const auto& key : event.keys) {
+            if (key.empty()) continue;
+            const int64_t owner = orm_rttr::internal::value_to_long_long(key[0]);
+            if (key.size() >= 2) {
+                links.pairs.emplace_back(owner, orm_rttr::internal::value_to_long_long(key[1]));
+            } else {
+                links.owners.push_back(owner);
+            }
+        }
+        return links;
+    }
+
+    // 每个事件对每个组件只调用一次批量接口，整批变更一次重建
+    void onChange(const orm_rttr::ChangeEvent& event) {
+        const bool linked = event.op == orm_rttr::ChangeOp::Insert || event.op == orm_rttr::ChangeOp::Upsert;
+        const bool unlinked = event.op == orm_rttr::ChangeOp::Delete;
+        bool applied = true;
+
+        if (!event.complete) {
+            applied = false;  // 语句是否执行未知，无法定向处理
+        } else if (event.table == "sys_user_role" && (linked || unlinked)) {
+            Links links = splitKeys(event);
+            if (m_index && linked) m_index->grantRoles(links.pairs);
+            if (m_index && unlinked) m_index->revokeRoles(links.pairs, links.owners);
+        } else if (event.table == "sys_role_menu" && (linked || unlinked)) {
+            Links links = splitKeys(event);
+            if (linked) {
+                if (m_index) m_index->linkMenus(links.pairs);
+                if (m_menus) m_menus->linkMenus(links.pairs);
+            } else {
+                if (m_index) m_index->unlinkMenus(links.pairs, links.owners);
+                if (m_menus) m_menus->unlinkMenus(links.pairs, links.owners);
+            }
+        } else if (event.table == "sys_role_dept" && (linked || unlinked)) {
+            Links links = splitKeys(event);
+            if (m_scopes && linked) m_scopes->linkDepts(links.pairs);
+            if (m_scopes && unlinked) m_scopes->unlinkDepts(links.pairs, links.owners);
+        } else if (event.table == "sys_dept" && unlinked) {
+            // 部门树版本变化后，数据权限只丢弃依赖部门树的条目
+            for (const auto& key : event.keys) {
+                if (!key.empty() && m_depts) m_depts->remove(orm_rttr::internal::value_to_long_long(key[0]));
+            }
+        } else {
+            applied = false;
+        }
+
+        if (applied) {
+            ++m_applied;
+        } else {
+            std::lock_guard lock(m_mutex);
+            uint64_t& latest = m_pending[event.table];
+            latest = std::max(latest, event.generation);
+            ++m_deferred;
+        }
+        m_generation.store(event.generation, std::memory_order_release);
+    }
+
+    PermissionIndex* m_index;
+    DataScopeCompiler* m_scopes;
+    MenuTreeService* m_menus;
+    DeptTree* m_depts;
+    mutable std::mutex m_mutex;
+    std::map<std::string, uint64_t> m_pending;  // 表 -> 最后一个待处理变更的代数
+    std::atomic<uint64_t> m_generation{0};
+    std::atomic<uint64_t> m_applied{0};
+    std::atomic<uint64_t> m_deferred{0};
+    orm_rttr::ChangeEventBus::Subscription m_subscription;  // 最后声明，先于其他成员退订
+};
+
+} // namespace rbac
+
+#endif // RBAC_CHANGE_LISTENER_HPP
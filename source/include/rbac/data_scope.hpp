@@ -0,0 +1,355 @@
+#ifndef RBAC_DATA_SCOPE_HPP
+#define RBAC_DATA_SCOPE_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "entity/sys_entities.hpp"
+#include "orm_rttr.hpp"
+#include "rbac/dept_tree.hpp"
+
+namespace rbac {
+
+// ========== 数据权限 ==========
+// 将用户的角色组合编译为最小谓词：有序部门id集合（连续id合并为区间）加可选的仅本人过滤，
+// 按(角色组合, 用户部门)缓存，列表查询直接追加谓词，不再每次执行 getUserDataScopeSql 与 ancestors 子查询
+
+// SysRole::data_scope 取值
+inline constexpr char DATA_SCOPE_ALL = '1';              // 全部数据
+inline constexpr char DATA_SCOPE_CUSTOM = '2';           // 自定义部门（sys_role_dept）
+inline constexpr char DATA_SCOPE_DEPT = '3';             // 本部门
+inline constexpr char DATA_SCOPE_DEPT_AND_CHILD = '4';   // 本部门及以下
+inline constexpr char DATA_SCOPE_SELF = '5';             // 仅本人
+
+// 编译结果，同一角色组合与部门的用户共享
+struct CompiledDataScope {
+    struct DeptRange {
+        int64_t first = 0;
+        int64_t last = 0;
+    };
+
+    static constexpr size_t RANGE_MIN_LENGTH = 3;  // 至少这么多个连续id才写成BETWEEN
+
+    bool all = false;               // 不限制
+    bool self = false;              // 包含本人数据
+    std::vector<int64_t> dept_ids;  // 有序去重
+    std::vector<DeptRange> ranges;  // dept_ids按连续id合并后的区间
+
+    bool none() const { return !all && !self && dept_ids.empty(); }
+
+    bool allowsDept(int64_t dept_id) const {
+        return all || std::binary_search(dept_ids.begin(), dept_ids.end(), dept_id);
+    }
+};
+
+// 某个用户的数据权限：编译结果加用户id（仅本人过滤使用）
+struct DataScope {
+    std::shared_ptr<const CompiledDataScope> compiled;
+    int64_t user_id = 0;
+
+    bool all() const { return compiled && compiled->all; }
+
+    bool allows(int64_t dept_id, int64_t owner_id) const {
+        if (!compiled) return false;
+        return compiled->allowsDept(dept_id) || (compiled->self && owner_id == user_id);
+    }
+
+    // 以AND追加 (dept IN (...) OR dept BETWEEN ? AND ? OR user = ?)；列名原样写入，JOIN查询可带表别名。
+    // user_column为空时忽略仅本人部分；没有任何可见数据时追加恒假谓词
+    template<typename Entity>
+    void applyTo(orm_rttr::QueryWrapper<Entity>& wrapper, const std::string& dept_column = "dept_id",
+                 const std::string& user_column = "user_id") const {
+        if (all()) return;
+        std::string predicate;
+        std::vector<orm_rttr::ValueVariant> params;
+        auto or_ = [&] { if (!predicate.empty()) predicate += " OR "; };
+
+        if (compiled) {
+            std::vector<orm_rttr::ValueVariant> singles;
+            for (const auto& range : compiled->ranges) {
+                if (range.last - range.first + 1 >= static_cast<int64_t>(CompiledDataScope::RANGE_MIN_LENGTH)) {
+                    or_();
+                    predicate += dept_column + " BETWEEN ? AND ?";
+                    params.emplace_back(range.first);
+                    params.emplace_back(range.last);
+                } else {
+                    for (int64_t id = range.first; id <= range.last; ++id) singles.emplace_back(id);
+                }
+            }
+            if (!singles.empty()) {
+                orm_rttr::internal::normalize_in_values(singles);
+                or_();
+                predicate += dept_column + (singles.size() == 1 ? " = ?" : " IN (");
+                if (singles.size() > 1) {
+                    for (size_t i = 0; i < singles.size(); ++i) predicate += i > 0 ? ",?" : "?";
+                    predicate += ')';
+                }
+                params.insert(params.end(), singles.begin(), singles.end());
+            }
+            if (compiled->self && !user_column.empty()) {
+                or_();
+                predicate += user_column + " = ?";
+                params.emplace_back(user_id);
+            }
+        }
+        if (predicate.empty()) predicate = "1 = 0";
+        wrapper.apply(std::move(predicate), std::move(params));
+    }
+};
+
+class DataScopeCompiler {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        size_t entries = 0;
+    };
+
+    explicit DataScopeCompiler(const DeptTree& depts) : m_depts(depts) {}
+
+    using Generations = std::array<uint64_t, 2>;  // sys_role, sys_role_dept
+
+    // 读取源表之前调用，返回值交给load/reload*：读取与载入之间完成的写入使对应的表仍被视为过期
+    Generations beginLoad() const {
+        return {orm_rttr::TableGeneration::instance().current(TABLES[0]),
+                orm_rttr::TableGeneration::instance().current(TABLES[1])};
+    }
+
+    // 全量载入角色的数据范围与自定义部门；generations为读取前beginLoad的返回值
+    void load(const std::vector<entity::SysRole>& roles, const std::vector<entity::SysRoleDept>& role_depts,
+              const Generations& generations) {
+        std::unique_lock lock(m_mutex);
+        m_generations = generations;
+        applyRoles(roles);
+        applyRoleDepts(role_depts);
+        m_cache.clear();
+    }
+
+    void reloadRoles(const std::vector<entity::SysRole>& roles, const Generations& generations) {
+        std::unique_lock lock(m_mutex);
+        m_generations[0] = generations[0];
+        applyRoles(roles);
+        m_cache.clear();
+    }
+
+    // sys_role_dept 变化
+    void reloadRoleDepts(const std::vector<entity::SysRoleDept>& role_depts, const Generations& generations) {
+        std::unique_lock lock(m_mutex);
+        m_generations[1] = generations[1];
+        applyRoleDepts(role_depts);
+        m_cache.clear();
+    }
+
+    // 载入后发生过写入的相关表
+    std::vector<std::string> staleTables() const {
+        std::shared_lock lock(m_mutex);
+        std::vector<std::string> stale;
+        for (size_t i = 0; i < TABLES.size(); ++i) {
+            if (orm_rttr::TableGeneration::instance().current(TABLES[i]) != m_generations[i]) stale.emplace_back(TABLES[i]);
+        }
+        return stale;
+    }
+
+    // 编译用户的数据权限；role_ids无需有序，停用、删除或不存在的角色不授予数据
+    DataScope compile(std::vector<int64_t> role_ids, int64_t user_id, int64_t dept_id) {
+        std::sort(role_ids.begin(), role_ids.end());
+        role_ids.erase(std::unique(role_ids.begin(), role_ids.end()), role_ids.end());
+        Key key{std::move(role_ids), dept_id};
+        const uint64_t dept_version = m_depts.version();
+        {
+            std::shared_lock lock(m_mutex);
+            if (m_dept_version == dept_version) {
+                auto it = m_cache.find(key);
+                if (it != m_cache.end()) {
+                    ++m_hits;
+                    return {it->second.scope, user_id};
+                }
+            }
+        }
+
+        std::unique_lock lock(m_mutex);
+        if (m_dept_version != dept_version) {
+            // 部门树变化只影响含"本部门及以下"角色的条目
+            evictIf([](const Key&, const Entry& entry) { return entry.uses_tree; });
+            m_dept_version = dept_version;
+        }
+        auto it = m_cache.find(key);
+        if (it != m_cache.end()) {
+            ++m_hits;
+            return {it->second.scope, user_id};
+        }
+        ++m_misses;
+        Entry entry = build(key);
+        auto compiled = entry.scope;
+        m_cache.emplace(std::move(key), std::move(entry));
+        return {std::move(compiled), user_id};
+    }
+
+    using Link = std::pair<int64_t, int64_t>;  // (role_id, dept_id)
+
+    // 角色增加自定义部门（sys_role_dept 插入）；只丢弃包含这些角色的缓存条目
+    void linkDepts(std::span<const Link> links) {
+        if (links.empty()) return;
+        std::unique_lock lock(m_mutex);
+        std::vector<int64_t> roles;
+        for (const auto& [role_id, dept_id] : links) {
+            auto& depts = m_custom_depts[role_id];
+            if (std::find(depts.begin(), depts.end(), dept_id) == depts.end()) depts.push_back(dept_id);
+            roles.push_back(role_id);
+        }
+        evictRoles(roles);
+    }
+
+    // 角色移除自定义部门；roles中的角色移除全部自定义部门
+    void unlinkDepts(std::span<const Link> links, std::span<const int64_t> roles = {}) {
+        if (links.empty() && roles.empty()) return;
+        std::unique_lock lock(m_mutex);
+        std::vector<int64_t> touched(roles.begin(), roles.end());
+        for (int64_t role_id : roles) m_custom_depts.erase(role_id);
+        for (const auto& [role_id, dept_id] : links) {
+            auto depts = m_custom_depts.find(role_id);
+            if (depts == m_custom_depts.end()) continue;
+            depts->second.erase(std::remove(depts->second.begin(), depts->second.end(), dept_id), depts->second.end());
+            touched.push_back(role_id);
+        }
+        evictRoles(touched);
+    }
+
+    void clear() {
+        std::unique_lock lock(m_mutex);
+        m_cache.clear();
+    }
+
+    Stats stats() const {
+        std::shared_lock lock(m_mutex);
+        return {m_hits.load(), m_misses.load(), m_cache.size()};
+    }
+
+private:
+    struct Key {
+        std::vector<int64_t> role_ids;
+        int64_t dept_id = 0;
+        bool operator==(const Key& other) const = default;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            size_t seed = std::hash<int64_t>{}(key.dept_id);
+            for (int64_t id : key.role_ids) seed ^= std::hash<int64_t>{}(id) + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+            return seed;
+        }
+    };
+
+    struct Entry {
+        std::shared_ptr<const CompiledDataScope> scope;
+        bool uses_tree = false;  // 依赖部门树（含"本部门及以下"角色）
+    };
+
+    static constexpr std::array<const char*, 2> TABLES = {"sys_role", "sys_role_dept"};
+
+    // 停用或已删除的角色不授予数据
+    void applyRoles(const std::vector<entity::SysRole>& roles) {
+        m_scopes.clear();
+        for (const auto& role : roles) {
+            if (role.status == '0' && role.del_flag == '0') m_scopes[role.role_id] = role.data_scope;
+        }
+    }
+
+    void applyRoleDepts(const std::vector<entity::SysRoleDept>& role_depts) {
+        m_custom_depts.clear();
+        for (const auto& link : role_depts) m_custom_depts[link.role_id].push_back(link.dept_id);
+    }
+
+    template<typename Pred>
+    void evictIf(Pred pred) {
+        for (auto it = m_cache.begin(); it != m_cache.end();) {
+            if (pred(it->first, it->second)) {
+                it = m_cache.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    void evictRoles(std::vector<int64_t>& role_ids) {
+        std::sort(role_ids.begin(), role_ids.end());
+        role_ids.erase(std::unique(role_ids.begin(), role_ids.end()), role_ids.end());
+        evictIf([&](const Key& key, const Entry&) {
+            return std::any_of(key.role_ids.begin(), key.role_ids.end(),
+                               [&](int64_t id) { return std::binary_search(role_ids.begin(), role_ids.end(), id); });
+        });
+    }
+
+    Entry build(const Key& key) const {
+        auto scope = std::make_shared<CompiledDataScope>();
+        bool uses_tree = false;
+        for (int64_t role_id : key.role_ids) {
+            auto it = m_scopes.find(role_id);
+            if (it == m_scopes.end()) continue;
+            switch (it->second) {
+                case DATA_SCOPE_ALL:
+                    scope->all = true;
+                    break;
+                case DATA_SCOPE_CUSTOM: {
+                    auto custom = m_custom_depts.find(role_id);
+                    if (custom != m_custom_depts.end()) {
+                        scope->dept_ids.insert(scope->dept_ids.end(), custom->second.begin(), custom->second.end());
+                    }
+                    break;
+                }
+                case DATA_SCOPE_DEPT:
+                    scope->dept_ids.push_back(key.dept_id);
+                    break;
+                case DATA_SCOPE_DEPT_AND_CHILD: {
+                    uses_tree = true;
+                    auto ids = m_depts.descendants(key.dept_id);
+                    if (ids.empty()) ids.push_back(key.dept_id);
+                    scope->dept_ids.insert(scope->dept_ids.end(), ids.begin(), ids.end());
+                    break;
+                }
+                default:
+                    scope->self = true;
+                    break;
+            }
+        }
+        if (scope->all) {
+            scope->self = false;
+            scope->dept_ids.clear();
+            return {std::move(scope), false};
+        }
+
+        std::sort(scope->dept_ids.begin(), scope->dept_ids.end());
+        scope->dept_ids.erase(std::unique(scope->dept_ids.begin(), scope->dept_ids.end()), scope->dept_ids.end());
+        for (int64_t id : scope->dept_ids) {
+            if (!scope->ranges.empty() && scope->ranges.back().last + 1 == id) {
+                scope->ranges.back().last = id;
+            } else {
+                scope->ranges.push_back({id, id});
+            }
+        }
+        return {std::move(scope), uses_tree};
+    }
+
+    const DeptTree& m_depts;
+    mutable std::shared_mutex m_mutex;
+    std::unordered_map<int64_t, char> m_scopes;                      // 启用角色 → data_scope
+    std::unordered_map<int64_t, std::vector<int64_t>> m_custom_depts;  // 角色 → 自定义部门
+    std::unordered_map<Key, Entry, KeyHash> m_cache;
+    Generations m_generations{};
+    uint64_t m_dept_version = 0;
+    std::atomic<uint64_t> m_hits{0};
+    std::atomic<uint64_t> m_misses{0};
+};
+
+} // namespace rbac
+
+#endif // RBAC_DATA_SCOPE_HPP
@@ -0,0 +1,297 @@
+#ifndef RBAC_DEPT_TREE_HPP
+#define RBAC_DEPT_TREE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "entity/sys_entities.hpp"
+#include "orm_rttr.hpp"
+
+namespace rbac {
+
+// ========== 部门树 ==========
+// 由 sys_dept 的 parent_id 构建，按欧拉序为每个部门编号区间 [left, right]，子孙部门的区间严格落在祖先区间内，
+// "X 的全部子部门" 变为区间判断，替代 ancestors LIKE CONCAT('%,', id, ',%') 的全表扫描。
+// 编号之间预留间隔，新增部门与移动子树只在父部门的空闲区间内分配编号，间隔耗尽时才整体重新编号
+
+class DeptTree {
+public:
+    static constexpr uint64_t NUMBER_GAP = uint64_t{1} << 20;  // 整体编号时相邻编号的间隔
+    static constexpr uint64_t INSERT_STEP = NUMBER_GAP >> 6;    // 增量分配时的最大间隔，为后续兄弟部门留出空间
+
+    struct Interval {
+        uint64_t left = 0;
+        uint64_t right = 0;
+    };
+
+    struct Stats {
+        size_t depts = 0;
+        uint64_t renumbers = 0;  // 整体重新编号次数（含load）
+    };
+
+    DeptTree() {
+        m_nodes[ROOT].interval = {0, UINT64_MAX};
+    }
+
+    // 读取 sys_dept 之前调用，返回值交给load：读取与载入之间完成的写入使部门树仍被视为过期
+    uint64_t beginLoad() const {
+        return orm_rttr::TableGeneration::instance().current("sys_dept");
+    }
+
+    // 全量构建；已删除的部门不计入，父部门不存在的部门视为顶级部门。generation为读取前beginLoad的返回值
+    void load(const std::vector<entity::SysDept>& depts, uint64_t generation) {
+        std::unique_lock lock(m_mutex);
+        m_nodes.clear();
+        m_nodes[ROOT];
+        for (const auto& dept : depts) {
+            if (dept.del_flag == '2' || dept.dept_id == ROOT) continue;
+            m_nodes[dept.dept_id].parent_id = dept.parent_id;
+        }
+        for (auto& [dept_id, node] : m_nodes) {
+            if (dept_id == ROOT) continue;
+            if (node.parent_id == dept_id || !m_nodes.count(node.parent_id)) node.parent_id = ROOT;
+        }
+        for (auto& [dept_id, node] : m_nodes) {
+            if (dept_id != ROOT) m_nodes[node.parent_id].children.push_back(dept_id);
+        }
+        detachCycles();
+        renumber();
+        m_generation = generation;
+        ++m_version;
+    }
+
+    // 新增部门（作为父部门的最后一个子部门编号）；父部门不存在时作为顶级部门
+    void insert(const entity::SysDept& dept) {
+        std::unique_lock lock(m_mutex);
+        if (dept.dept_id == ROOT || m_nodes.count(dept.dept_id)) {
+            throw std::invalid_argument("Department already exists: " + std::to_string(dept.dept_id));
+        }
+        const int64_t parent_id = m_nodes.count(dept.parent_id) ? dept.parent_id : ROOT;
+        ++m_version;
+        auto gap = freeGap(parent_id);
+        Node& node = m_nodes[dept.dept_id];
+        node.parent_id = parent_id;
+        m_nodes[parent_id].children.push_back(dept.dept_id);
+        if (gap.second - gap.first < 3) {
+            renumber();
+            return;
+        }
+        const uint64_t step = std::min((gap.second - gap.first) / 3, INSERT_STEP);
+        node.interval = {gap.first + step, gap.first + 2 * step};
+        m_order.emplace(node.interval.left, dept.dept_id);
+    }
+
+    // 修改上级部门：子树整体移动到新父部门的空闲区间内重新编号
+    void move(int64_t dept_id, int64_t new_parent_id) {
+        std::unique_lock lock(m_mutex);
+        auto it = m_nodes.find(dept_id);
+        if (dept_id == ROOT || it == m_nodes.end()) {
+            throw std::invalid_argument("Department not found: " + std::to_string(dept_id));
+        }
+        if (!m_nodes.count(new_parent_id)) new_parent_id = ROOT;
+        Node& node = it->second;
+        if (node.parent_id == new_parent_id) return;
+        if (encloses(node.interval, m_nodes[new_parent_id].interval)) {
+            throw std::invalid_argument("Cannot move department under its own subtree: " + std::to_string(dept_id));
+        }
+
+        ++m_version;
+        auto subtree = collect(dept_id);
+        auto gap = freeGap(new_parent_id);
+        detach(dept_id);
+        node.parent_id = new_parent_id;
+        m_nodes[new_parent_id].children.push_back(dept_id);
+
+        const uint64_t slots = 2 * subtree.size() + 1;
+        if (gap.second - gap.first < slots) {
+            renumber();
+            return;
+        }
+        for (int64_t id : subtree) m_order.erase(m_nodes[id].interval.left);
+        uint64_t counter = gap.first;
+        number(dept_id, counter, std::min((gap.second - gap.first) / slots, INSERT_STEP));
+    }
+
+    // 删除部门及其全部子部门
+    void remove(int64_t dept_id) {
+        std::unique_lock lock(m_mutex);
+        if (dept_id == ROOT || !m_nodes.count(dept_id)) return;
+        ++m_version;
+        auto subtree = collect(dept_id);
+        detach(dept_id);
+        for (int64_t id : subtree) {
+            m_order.erase(m_nodes[id].interval.left);
+            m_nodes.erase(id);
+        }
+    }
+
+    bool contains(int64_t dept_id) const {
+        std::shared_lock lock(m_mutex);
+        return dept_id != ROOT && m_nodes.count(dept_id) != 0;
+    }
+
+    // dept_id 是否为 ancestor_id 本身或其子孙部门
+    bool inSubtree(int64_t dept_id, int64_t ancestor_id) const {
+        std::shared_lock lock(m_mutex);
+        auto dept = m_nodes.find(dept_id);
+        auto ancestor = m_nodes.find(ancestor_id);
+        if (dept == m_nodes.end() || ancestor == m_nodes.end() || dept_id == ROOT || ancestor_id == ROOT) return false;
+        return encloses(ancestor->second.interval, dept->second.interval);
+    }
+
+    std::optional<Interval> interval(int64_t dept_id) const {
+        std::shared_lock lock(m_mutex);
+        auto it = m_nodes.find(dept_id);
+        if (dept_id == ROOT || it == m_nodes.end()) return std::nullopt;
+        return it->second.interval;
+    }
+
+    // 部门及其全部子部门的id（按欧拉序）；部门不存在时为空
+    std::vector<int64_t> descendants(int64_t dept_id, bool include_self = true) const {
+        std::shared_lock lock(m_mutex);
+        std::vector<int64_t> ids;
+        auto it = m_nodes.find(dept_id);
+        if (dept_id == ROOT || it == m_nodes.end()) return ids;
+        const Interval& range = it->second.interval;
+        for (auto pos = m_order.lower_bound(range.left); pos != m_order.end() && pos->first < range.right; ++pos) {
+            if (include_self || pos->second != dept_id) ids.push_back(pos->second);
+        }
+        return ids;
+    }
+
+    // 与 sys_dept.ancestors 相同格式的祖级列表，如 "0,100,101"；部门不存在时为空
+    std::string ancestors(int64_t dept_id) const {
+        std::shared_lock lock(m_mutex);
+        auto it = m_nodes.find(dept_id);
+        if (dept_id == ROOT || it == m_nodes.end()) return {};
+        std::vector<int64_t> chain;
+        for (int64_t parent = it->second.parent_id; parent != ROOT; parent = m_nodes.at(parent).parent_id) {
+            chain.push_back(parent);
+        }
+        std::string result = "0";
+        for (auto pos = chain.rbegin(); pos != chain.rend(); ++pos) result += "," + std::to_string(*pos);
+        return result;
+    }
+
+    // 追加 column IN (部门及其全部子部门)；部门不在树中时只匹配其本身
+    template<typename Entity>
+    void applyTo(orm_rttr::QueryWrapper<Entity>& wrapper, const std::string& column, int64_t dept_id) const {
+        auto ids = descendants(dept_id);
+        if (ids.empty()) ids.push_back(dept_id);
+        wrapper.in(column, ids);
+    }
+
+    // 载入后 sys_dept 是否发生过写入
+    bool stale() const {
+        std::shared_lock lock(m_mutex);
+        return orm_rttr::TableGeneration::instance().current("sys_dept") != m_generation;
+    }
+
+    // 调用方完成insert/move/remove后确认与 sys_dept 已同步。generation为自身写语句执行完成后、
+    // 修改部门树之前beginLoad的返回值，此后完成的其他写入使部门树仍被视为过期
+    void markSynced(uint64_t generation) {
+        std::unique_lock lock(m_mutex);
+        m_generation = generation;
+    }
+
+    // 每次load/insert/move/remove后递增，依赖子部门集合的缓存据此失效
+    uint64_t version() const { return m_version.load(std::memory_order_acquire); }
+
+    Stats stats() const {
+        std::shared_lock lock(m_mutex);
+        return {m_nodes.empty() ? 0 : m_nodes.size() - 1, m_renumbers};
+    }
+
+private:
+    static constexpr int64_t ROOT = 0;  // 虚拟根，对应 ancestors 中的 0
+
+    struct Node {
+        int64_t parent_id = ROOT;
+        std::vector<int64_t> children;
+        Interval interval;
+    };
+
+    static bool encloses(const Interval& outer, const Interval& inner) {
+        return outer.left <= inner.left && inner.right <= outer.right;
+    }
+
+    // 父部门区间内最后一个子部门之后的空闲编号区间（开区间）
+    std::pair<uint64_t, uint64_t> freeGap(int64_t parent_id) const {
+        const Node& parent = m_nodes.at(parent_id);
+        uint64_t lo = parent.interval.left;
+        for (int64_t child : parent.children) {
+            auto it = m_nodes.find(child);
+            if (it != m_nodes.end() && it->second.interval.right < parent.interval.right) {
+                lo = std::max(lo, it->second.interval.right);
+            }
+        }
+        return {lo, parent.interval.right};
+    }
+
+    std::vector<int64_t> collect(int64_t dept_id) const {
+        std::vector<int64_t> subtree{dept_id};
+        for (size_t i = 0; i < subtree.size(); ++i) {
+            for (int64_t child : m_nodes.at(subtree[i]).children) subtree.push_back(child);
+        }
+        return subtree;
+    }
+
+    void detach(int64_t dept_id) {
+        auto& siblings = m_nodes[m_nodes[dept_id].parent_id].children;
+        siblings.erase(std::remove(siblings.begin(), siblings.end(), dept_id), siblings.end());
+    }
+
+    // parent_id 成环的部门从根不可达，将其挂到根下
+    void detachCycles() {
+        std::vector<int64_t> reachable = collect(ROOT);
+        if (reachable.size() == m_nodes.size()) return;
+        std::unordered_map<int64_t, bool> seen;
+        for (int64_t id : reachable) seen[id] = true;
+        for (auto& [dept_id, node] : m_nodes) {
+            if (seen.count(dept_id)) continue;
+            detach(dept_id);
+            node.parent_id = ROOT;
+            m_nodes[ROOT].children.push_back(dept_id);
+            for (int64_t id : collect(dept_id)) seen[id] = true;
+        }
+    }
+
+    // 从 counter 开始按 step 为子树编号
+    void number(int64_t dept_id, uint64_t& counter, uint64_t step) {
+        Node& node = m_nodes[dept_id];
+        counter += step;
+        node.interval.left = counter;
+        if (dept_id != ROOT) m_order.emplace(counter, dept_id);
+        for (int64_t child : node.children) number(child, counter, step);
+        counter += step;
+        node.interval.right = counter;
+    }
+
+    void renumber() {
+        m_order.clear();
+        uint64_t counter = 0;
+        number(ROOT, counter, NUMBER_GAP);
+        m_nodes[ROOT].interval.right = UINT64_MAX;  // 根区间不设上限，顶级部门总能追加
+        ++m_renumbers;
+    }
+
+    mutable std::shared_mutex m_mutex;
+    std::unordered_map<int64_t, Node> m_nodes;
+    std::map<uint64_t, int64_t> m_order;  // 左编号 → 部门id
+    uint64_t m_generation = 0;
+    uint64_t m_renumbers = 0;
+    std::atomic<uint64_t> m_version{0};
+};
+
+} // namespace rbac
+
+#endif // RBAC_DEPT_TREE_HPP
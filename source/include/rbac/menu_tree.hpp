@@ -0,0 +1,291 @@
+#ifndef RBAC_MENU_TREE_HPP
+#define RBAC_MENU_TREE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <boost/json.hpp>
+#include "entity/sys_entities.hpp"
+#include "orm_rttr.hpp"
+#include "rbac/permission_index.hpp"
+
+namespace rbac {
+
+// ========== 菜单树 ==========
+// sys_menu 全部载入内存，子菜单按 order_num 预先排好序；每个不同的角色组合只构建一次有序菜单树，
+// 缓存序列化后的JSON，登录与刷新页面时只需查表并复制字符串，不再执行 getUserMenusSql 并按 parent_id 重新组树
+
+class MenuTreeService {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t builds = 0;
+        size_t menus = 0;      // 可进入菜单树的菜单数（启用的目录与菜单）
+        size_t role_sets = 0;  // 已缓存的角色组合数
+    };
+
+    using Generations = std::map<std::string, uint64_t>;  // sys_menu, sys_role, sys_role_menu
+
+    // 读取源表之前调用，返回值交给load/reload*：读取与载入之间完成的写入使对应的表仍被视为过期
+    Generations beginLoad() const {
+        Generations generations;
+        for (const char* table : {"sys_menu", "sys_role", "sys_role_menu"}) {
+            generations[table] = orm_rttr::TableGeneration::instance().current(table);
+        }
+        return generations;
+    }
+
+    // 全量载入；按钮（F）与停用菜单不进入菜单树，停用或已删除的角色不授予菜单
+    // generations为读取前beginLoad的返回值
+    void load(const std::vector<entity::SysMenu>& menus, const std::vector<entity::SysRole>& roles,
+              const std::vector<entity::SysRoleMenu>& role_menus, const Generations& generations) {
+        std::unique_lock lock(m_mutex);
+        m_generations = generations;
+        applyMenus(menus);
+        applyRoles(roles, role_menus);
+        resetCache();
+    }
+
+    void reloadMenus(const std::vector<entity::SysMenu>& menus, const Generations& generations) {
+        std::unique_lock lock(m_mutex);
+        keep(generations, {"sys_menu"});
+        applyMenus(menus);
+        resetCache();
+    }
+
+    void reloadRoles(const std::vector<entity::SysRole>& roles, const std::vector<entity::SysRoleMenu>& role_menus,
+                     const Generations& generations) {
+        std::unique_lock lock(m_mutex);
+        keep(generations, {"sys_role", "sys_role_menu"});
+        applyRoles(roles, role_menus);
+        resetCache();
+    }
+
+    // 载入后发生过写入的相关表
+    std::vector<std::string> staleTables() const {
+        std::shared_lock lock(m_mutex);
+        std::vector<std::string> stale;
+        for (const auto& [table, generation] : m_generations) {
+            if (orm_rttr::TableGeneration::instance().current(table) != generation) stale.push_back(table);
+        }
+        return stale;
+    }
+
+    // 角色组合可见的菜单树（JSON数组），role_ids无需有序；含超级管理员角色时为全部菜单
+    std::shared_ptr<const std::string> tree(std::vector<int64_t> role_ids) {
+        std::sort(role_ids.begin(), role_ids.end());
+        role_ids.erase(std::unique(role_ids.begin(), role_ids.end()), role_ids.end());
+
+        uint64_t epoch = 0;
+        std::shared_ptr<const std::string> json;
+        {
+            std::shared_lock lock(m_mutex);
+            // 只保留启用的角色，停用角色不同的用户共享同一条目
+            std::vector<int64_t> key;
+            bool admin = false;
+            for (int64_t role_id : role_ids) {
+                auto role = m_admin_roles.find(role_id);
+                if (role == m_admin_roles.end()) continue;
+                admin = admin || role->second;
+                key.push_back(role_id);
+            }
+            if (admin) key = {ALL_MENUS};
+            auto cached = m_trees.find(key);
+            if (cached != m_trees.end()) {
+                ++m_hits;
+                return cached->second;
+            }
+            json = build(key);
+            epoch = m_epoch;
+            role_ids = std::move(key);
+        }
+
+        std::unique_lock lock(m_mutex);
+        ++m_builds;
+        if (epoch != m_epoch) return json;  // 构建期间重新载入过，结果不入缓存
+        return m_trees.emplace(std::move(role_ids), std::move(json)).first->second;
+    }
+
+    // 角色增加菜单（sys_role_menu 插入），links为(role_id, menu_id)；只丢弃包含这些角色的角色组合
+    void linkMenus(std::span<const PermissionIndex::Link> links) {
+        if (links.empty()) return;
+        std::unique_lock lock(m_mutex);
+        std::vector<int64_t> roles;
+        for (const auto& [role_id, menu_id] : links) {
+            auto& menus = m_role_menus[role_id];
+            if (std::find(menus.begin(), menus.end(), menu_id) == menus.end()) menus.push_back(menu_id);
+            roles.push_back(role_id);
+        }
+        evictRoles(roles);
+    }
+
+    // 角色移除菜单，links为(role_id, menu_id)；roles中的角色移除全部菜单
+    void unlinkMenus(std::span<const PermissionIndex::Link> links, std::span<const int64_t> roles = {}) {
+        if (links.empty() && roles.empty()) return;
+        std::unique_lock lock(m_mutex);
+        std::vector<int64_t> touched(roles.begin(), roles.end());
+        for (int64_t role_id : roles) m_role_menus.erase(role_id);
+        for (const auto& [role_id, menu_id] : links) {
+            auto menus = m_role_menus.find(role_id);
+            if (menus == m_role_menus.end()) continue;
+            menus->second.erase(std::remove(menus->second.begin(), menus->second.end(), menu_id), menus->second.end());
+            touched.push_back(role_id);
+        }
+        evictRoles(touched);
+    }
+
+    // 用户的菜单树（角色取自权限索引）
+    std::shared_ptr<const std::string> treeForUser(const PermissionIndex& index, int64_t user_id) {
+        return tree(index.roles(user_id));
+    }
+
+    void clear() {
+        std::unique_lock lock(m_mutex);
+        resetCache();
+    }
+
+    Stats stats() const {
+        std::shared_lock lock(m_mutex);
+        return {m_hits.load(), m_builds.load(), m_menus.size(), m_trees.size()};
+    }
+
+private:
+    static constexpr int64_t ALL_MENUS = -1;  // 超级管理员的缓存键
+
+    struct Menu {
+        entity::SysMenu row;
+        std::vector<uint32_t> children;  // 按 order_num, menu_id 排序的子菜单下标
+    };
+
+    // 只记录本次重新载入的表的世代
+    void keep(const Generations& generations, std::initializer_list<const char*> tables) {
+        for (const char* table : tables) {
+            if (auto it = generations.find(table); it != generations.end()) m_generations[table] = it->second;
+        }
+    }
+
+    void applyMenus(const std::vector<entity::SysMenu>& menus) {
+        m_menus.clear();
+        m_roots.clear();
+        m_index.clear();
+        for (const auto& menu : menus) {
+            if (menu.status != '0' || menu.menu_type == 'F') continue;
+            m_index.emplace(menu.menu_id, static_cast<uint32_t>(m_menus.size()));
+            m_menus.push_back({menu, {}});
+        }
+        std::vector<uint32_t> order(m_menus.size());
+        for (uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            const auto& x = m_menus[a].row;
+            const auto& y = m_menus[b].row;
+            return x.order_num != y.order_num ? x.order_num < y.order_num : x.menu_id < y.menu_id;
+        });
+        // 父菜单不存在（停用或为按钮）的菜单不可达，与按 parent_id 从根逐层组树的结果一致
+        for (uint32_t i : order) {
+            const int64_t parent_id = m_menus[i].row.parent_id;
+            if (parent_id == 0) {
+                m_roots.push_back(i);
+                continue;
+            }
+            auto parent = m_index.find(parent_id);
+            if (parent != m_index.end() && parent->second != i) m_menus[parent->second].children.push_back(i);
+        }
+    }
+
+    void applyRoles(const std::vector<entity::SysRole>& roles, const std::vector<entity::SysRoleMenu>& role_menus) {
+        m_admin_roles.clear();
+        for (const auto& role : roles) {
+            if (role.status == '0' && role.del_flag == '0') m_admin_roles[role.role_id] = role.role_key == ADMIN_ROLE_KEY;
+        }
+        m_role_menus.clear();
+        for (const auto& link : role_menus) m_role_menus[link.role_id].push_back(link.menu_id);
+    }
+
+    void resetCache() {
+        m_trees.clear();
+        ++m_epoch;
+    }
+
+    // 超级管理员的条目不依赖角色菜单关联，保留
+    void evictRoles(std::vector<int64_t>& role_ids) {
+        std::sort(role_ids.begin(), role_ids.end());
+        role_ids.erase(std::unique(role_ids.begin(), role_ids.end()), role_ids.end());
+        for (auto it = m_trees.begin(); it != m_trees.end();) {
+            if (std::any_of(it->first.begin(), it->first.end(),
+                            [&](int64_t id) { return std::binary_search(role_ids.begin(), role_ids.end(), id); })) {
+                it = m_trees.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        ++m_epoch;
+    }
+
+    // O(n)：标记可见菜单后从根按预排序的子菜单深度优先输出
+    std::shared_ptr<const std::string> build(const std::vector<int64_t>& key) const {
+        std::vector<bool> visible(m_menus.size(), key.size() == 1 && key.front() == ALL_MENUS);
+        for (int64_t role_id : key) {
+            auto menus = m_role_menus.find(role_id);
+            if (menus == m_role_menus.end()) continue;
+            for (int64_t menu_id : menus->second) {
+                auto it = m_index.find(menu_id);
+                if (it != m_index.end()) visible[it->second] = true;
+            }
+        }
+        boost::json::array roots;
+        for (uint32_t i : m_roots) {
+            if (visible[i]) roots.push_back(node(i, visible));
+        }
+        return std::make_shared<const std::string>(boost::json::serialize(roots));
+    }
+
+    boost::json::object node(uint32_t i, const std::vector<bool>& visible) const {
+        const entity::SysMenu& menu = m_menus[i].row;
+        boost::json::object json;
+        json["menuId"] = menu.menu_id;
+        json["menuName"] = menu.menu_name;
+        json["parentId"] = menu.parent_id;
+        json["orderNum"] = menu.order_num;
+        json["path"] = menu.path;
+        json["component"] = menu.component;
+        json["query"] = menu.query;
+        json["routeName"] = menu.route_name;
+        json["isFrame"] = menu.is_frame;
+        json["isCache"] = menu.is_cache;
+        json["menuType"] = std::string(1, menu.menu_type);
+        json["visible"] = std::string(1, menu.visible);
+        json["perms"] = menu.perms;
+        json["icon"] = menu.icon;
+        boost::json::array children;
+        for (uint32_t child : m_menus[i].children) {
+            if (visible[child]) children.push_back(node(child, visible));
+        }
+        json["children"] = std::move(children);
+        return json;
+    }
+
+    mutable std::shared_mutex m_mutex;
+    std::vector<Menu> m_menus;
+    std::vector<uint32_t> m_roots;                                  // 顶级菜单，已排序
+    std::unordered_map<int64_t, uint32_t> m_index;                  // menu_id → 下标
+    std::unordered_map<int64_t, bool> m_admin_roles;                // 启用角色 → 是否超级管理员
+    std::unordered_map<int64_t, std::vector<int64_t>> m_role_menus;
+    std::map<std::vector<int64_t>, std::shared_ptr<const std::string>> m_trees;  // 角色组合 → 菜单树JSON
+    std::map<std::string, uint64_t> m_generations;
+    uint64_t m_epoch = 0;  // 每次载入递增，丢弃基于旧数据构建的结果
+    std::atomic<uint64_t> m_hits{0};
+    std::atomic<uint64_t> m_builds{0};
+};
+
+} // namespace rbac
+
+#endif // RBAC_MENU_TREE_HPP
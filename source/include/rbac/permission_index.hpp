@@ -0,0 +1,452 @@
+#ifndef RBAC_PERMISSION_INDEX_HPP
+#define RBAC_PERMISSION_INDEX_HPP
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <initializer_list>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "entity/sys_entities.hpp"
+#include "orm_rttr.hpp"
+
+namespace rbac {
+
+// ========== 权限索引 ==========
+// 将 sys_menu / sys_role / sys_role_menu / sys_user_role 载入内存：权限标识驻留为整数id，
+// 每个角色一个权限位集，用户按角色组合共享并集，鉴权时不再执行 getUserPermsSql 四表连接。
+// 比该SQL更严格：停用或已删除的角色（sys_role.status / del_flag）不授予权限，角色标识为 admin 时拥有全部权限
+
+inline constexpr std::string_view ALL_PERMISSION = "*:*:*";  // 全部权限标识
+inline constexpr std::string_view ADMIN_ROLE_KEY = "admin";   // 超级管理员角色，拥有全部权限
+
+// 按权限id置位的位集
+class PermBitset {
+public:
+    void set(uint32_t id) {
+        const size_t word = id / 64;
+        if (word >= m_words.size()) m_words.resize(word + 1);
+        m_words[word] |= uint64_t{1} << (id % 64);
+    }
+
+    bool test(uint32_t id) const {
+        const size_t word = id / 64;
+        return word < m_words.size() && ((m_words[word] >> (id % 64)) & 1) != 0;
+    }
+
+    PermBitset& operator|=(const PermBitset& other) {
+        if (other.m_words.size() > m_words.size()) m_words.resize(other.m_words.size());
+        for (size_t i = 0; i < other.m_words.size(); ++i) m_words[i] |= other.m_words[i];
+        return *this;
+    }
+
+    size_t count() const {
+        size_t total = 0;
+        for (uint64_t word : m_words) total += static_cast<size_t>(std::popcount(word));
+        return total;
+    }
+
+    template<typename Fn>
+    void forEach(Fn&& fn) const {
+        for (size_t i = 0; i < m_words.size(); ++i) {
+            for (uint64_t word = m_words[i]; word != 0; word &= word - 1) {
+                fn(static_cast<uint32_t>(i * 64 + static_cast<size_t>(std::countr_zero(word))));
+            }
+        }
+    }
+
+private:
+    std::vector<uint64_t> m_words;
+};
+
+class PermissionIndex {
+public:
+    using Link = std::pair<int64_t, int64_t>;  // 关联表的一行：(所有者ID, 被关联ID)
+
+    struct Stats {
+        size_t perms = 0;      // 驻留的权限标识数
+        size_t roles = 0;      // 启用的角色数
+        size_t users = 0;      // 有角色的用户数
+        size_t role_sets = 0;  // 不同的角色组合数（即权限并集数）
+    };
+
+    using Generations = std::vector<std::pair<std::string_view, uint64_t>>;
+
+    // 读取源表之前调用，返回值交给load/reload*：读取与载入之间完成的写入使对应的表仍被视为过期
+    Generations beginLoad() const {
+        Generations generations;
+        for (const char* table : TABLES) generations.emplace_back(table, orm_rttr::TableGeneration::instance().current(table));
+        return generations;
+    }
+
+    // 全量构建；generations为读取前beginLoad的返回值
+    void load(const std::vector<entity::SysMenu>& menus, const std::vector<entity::SysRole>& roles,
+              const std::vector<entity::SysRoleMenu>& role_menus, const std::vector<entity::SysUserRole>& user_roles,
+              const Generations& generations) {
+        std::lock_guard writer(m_writer);
+        auto state = std::make_shared<State>();
+        applyMenus(*state, menus);
+        applyRoles(*state, roles, role_menus);
+        applyUserRoles(*state, user_roles);
+        buildRolePerms(*state);
+        buildGrants(*state);
+        publish(std::move(state), generations);
+    }
+
+    // 菜单表变化：重新驻留权限标识（已有标识的id不变）并重建角色位集
+    void reloadMenus(const std::vector<entity::SysMenu>& menus, const Generations& generations) {
+        rebuild(only(generations, {"sys_menu"}), [&](State& state) {
+            applyMenus(state, menus);
+            buildRolePerms(state);
+            buildGrants(state);
+        });
+    }
+
+    // 角色表或角色菜单关联变化：重建角色位集
+    void reloadRoles(const std::vector<entity::SysRole>& roles, const std::vector<entity::SysRoleMenu>& role_menus,
+                     const Generations& generations) {
+        rebuild(only(generations, {"sys_role", "sys_role_menu"}), [&](State& state) {
+            applyRoles(state, roles, role_menus);
+            buildRolePerms(state);
+            buildGrants(state);
+        });
+    }
+
+    // 用户角色关联变化：角色位集不变，只重新组合用户的并集
+    void reloadUserRoles(const std::vector<entity::SysUserRole>& user_roles, const Generations& generations) {
+        rebuild(only(generations, {"sys_user_role"}), [&](State& state) {
+            applyUserRoles(state, user_roles);
+            buildGrants(state);
+        });
+    }
+
+    // 单个用户的角色变化（如用户授权后）
+    void setUserRoles(int64_t user_id, std::vector<int64_t> role_ids) {
+        rebuild({}, [&](State& state) {
+            std::sort(role_ids.begin(), role_ids.end());
+            role_ids.erase(std::unique(role_ids.begin(), role_ids.end()), role_ids.end());
+            if (role_ids.empty()) {
+                state.user_roles.erase(user_id);
+                state.user_grants.erase(user_id);
+            } else {
+                state.user_roles[user_id] = role_ids;
+                state.user_grants[user_id] = grantFor(state, role_ids);
+            }
+        });
+    }
+
+    // 用户增加角色（sys_user_role 插入），links为(user_id, role_id)；一批只重建一次，只重新组合涉及的用户
+    void grantRoles(std::span<const Link> links) {
+        if (links.empty()) return;
+        rebuild({}, [&](State& state) {
+            std::vector<int64_t> users;
+            for (const auto& [user_id, role_id] : links) {
+                auto& roles = state.user_roles[user_id];
+                auto pos = std::lower_bound(roles.begin(), roles.end(), role_id);
+                if (pos != roles.end() && *pos == role_id) continue;
+                roles.insert(pos, role_id);
+                users.push_back(user_id);
+            }
+            regrantUsers(state, users);
+        });
+    }
+
+    // 用户移除角色，links为(user_id, role_id)；users中的用户移除全部角色（按用户ID删除关联）
+    void revokeRoles(std::span<const Link> links, std::span<const int64_t> users = {}) {
+        if (links.empty() && users.empty()) return;
+        rebuild({}, [&](State& state) {
+            std::vector<int64_t> touched(users.begin(), users.end());
+            for (int64_t user_id : users) state.user_roles.erase(user_id);
+            for (const auto& [user_id, role_id] : links) {
+                auto user = state.user_roles.find(user_id);
+                if (user == state.user_roles.end()) continue;
+                auto& roles = user->second;
+                roles.erase(std::remove(roles.begin(), roles.end(), role_id), roles.end());
+                touched.push_back(user_id);
+            }
+            regrantUsers(state, touched);
+        });
+    }
+
+    // 角色增加菜单（sys_role_menu 插入），links为(role_id, menu_id)；只重建涉及角色的位集与持有它们的用户
+    void linkMenus(std::span<const Link> links) {
+        if (links.empty()) return;
+        rebuild({}, [&](State& state) {
+            std::vector<int64_t> roles;
+            for (const auto& [role_id, menu_id] : links) {
+                auto& menus = state.role_menus[role_id];
+                if (std::find(menus.begin(), menus.end(), menu_id) != menus.end()) continue;
+                menus.push_back(menu_id);
+                roles.push_back(role_id);
+            }
+            rebuildRoles(state, roles);
+        });
+    }
+
+    // 角色移除菜单，links为(role_id, menu_id)；roles中的角色移除全部菜单
+    void unlinkMenus(std::span<const Link> links, std::span<const int64_t> roles = {}) {
+        if (links.empty() && roles.empty()) return;
+        rebuild({}, [&](State& state) {
+            std::vector<int64_t> touched(roles.begin(), roles.end());
+            for (int64_t role_id : roles) state.role_menus.erase(role_id);
+            for (const auto& [role_id, menu_id] : links) {
+                auto menus = state.role_menus.find(role_id);
+                if (menus == state.role_menus.end()) continue;
+                menus->second.erase(std::remove(menus->second.begin(), menus->second.end(), menu_id), menus->second.end());
+                touched.push_back(role_id);
+            }
+            rebuildRoles(state, touched);
+        });
+    }
+
+    // 载入后发生过写入的相关表，调用方据此选择reload*
+    std::vector<std::string> staleTables() const {
+        std::shared_lock lock(m_mutex);
+        std::vector<std::string> stale;
+        for (const char* table : TABLES) {
+            auto it = m_generations.find(table);
+            if (it == m_generations.end() || orm_rttr::TableGeneration::instance().current(table) != it->second) {
+                stale.emplace_back(table);
+            }
+        }
+        return stale;
+    }
+
+    bool hasPerm(int64_t user_id, std::string_view perm) const {
+        std::shared_lock lock(m_mutex);
+        const State& state = *m_state;
+        auto user = state.user_grants.find(user_id);
+        if (user == state.user_grants.end()) return false;
+        const Grant& grant = *user->second;
+        if (grant.all) return true;
+        auto id = state.perm_ids.find(perm);
+        return id != state.perm_ids.end() && grant.perms.test(id->second);
+    }
+
+    // 用户的角色id（有序，含停用角色）
+    std::vector<int64_t> roles(int64_t user_id) const {
+        std::shared_lock lock(m_mutex);
+        auto user = m_state->user_roles.find(user_id);
+        return user == m_state->user_roles.end() ? std::vector<int64_t>{} : user->second;
+    }
+
+    bool isAdmin(int64_t user_id) const {
+        std::shared_lock lock(m_mutex);
+        auto user = m_state->user_grants.find(user_id);
+        return user != m_state->user_grants.end() && user->second->all;
+    }
+
+    // 用户的权限标识集合：只统计正常且未删除的角色，逗号分隔的 perms 拆为多个标识；管理员返回 *:*:*。
+    // getUserPermsSql 不过滤角色状态，也不识别管理员，两者结果可能不同
+    std::vector<std::string> perms(int64_t user_id) const {
+        std::shared_lock lock(m_mutex);
+        const State& state = *m_state;
+        std::vector<std::string> result;
+        auto user = state.user_grants.find(user_id);
+        if (user == state.user_grants.end()) return result;
+        if (user->second->all) return {std::string(ALL_PERMISSION)};
+        user->second->perms.forEach([&](uint32_t id) { result.push_back(state.perm_names[id]); });
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    Stats stats() const {
+        std::shared_lock lock(m_mutex);
+        return {m_state->perm_names.size(), m_state->active_roles.size(), m_state->user_grants.size(), m_state->role_sets.size()};
+    }
+
+private:
+    // 一组角色的权限并集，同一角色组合的用户共享
+    struct Grant {
+        PermBitset perms;
+        bool all = false;
+    };
+
+    struct State {
+        // 源数据（增量重建使用）
+        std::vector<std::string> perm_names;
+        std::unordered_map<std::string, uint32_t, orm_rttr::internal::StringHash, std::equal_to<>> perm_ids;
+        std::unordered_map<int64_t, std::vector<uint32_t>> menu_perms;   // 启用菜单的权限id
+        std::unordered_map<int64_t, bool> active_roles;                  // 启用角色 → 是否超级管理员
+        std::unordered_map<int64_t, std::vector<int64_t>> role_menus;
+        std::unordered_map<int64_t, std::vector<int64_t>> user_roles;    // 有序去重
+
+        // 派生数据
+        std::unordered_map<int64_t, PermBitset> role_perms;
+        std::map<std::vector<int64_t>, std::shared_ptr<const Grant>> role_sets;
+        std::unordered_map<int64_t, std::shared_ptr<const Grant>> user_grants;
+    };
+
+    static constexpr const char* TABLES[] = {"sys_menu", "sys_role", "sys_role_menu", "sys_user_role"};
+
+    // beginLoad结果中本次重新载入的表
+    static Generations only(const Generations& generations, std::initializer_list<std::string_view> tables) {
+        Generations selected;
+        for (const auto& entry : generations) {
+            if (std::find(tables.begin(), tables.end(), entry.first) != tables.end()) selected.push_back(entry);
+        }
+        return selected;
+    }
+
+    static uint32_t intern(State& state, std::string_view perm) {
+        auto it = state.perm_ids.find(perm);
+        if (it != state.perm_ids.end()) return it->second;
+        const auto id = static_cast<uint32_t>(state.perm_names.size());
+        state.perm_names.emplace_back(perm);
+        state.perm_ids.emplace(state.perm_names.back(), id);
+        return id;
+    }
+
+    // 停用菜单不授予权限；perms可为逗号分隔的多个标识
+    static void applyMenus(State& state, const std::vector<entity::SysMenu>& menus) {
+        state.menu_perms.clear();
+        for (const auto& menu : menus) {
+            if (menu.status != '0' || menu.perms.empty()) continue;
+            std::string_view rest = menu.perms;
+            while (!rest.empty()) {
+                const size_t comma = rest.find(',');
+                std::string_view perm = rest.substr(0, comma);
+                rest = comma == std::string_view::npos ? std::string_view{} : rest.substr(comma + 1);
+                while (!perm.empty() && perm.front() == ' ') perm.remove_prefix(1);
+                while (!perm.empty() && perm.back() == ' ') perm.remove_suffix(1);
+                if (!perm.empty()) state.menu_perms[menu.menu_id].push_back(intern(state, perm));
+            }
+        }
+    }
+
+    // 停用或已删除的角色不授予权限
+    static void applyRoles(State& state, const std::vector<entity::SysRole>& roles,
+                           const std::vector<entity::SysRoleMenu>& role_menus) {
+        state.active_roles.clear();
+        for (const auto& role : roles) {
+            if (role.status != '0' || role.del_flag != '0') continue;
+            state.active_roles[role.role_id] = role.role_key == ADMIN_ROLE_KEY;
+        }
+        state.role_menus.clear();
+        for (const auto& link : role_menus) state.role_menus[link.role_id].push_back(link.menu_id);
+    }
+
+    static void applyUserRoles(State& state, const std::vector<entity::SysUserRole>& user_roles) {
+        state.user_roles.clear();
+        for (const auto& link : user_roles) state.user_roles[link.user_id].push_back(link.role_id);
+        for (auto& [user_id, role_ids] : state.user_roles) {
+            std::sort(role_ids.begin(), role_ids.end());
+            role_ids.erase(std::unique(role_ids.begin(), role_ids.end()), role_ids.end());
+        }
+    }
+
+    static PermBitset rolePerms(const State& state, int64_t role_id) {
+        PermBitset perms;
+        auto menus = state.role_menus.find(role_id);
+        if (menus == state.role_menus.end()) return perms;
+        for (int64_t menu_id : menus->second) {
+            auto ids = state.menu_perms.find(menu_id);
+            if (ids == state.menu_perms.end()) continue;
+            for (uint32_t id : ids->second) perms.set(id);
+        }
+        return perms;
+    }
+
+    static void buildRolePerms(State& state) {
+        state.role_perms.clear();
+        state.role_sets.clear();
+        for (const auto& [role_id, is_admin] : state.active_roles) state.role_perms[role_id] = rolePerms(state, role_id);
+    }
+
+    // 一组角色的关联变化：重建其位集，丢弃包含它们的角色组合并重新组合持有它们的用户
+    static void rebuildRoles(State& state, std::vector<int64_t>& role_ids) {
+        std::sort(role_ids.begin(), role_ids.end());
+        role_ids.erase(std::unique(role_ids.begin(), role_ids.end()), role_ids.end());
+        role_ids.erase(std::remove_if(role_ids.begin(), role_ids.end(),
+                                      [&](int64_t role_id) { return !state.active_roles.count(role_id); }),
+                       role_ids.end());
+        if (role_ids.empty()) return;
+        for (int64_t role_id : role_ids) state.role_perms[role_id] = rolePerms(state, role_id);
+        auto holds_any = [&](const std::vector<int64_t>& held) {
+            return std::any_of(held.begin(), held.end(),
+                               [&](int64_t id) { return std::binary_search(role_ids.begin(), role_ids.end(), id); });
+        };
+        for (auto it = state.role_sets.begin(); it != state.role_sets.end();) {
+            if (holds_any(it->first)) {
+                it = state.role_sets.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        for (const auto& [user_id, held] : state.user_roles) {
+            if (holds_any(held)) state.user_grants[user_id] = grantFor(state, held);
+        }
+    }
+
+    // 角色关联变化后重新组合这些用户的并集，没有角色的用户移除
+    static void regrantUsers(State& state, std::vector<int64_t>& user_ids) {
+        std::sort(user_ids.begin(), user_ids.end());
+        user_ids.erase(std::unique(user_ids.begin(), user_ids.end()), user_ids.end());
+        for (int64_t user_id : user_ids) {
+            auto user = state.user_roles.find(user_id);
+            if (user == state.user_roles.end() || user->second.empty()) {
+                if (user != state.user_roles.end()) state.user_roles.erase(user);
+                state.user_grants.erase(user_id);
+            } else {
+                state.user_grants[user_id] = grantFor(state, user->second);
+            }
+        }
+    }
+
+    static std::shared_ptr<const Grant> grantFor(State& state, const std::vector<int64_t>& role_ids) {
+        auto cached = state.role_sets.find(role_ids);
+        if (cached != state.role_sets.end()) return cached->second;
+
+        auto grant = std::make_shared<Grant>();
+        auto all_id = state.perm_ids.find(ALL_PERMISSION);
+        for (int64_t role_id : role_ids) {
+            auto role = state.active_roles.find(role_id);
+            if (role == state.active_roles.end()) continue;
+            grant->all = grant->all || role->second;
+            grant->perms |= state.role_perms[role_id];
+        }
+        if (all_id != state.perm_ids.end() && grant->perms.test(all_id->second)) grant->all = true;
+        state.role_sets.emplace(role_ids, grant);
+        return grant;
+    }
+
+    static void buildGrants(State& state) {
+        state.user_grants.clear();
+        for (const auto& [user_id, role_ids] : state.user_roles) state.user_grants[user_id] = grantFor(state, role_ids);
+    }
+
+    // 复制当前状态并修改后整体替换，读取方不被阻塞于重建过程
+    template<typename Fn>
+    void rebuild(const Generations& generations, Fn&& fn) {
+        std::lock_guard writer(m_writer);
+        std::shared_ptr<State> state;
+        {
+            std::shared_lock lock(m_mutex);
+            state = std::make_shared<State>(*m_state);
+        }
+        fn(*state);
+        publish(std::move(state), generations);
+    }
+
+    void publish(std::shared_ptr<State> state, const Generations& generations) {
+        std::unique_lock lock(m_mutex);
+        for (const auto& [table, generation] : generations) m_generations[std::string(table)] = generation;
+        m_state = std::move(state);
+    }
+
+    mutable std::shared_mutex m_mutex;
+    std::mutex m_writer;  // 串行化重建
+    std::shared_ptr<const State> m_state = std::make_shared<const State>();
+    std::map<std::string, uint64_t, std::less<>> m_generations;  // 各源表在最近一次载入时的写入代数
+};
+
+} // namespace rbac
+
+#endif // RBAC_PERMISSION_INDEX_HPP
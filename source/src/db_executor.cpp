@@ -0,0 +1,370 @@
+#include "db_executor.hpp"
+#include <algorithm>
+#include <boost/asio/post.hpp>
+#include <exception>
+
+namespace orm_rttr {
+
+// ========== 连接与预编译语句缓存 ==========
+
+ResultSet DbConnection::execute(const SqlQueryResult& query) {
+    auto it = m_index.find(query.sql);
+    if (it != m_index.end()) {
+        ++m_hits;
+        m_statements.splice(m_statements.begin(), m_statements, it->second);
+        return it->second->second->execute(query.params);
+    }
+
+    ++m_misses;
+    auto statement = prepare(query.sql);
+    DbStatement& prepared = *statement;
+    if (m_capacity == 0) return prepared.execute(query.params);
+
+    m_statements.emplace_front(query.sql, std::move(statement));
+    m_index.emplace(m_statements.front().first, m_statements.begin());
+    if (m_statements.size() > m_capacity) {
+        m_index.erase(m_statements.back().first);
+        m_statements.pop_back();
+    }
+    return prepared.execute(query.params);
+}
+
+std::vector<ResultSet> DbConnection::executeBatch(const std::vector<SqlQueryResult>& queries) {
+    std::vector<ResultSet> results;
+    results.reserve(queries.size());
+    for (const auto& query : queries) results.push_back(execute(query));
+    return results;
+}
+
+void DbConnection::setStatementCacheCapacity(size_t capacity) {
+    m_capacity = capacity;
+    while (m_statements.size() > m_capacity) {
+        m_index.erase(m_statements.back().first);
+        m_statements.pop_back();
+    }
+}
+
+// ========== 连接池 ==========
+
+ConnectionPool::Lease& ConnectionPool::Lease::operator=(Lease&& other) noexcept {
+    if (this != &other) {
+        release();
+        m_pool = std::move(other.m_pool);
+        m_conn = std::move(other.m_conn);
+        m_broken = other.m_broken;
+    }
+    return *this;
+}
+
+void ConnectionPool::Lease::release() {
+    if (m_pool && m_conn) m_pool->giveBack(std::move(m_conn), m_broken);
+    m_pool.reset();
+}
+
+std::shared_ptr<ConnectionPool> ConnectionPool::create(std::shared_ptr<DbBackend> backend, PoolOptions options) {
+    return std::shared_ptr<ConnectionPool>(new ConnectionPool(std::move(backend), options));
+}
+
+ConnectionPool::Lease ConnectionPool::acquire() {
+    const auto deadline = std::chrono::steady_clock::now() + m_options.acquire_timeout;
+    std::unique_lock lock(m_mutex);
+    for (;;) {
+        if (!m_idle.empty()) {
+            IdleConnection idle = std::move(m_idle.back());
+            m_idle.pop_back();
+            if (std::chrono::steady_clock::now() - idle.since >= m_options.health_check_idle) {
+                lock.unlock();
+                bool alive = false;
+                try {
+                    alive = idle.conn->ping();
+                } catch (...) {
+                    alive = false;
+                }
+                lock.lock();
+                if (!alive) {
+                    --m_stats.open;
+                    ++m_stats.discarded;
+                    continue;
+                }
+            }
+            ++m_stats.acquired;
+            return Lease(shared_from_this(), std::move(idle.conn));
+        }
+
+        if (m_stats.open < m_options.max_connections) {
+            ++m_stats.open;
+            lock.unlock();
+            std::unique_ptr<DbConnection> conn;
+            try {
+                conn = m_backend->connect();
+            } catch (...) {
+                lock.lock();
+                --m_stats.open;
+                m_available.notify_one();
+                throw;
+            }
+            conn->setStatementCacheCapacity(m_options.statement_cache_size);
+            lock.lock();
+            ++m_stats.created;
+            ++m_stats.acquired;
+            return Lease(shared_from_this(), std::move(conn));
+        }
+
+        if (m_available.wait_until(lock, deadline) == std::cv_status::timeout
+            && m_idle.empty() && m_stats.open >= m_options.max_connections) {
+            ++m_stats.timeouts;
+            throw DbTimeoutError("Timed out acquiring database connection");
+        }
+    }
+}
+
+void ConnectionPool::giveBack(std::unique_ptr<DbConnection> conn, bool broken) {
+    {
+        std::lock_guard lock(m_mutex);
+        if (broken) {
+            --m_stats.open;
+            ++m_stats.discarded;
+        } else {
+            m_idle.push_back({std::move(conn), std::chrono::steady_clock::now()});
+        }
+    }
+    m_available.notify_one();
+}
+
+PoolStats ConnectionPool::stats() const {
+    std::lock_guard lock(m_mutex);
+    PoolStats stats = m_stats;
+    stats.idle = m_idle.size();
+    return stats;
+}
+
+// ========== 执行器 ==========
+
+DbExecutor::DbExecutor(std::shared_ptr<ConnectionPool> pool, size_t threads)
+    : m_pool(std::move(pool)), m_threads(threads) {}
+
+DbExecutor::~DbExecutor() {
+    m_threads.join();
+}
+
+namespace {
+
+// 写语句执行失败后结果是否未知：连接断开或超时时语句可能已在服务端执行，需按abandonWrite处理；
+// 普通语句错误（SQL错误、约束冲突）表示该语句未生效
+bool outcomeUnknown(const std::exception_ptr& error) {
+    try {
+        std::rethrow_exception(error);
+    } catch (const DbConnectionError&) {
+        return true;
+    } catch (const DbTimeoutError&) {
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+} // namespace
+
+boost::asio::awaitable<ResultSet> DbExecutor::query(SqlQueryResult query, ChangeTransaction* transaction) {
+    return withConnection([query = std::move(query), transaction](DbConnection& conn) {
+        ResultSet rs;
+        try {
+            rs = conn.execute(query);
+        } catch (...) {
+            if (outcomeUnknown(std::current_exception())) abandonWrite(query);
+            throw;
+        }
+        completeWrite(query, transaction);
+        return rs;
+    });
+}
+
+boost::asio::awaitable<std::vector<ResultSet>> DbExecutor::queryBatch(std::vector<SqlQueryResult> queries, BatchMode mode,
+                                                                     ChangeTransaction* transaction) {
+    if (mode == BatchMode::FanOut && queries.size() > 1) return fanOut(std::move(queries), transaction);
+    return withConnection([queries = std::move(queries), transaction](DbConnection& conn) {
+        std::vector<ResultSet> results;
+        try {
+            results = conn.executeBatch(queries);
+        } catch (...) {
+            // 规则同单条语句，但管道中途的普通语句错误也无法确定此前发出的语句是否已执行，
+            // 因此整批按结果未知处理：使缓存失效，变更事件只通知订阅方重新载入
+            for (const auto& query : queries) abandonWrite(query);
+            throw;
+        }
+        for (const auto& query : queries) completeWrite(query, transaction);
+        return results;
+    });
+}
+
+boost::asio::awaitable<std::vector<ResultSet>> DbExecutor::fanOut(std::vector<SqlQueryResult> queries,
+                                                                 ChangeTransaction* transaction) {
+    struct Gather {
+        std::vector<ResultSet> results;
+        std::vector<std::exception_ptr> errors;
+        std::atomic<size_t> remaining;
+        explicit Gather(size_t n) : results(n), errors(n), remaining(n) {}
+    };
+
+    // 每条语句投递到执行器线程池，最后完成的一条在等待方的执行器上恢复协程
+    return boost::asio::async_initiate<const boost::asio::use_awaitable_t<>&, void(std::exception_ptr, std::vector<ResultSet>)>(
+        [this, transaction](auto handler, std::vector<SqlQueryResult> queries) {
+            using Handler = decltype(handler);
+            auto gather = std::make_shared<Gather>(queries.size());
+            auto done = std::make_shared<Handler>(std::move(handler));
+            for (size_t i = 0; i < queries.size(); ++i) {
+                boost::asio::post(m_threads, [pool = m_pool, gather, done, i, transaction, query = std::move(queries[i])]() {
+                    try {
+                        auto lease = pool->acquire();
+                        try {
+                            gather->results[i] = lease->execute(query);
+                            completeWrite(query, transaction);
+                        } catch (const DbConnectionError&) {
+                            lease.invalidate();
+                            throw;
+                        }
+                    } catch (...) {
+                        gather->errors[i] = std::current_exception();
+                        if (outcomeUnknown(gather->errors[i])) abandonWrite(query);
+                    }
+                    if (gather->remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+                    std::exception_ptr error;
+                    for (const auto& e : gather->errors) {
+                        if (e) { error = e; break; }
+                    }
+                    auto ex = boost::asio::get_associated_executor(*done);
+                    boost::asio::post(ex, [done, error, gather]() {
+                        (*done)(error, error ? std::vector<ResultSet>{} : std::move(gather->results));
+                    });
+                });
+            }
+        }, boost::asio::use_awaitable, std::move(queries));
+}
+
+// ========== 读写分离 ==========
+
+void DbSession::markWrite() {
+    m_last_write.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_release);
+}
+
+bool DbSession::wroteWithin(std::chrono::milliseconds window) const {
+    const long long last = m_last_write.load(std::memory_order_acquire);
+    if (last == 0) return false;
+    const auto elapsed = std::chrono::steady_clock::now().time_since_epoch() - std::chrono::steady_clock::duration(last);
+    return elapsed < window;
+}
+
+DbRouter::DbRouter(std::shared_ptr<DbExecutor> primary, std::vector<std::shared_ptr<DbExecutor>> replicas,
+                   RoutingOptions options)
+    : m_primary(std::move(primary)), m_replicas(std::move(replicas)), m_options(options) {}
+
+StatementRoute DbRouter::route(const SqlQueryResult& query, const DbSession* session) const {
+    if (m_replicas.empty() || internal::resolve_route(query) == StatementRoute::Primary) return StatementRoute::Primary;
+    if (session && session->wroteWithin(m_options.sticky_window)) return StatementRoute::Primary;
+    return StatementRoute::Replica;
+}
+
+DbExecutor& DbRouter::nextReplica() {
+    return *m_replicas[m_next.fetch_add(1, std::memory_order_relaxed) % m_replicas.size()];
+}
+
+StatementRoute DbRouter::route(const std::vector<SqlQueryResult>& queries, const DbSession* session) const {
+    const bool primary = std::any_of(queries.begin(), queries.end(), [&](const SqlQueryResult& query) {
+        return route(query, session) == StatementRoute::Primary;
+    });
+    return primary || m_replicas.empty() ? StatementRoute::Primary : StatementRoute::Replica;
+}
+
+boost::asio::awaitable<ResultSet> DbRouter::query(SqlQueryResult query, DbSession* session, ChangeTransaction* transaction) {
+    const StatementRoute target = route(query, session);
+    const bool write = target == StatementRoute::Primary && writes(query);
+    co_return co_await dispatch(target, write, session, [&query, transaction](DbExecutor& executor) {
+        return executor.query(query, transaction);
+    });
+}
+
+boost::asio::awaitable<std::vector<ResultSet>> DbRouter::queryBatch(std::vector<SqlQueryResult> queries, BatchMode mode,
+                                                                   DbSession* session, ChangeTransaction* transaction) {
+    const StatementRoute target = route(queries, session);
+    const bool write = target == StatementRoute::Primary && std::any_of(queries.begin(), queries.end(), writes);
+    co_return co_await dispatch(target, write, session, [&queries, mode, transaction](DbExecutor& executor) {
+        return executor.queryBatch(queries, mode, transaction);
+    });
+}
+
+RouterStats DbRouter::stats() const {
+    return {m_writes.load(std::memory_order_relaxed), m_primary_reads.load(std::memory_order_relaxed),
+            m_replica_reads.load(std::memory_order_relaxed), m_fallbacks.load(std::memory_order_relaxed)};
+}
+
+// ========== 进程内后端 ==========
+
+struct MemoryBackend::State {
+    Handler handler;
+    std::atomic<uint64_t> epoch{0};
+    std::atomic<uint64_t> connects{0};
+    std::atomic<uint64_t> prepares{0};
+};
+
+namespace {
+
+class MemoryStatement : public DbStatement {
+public:
+    MemoryStatement(std::shared_ptr<MemoryBackend::State> state, std::string sql, uint64_t epoch)
+        : m_state(std::move(state)), m_sql(std::move(sql)), m_epoch(epoch) {}
+
+    ResultSet execute(const std::vector<ValueVariant>& params) override {
+        if (m_state->epoch.load() != m_epoch) throw DbConnectionError("Connection lost");
+        return m_state->handler(m_sql, params);
+    }
+
+private:
+    std::shared_ptr<MemoryBackend::State> m_state;
+    std::string m_sql;
+    uint64_t m_epoch;
+};
+
+class MemoryConnection : public DbConnection {
+public:
+    explicit MemoryConnection(std::shared_ptr<MemoryBackend::State> state)
+        : m_state(std::move(state)), m_epoch(m_state->epoch.load()) {}
+
+    bool ping() override { return m_state->epoch.load() == m_epoch; }
+
+protected:
+    std::unique_ptr<DbStatement> prepare(const std::string& sql) override {
+        if (!ping()) throw DbConnectionError("Connection lost");
+        ++m_state->prepares;
+        return std::make_unique<MemoryStatement>(m_state, sql, m_epoch);
+    }
+
+private:
+    std::shared_ptr<MemoryBackend::State> m_state;
+    uint64_t m_epoch;
+};
+
+} // namespace
+
+MemoryBackend::MemoryBackend(Handler handler) : m_state(std::make_shared<State>()) {
+    m_state->handler = std::move(handler);
+}
+
+std::unique_ptr<DbConnection> MemoryBackend::connect() {
+    ++m_state->connects;
+    return std::make_unique<MemoryConnection>(m_state);
+}
+
+void MemoryBackend::dropConnections() {
+    ++m_state->epoch;
+}
+
+uint64_t MemoryBackend::connects() const {
+    return m_state->connects.load();
+}
+
+uint64_t MemoryBackend::prepares() const {
+    return m_state->prepares.load();
+}
+
+} // namespace orm_rttr
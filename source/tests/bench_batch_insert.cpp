@@ -0,0 +1,151 @@
+#include <iostream>
+#include <sstream>
+#include <chrono>
+#include "entity/sys_entities.hpp"
+#include "entity/sys_entities_mapping.hpp"
+#include "orm_rttr.hpp"
+#include <doctest/doctest.h>
+
+namespace bench {
+
+/**
+ * 旧版批量插入实现（逐行遍历RTTR属性并用stringstream拼接），作为基准对照
+ */
+template<typename Entity>
+orm_rttr::SqlQueryResult legacyBatchInsert(std::vector<Entity>& entities) {
+    using namespace orm_rttr;
+    if (entities.empty()) return {"", {}};
+
+    rttr::type t = rttr::type::get<Entity>();
+    std::stringstream cols_sql, vals_sql;
+    std::vector<ValueVariant> params;
+    std::vector<rttr::property> props;
+
+    bool first = true;
+    for (auto& prop : t.get_properties()) {
+        if (prop.get_metadata(meta::AUTO_INCREMENT).to_bool()) continue;
+        if (!first) cols_sql << ", ";
+        cols_sql << "`" << internal::get_column_name(prop) << "`";
+        props.push_back(prop);
+        first = false;
+    }
+
+    for (Entity& entity : entities) {
+        if (!vals_sql.str().empty()) vals_sql << ",";
+        vals_sql << "(";
+        first = true;
+        for (const auto& prop : props) {
+            if (!first) vals_sql << ",";
+            vals_sql << "?";
+            params.push_back(internal::rttr_to_value_variant(prop.get_value(entity)));
+            first = false;
+        }
+        vals_sql << ")";
+    }
+
+    std::string sql = "INSERT INTO `" + internal::get_table_name(t) + "` (" + cols_sql.str() + ") VALUES " + vals_sql.str();
+    return {sql, params};
+}
+
+/**
+ * 多次执行并返回平均耗时（微秒）
+ */
+template<typename Fn>
+double averageMicros(int iterations, Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        fn();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::micro>(elapsed).count() / iterations;
+}
+
+/**
+ * 1000行测试用户
+ */
+std::vector<entity::SysUser> makeUsers() {
+    std::vector<entity::SysUser> users(1000);
+    for (size_t i = 0; i < users.size(); ++i) {
+        users[i].dept_id = 100 + static_cast<int64_t>(i % 10);
+        users[i].user_name = "user" + std::to_string(i);
+        users[i].nick_name = "昵称" + std::to_string(i);
+        users[i].user_type = "00";
+        users[i].email = "user" + std::to_string(i) + "@example.com";
+        users[i].sex = '0';
+        users[i].status = '0';
+        users[i].del_flag = '0';
+        users[i].password = "$2a$10$7JB720yubVSZvUI0rEqK/.VqGOZTH.ulu33dHOiBE8ByOhJIrdAu2";
+        users[i].remark = "批量导入";
+    }
+    return users;
+}
+
+} // namespace bench
+
+/**
+ * 1000行SysUser批量插入：新旧实现输出一致
+ */
+TEST_CASE("batchInsert与旧实现一致") {
+    auto users = bench::makeUsers();
+    auto legacy = bench::legacyBatchInsert(users);
+    auto current = orm_rttr::OrmService<entity::SysUser>::batchInsert(users);
+    CHECK(legacy.sql == current.sql);
+    CHECK(legacy.params.size() == current.params.size());
+}
+
+/**
+ * 新旧实现耗时对比，默认跳过；需要时加 --no-skip 运行
+ */
+TEST_CASE("batchInsert基准测试" * doctest::skip()) {
+    std::cout << "\n===== batchInsert基准测试（1000行SysUser） =====\n";
+    auto users = bench::makeUsers();
+
+    const int iterations = 50;
+    double legacyUs = bench::averageMicros(iterations, [&] { bench::legacyBatchInsert(users); });
+    double currentUs = bench::averageMicros(iterations, [&] { orm_rttr::OrmService<entity::SysUser>::batchInsert(users); });
+
+    std::cout << "旧实现: " << legacyUs << " us/次\n";
+    std::cout << "新实现: " << currentUs << " us/次\n";
+    std::cout << "加速比: " << (currentUs > 0 ? legacyUs / currentUs : 0.0) << "x\n";
+}
+
+/**
+ * 分块批量插入：按行数、占位符数与字节预算切分，满块复用同一SQL文本
+ */
+TEST_CASE("分块批量插入") {
+    std::vector<entity::SysUser> users(1000);
+    for (size_t i = 0; i < users.size(); ++i) {
+        users[i].user_name = "user" + std::to_string(i);
+    }
+    using Service = orm_rttr::OrmService<entity::SysUser>;
+    const size_t columns = Service::insert(users[0]).params.size();
+
+    orm_rttr::BatchOptions options;
+    options.max_rows = 300;
+    auto chunks = Service::batchInsert(users, options);
+    REQUIRE(chunks.size() == 4);
+    CHECK(chunks[0].sql == chunks[2].sql);
+    CHECK(chunks[0].params.size() == 300 * columns);
+    CHECK(chunks[3].params.size() == 100 * columns);
+    CHECK(chunks[3].sql != chunks[0].sql);
+
+    // 占位符上限决定每块行数
+    options.max_rows = 1000;
+    options.max_params = columns * 64;
+    auto cursor = Service::batchInsertCursor(users, options);
+    CHECK(cursor.rowsPerChunk() == 64);
+    size_t rows = 0, statements = 0;
+    orm_rttr::SqlQueryResult chunk;
+    while (cursor.next(chunk)) {
+        CHECK(chunk.params.size() <= options.max_params);
+        rows += chunk.params.size() / columns;
+        ++statements;
+    }
+    CHECK(rows == users.size());
+    CHECK(statements == 16);
+
+    // 字节预算较小时按包大小切分，单行仍可成块
+    options.max_params = 65535;
+    options.max_bytes = 1;
+    CHECK(Service::batchInsert(users, options).size() == users.size());
+}
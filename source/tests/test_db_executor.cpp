@@ -0,0 +1,278 @@
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/use_future.hpp>
+#include "db_executor.hpp"
+#include <doctest/doctest.h>
+
+namespace {
+
+// 在io_context上运行协程并取回结果
+template<typename T>
+T runAwaitable(boost::asio::awaitable<T> task) {
+    boost::asio::io_context ioc;
+    auto future = boost::asio::co_spawn(ioc, std::move(task), boost::asio::use_future);
+    ioc.run();
+    return future.get();
+}
+
+// 返回单列 n，值为第一个参数
+orm_rttr::ResultSet echoFirstParam(const std::string&, const std::vector<orm_rttr::ValueVariant>& params) {
+    orm_rttr::ResultSet rs({"n"});
+    if (!params.empty()) rs.appendRow()[0] = params[0];
+    return rs;
+}
+
+} // namespace
+
+/**
+ * 协程执行：语句在执行器线程中运行，结果回到调用方的io_context；同一SQL文本只预编译一次
+ */
+TEST_CASE("协程数据库执行器") {
+    using namespace orm_rttr;
+    auto backend = std::make_shared<MemoryBackend>(echoFirstParam);
+    PoolOptions options;
+    options.max_connections = 1;
+    DbExecutor executor(ConnectionPool::create(backend, options), 2);
+
+    auto rs = runAwaitable(executor.query({"SELECT ?", {42LL}}));
+    REQUIRE(rs.size() == 1);
+    CHECK(std::get<long long>(rs.getValue(0, 0)) == 42);
+
+    runAwaitable(executor.query({"SELECT ?", {7LL}}));
+    CHECK(backend->connects() == 1);
+    CHECK(backend->prepares() == 1);
+
+    // 同一连接上依次执行
+    auto cached = runAwaitable(executor.withConnection([](DbConnection& conn) {
+        conn.execute({"SELECT ?", {1LL}});
+        return conn.cachedStatements();
+    }));
+    CHECK(cached == 1);
+
+    // SQL错误原样抛出，连接仍然复用
+    auto failing = std::make_shared<MemoryBackend>([](const std::string&, const std::vector<ValueVariant>&) -> ResultSet {
+        throw DbError("syntax error");
+    });
+    DbExecutor broken(ConnectionPool::create(failing, options), 1);
+    CHECK_THROWS_AS(runAwaitable(broken.query({"SELEC 1", {}})), DbError);
+    CHECK(broken.pool().stats().idle == 1);
+}
+
+/**
+ * 连接池：达到上限后等待超时，断开的连接在健康检查时丢弃并重建
+ */
+TEST_CASE("连接池超时与健康检查") {
+    using namespace orm_rttr;
+    auto backend = std::make_shared<MemoryBackend>(echoFirstParam);
+    PoolOptions options;
+    options.max_connections = 1;
+    options.acquire_timeout = std::chrono::milliseconds(20);
+    options.health_check_idle = std::chrono::milliseconds(0);
+    auto pool = ConnectionPool::create(backend, options);
+
+    {
+        auto held = pool->acquire();
+        CHECK_THROWS_AS(pool->acquire(), DbTimeoutError);
+        CHECK(pool->stats().timeouts == 1);
+    }
+
+    backend->dropConnections();
+    auto fresh = pool->acquire();
+    CHECK(fresh->ping());
+    CHECK(backend->connects() == 2);
+    CHECK(pool->stats().discarded == 1);
+
+    // 执行时才发现连接断开：抛出DbConnectionError，归还时丢弃
+    options.health_check_idle = std::chrono::hours(1);
+    auto lazy = ConnectionPool::create(backend, options);
+    lazy->acquire();
+    backend->dropConnections();
+    DbExecutor executor(lazy, 1);
+    CHECK_THROWS_AS(runAwaitable(executor.query({"SELECT 1", {}})), DbConnectionError);
+    CHECK(lazy->stats().open == 0);
+    CHECK(runAwaitable(executor.query({"SELECT ?", {5LL}})).size() == 1);
+}
+
+/**
+ * 批量查询：一次等待取回全部结果，顺序与提交顺序一致
+ */
+TEST_CASE("批量查询") {
+    using namespace orm_rttr;
+    auto backend = std::make_shared<MemoryBackend>([](const std::string& sql, const std::vector<ValueVariant>& params) {
+        if (sql == "FAIL") throw DbError("bad statement");
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        return echoFirstParam(sql, params);
+    });
+    PoolOptions options;
+    options.max_connections = 4;
+    DbExecutor executor(ConnectionPool::create(backend, options), 4);
+
+    std::vector<SqlQueryResult> batch;
+    for (long long i = 0; i < 4; ++i) batch.push_back({"SELECT ?", {i}});
+
+    // 管道方式只占用一条连接
+    auto pipelined = runAwaitable(executor.queryBatch(batch));
+    REQUIRE(pipelined.size() == 4);
+    CHECK(std::get<long long>(pipelined[3].getValue(0, 0)) == 3);
+    CHECK(backend->connects() == 1);
+
+    // 并行方式分散到多条连接
+    auto fanned = runAwaitable(executor.queryBatch(batch, BatchMode::FanOut));
+    REQUIRE(fanned.size() == 4);
+    for (long long i = 0; i < 4; ++i) CHECK(std::get<long long>(fanned[i].getValue(0, 0)) == i);
+    CHECK(backend->connects() > 1);
+
+    batch[2].sql = "FAIL";
+    CHECK_THROWS_AS(runAwaitable(executor.queryBatch(batch, BatchMode::FanOut)), DbError);
+    CHECK_THROWS_AS(runAwaitable(executor.queryBatch(batch)), DbError);
+    CHECK(runAwaitable(executor.queryBatch({})).empty());
+}
+
+/**
+ * 读写分离：不带锁的查询轮询副本，写语句与加锁读取发往主库，会话写入后短时间内读取留在主库
+ */
+TEST_CASE("读写分离路由") {
+    using namespace orm_rttr;
+    auto node = [](const std::string& name) {
+        return std::make_shared<DbExecutor>(ConnectionPool::create(std::make_shared<MemoryBackend>(
+            [name](const std::string&, const std::vector<ValueVariant>&) {
+                ResultSet rs({"node"});
+                rs.appendRow()[0] = name;
+                return rs;
+            })), 1);
+    };
+    RoutingOptions options;
+    options.sticky_window = std::chrono::milliseconds(50);
+    DbRouter router(node("primary"), {node("replica1"), node("replica2")}, options);
+    auto served = [&](SqlQueryResult query, DbSession* session = nullptr) {
+        return std::get<std::string>(runAwaitable(router.query(std::move(query), session)).getValue(0, 0));
+    };
+
+    CHECK(served({"SELECT * FROM sys_menu", {}}) == "replica1");
+    CHECK(served({"select * from sys_menu", {}}) == "replica2");
+    CHECK(served({"SELECT * FROM sys_user WHERE user_id = ? FOR UPDATE", {1LL}}) == "primary");
+    CHECK(served({"SELECT * FROM sys_user", {}, StatementRoute::Primary}) == "primary");
+
+    // 读己之写
+    DbSession session;
+    CHECK(served({"UPDATE sys_user SET nick_name = ? WHERE user_id = ?", {std::string("a"), 1LL}}, &session) == "primary");
+    CHECK(served({"SELECT * FROM sys_user", {}}, &session) == "primary");
+    CHECK(served({"SELECT * FROM sys_user", {}}) == "replica1");
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    CHECK(served({"SELECT * FROM sys_user", {}}, &session) == "replica2");
+
+    auto stats = router.stats();
+    CHECK(stats.writes == 1);
+    CHECK(stats.primary_reads == 3);
+    CHECK(stats.replica_reads == 4);
+
+    // 须在同一连接上执行的语句组整组发往同一节点（如 FoundRows 分页的数据语句与 SELECT FOUND_ROWS()）
+    auto nodes = [](const std::vector<ResultSet>& results) {
+        std::vector<std::string> names;
+        for (const auto& rs : results) names.push_back(std::get<std::string>(rs.getValue(0, 0)));
+        return names;
+    };
+    std::vector<SqlQueryResult> page = {{"SELECT SQL_CALC_FOUND_ROWS * FROM sys_user LIMIT ?", {10LL}},
+                                        {"SELECT FOUND_ROWS()", {}}};
+    CHECK(nodes(runAwaitable(router.queryBatch(page))) == std::vector<std::string>{"replica1", "replica1"});
+    CHECK(nodes(runAwaitable(router.queryBatch(page))) == std::vector<std::string>{"replica2", "replica2"});
+
+    // 组内有写语句时整组发往主库，会话随后粘滞
+    DbSession grouped;
+    std::vector<SqlQueryResult> temp = {{"CREATE TEMPORARY TABLE tmp_ids (v BIGINT)", {}},
+                                        {"SELECT * FROM sys_user u JOIN tmp_ids t ON u.user_id = t.v", {}}};
+    CHECK(nodes(runAwaitable(router.queryBatch(temp, BatchMode::Pipelined, &grouped)))
+          == std::vector<std::string>{"primary", "primary"});
+    CHECK(router.route(page, &grouped) == StatementRoute::Primary);
+
+    auto onConnection = [](DbConnection& conn) {
+        return std::get<std::string>(conn.execute({"SELECT 1", {}}).getValue(0, 0));
+    };
+    CHECK(runAwaitable(router.withConnection(onConnection, StatementRoute::Replica)) == "replica1");
+    CHECK(runAwaitable(router.withConnection(onConnection, StatementRoute::Replica, &grouped)) == "primary");
+    CHECK(runAwaitable(router.withConnection(onConnection, StatementRoute::Primary)) == "primary");
+
+    stats = router.stats();
+    CHECK(stats.writes == 3);
+    CHECK(stats.primary_reads == 4);
+    CHECK(stats.replica_reads == 7);
+}
+
+/**
+ * 写语句执行后再次递增表写入代数：生成与执行之间开始的计数不会以新代数留在缓存中
+ */
+TEST_CASE("写语句执行后失效缓存") {
+    using namespace orm_rttr;
+    auto backend = std::make_shared<MemoryBackend>([](const std::string& sql, const std::vector<ValueVariant>& params) {
+        if (sql == "FAIL") throw DbError("bad statement");
+        return echoFirstParam(sql, params);
+    });
+    DbExecutor executor(ConnectionPool::create(backend), 1);
+    const std::string table = "__write_effect_test";
+
+    // 生成写语句时已递增一次（相当于touchTable）
+    SqlQueryResult write{"UPDATE `__write_effect_test` SET `n` = ?", {1LL}};
+    write.effect = std::make_shared<WriteEffect>(WriteEffect{table});
+    TableGeneration::instance().bump(table);
+
+    // 此时开始的计数读到写入前的数据，按当前代数保存
+    CountQuery count{{"SELECT COUNT(*) FROM `__write_effect_test`", {}}, table, true};
+    auto lookup = CountCache::instance().lookup(count);
+    REQUIRE_FALSE(lookup.total.has_value());
+    CountCache::instance().store(lookup, 10);
+    CHECK(CountCache::instance().lookup(count).total == 10);
+
+    const uint64_t before = TableGeneration::instance().current(table);
+    runAwaitable(executor.query(write));
+    CHECK(TableGeneration::instance().current(table) == before + 1);
+    CHECK_FALSE(CountCache::instance().lookup(count).total.has_value());
+
+    // 执行失败不递增
+    SqlQueryResult failing{"FAIL", {}};
+    failing.effect = write.effect;
+    CHECK_THROWS_AS(runAwaitable(executor.query(failing)), DbError);
+    CHECK(TableGeneration::instance().current(table) == before + 1);
+}
+
+/**
+ * 写语句执行时连接断开：语句可能已执行，单条与扇出执行都按结果未知处理
+ */
+TEST_CASE("写语句执行时连接断开") {
+    using namespace orm_rttr;
+    auto backend = std::make_shared<MemoryBackend>(echoFirstParam);
+    PoolOptions options;
+    options.health_check_idle = std::chrono::hours(1);  // 取连接时不检查，执行时才发现断开
+    auto pool = ConnectionPool::create(backend, options);
+    DbExecutor executor(pool, 2);
+    const std::string table = "__write_dropped_test";
+
+    std::vector<ChangeEvent> seen;
+    auto subscription = ChangeEventBus::instance().subscribe({table}, [&](const ChangeEvent& e) { seen.push_back(e); });
+    auto effect = std::make_shared<WriteEffect>();
+    effect->table = table;
+    effect->change = ChangeEvent{table, ChangeOp::Insert, {{1LL}}};
+    SqlQueryResult write{"INSERT INTO `__write_dropped_test` VALUES (?)", {1LL}};
+    write.effect = effect;
+
+    pool->acquire();  // 建立一条空闲连接，随后断开
+    backend->dropConnections();
+    const uint64_t before = TableGeneration::instance().current(table);
+    CHECK_THROWS_AS(runAwaitable(executor.query(write)), DbConnectionError);
+    CHECK(TableGeneration::instance().current(table) == before + 1);
+    REQUIRE(seen.size() == 1);
+    CHECK_FALSE(seen[0].complete);
+    CHECK(seen[0].keys.empty());
+
+    // 扇出：断开的连接上的一条按结果未知处理，新连接上的一条正常完成
+    pool->acquire();
+    backend->dropConnections();
+    CHECK_THROWS_AS(runAwaitable(executor.queryBatch({write, write}, BatchMode::FanOut)), DbConnectionError);
+    CHECK(TableGeneration::instance().current(table) == before + 3);
+    REQUIRE(seen.size() == 3);
+    CHECK(std::count_if(seen.begin() + 1, seen.end(), [](const ChangeEvent& e) { return e.complete; }) == 1);
+}
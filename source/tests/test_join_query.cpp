@@ -215,4 +215,97 @@ TEST_CASE("连接查询测试") {
             std::cout << "生成SQL时出错: " << e.what() << std::endl;
         }
     }
-}
\ No newline at end of file
+}
+
+/**
+ * 连接结果映射：列下标只绑定一次，静态实体与RTTR实体混合映射
+ */
+TEST_CASE("连接结果映射计划") {
+    orm_rttr::JoinResultMapper<entity::SysUser> mapper;
+    mapper.addEntityMapping<entity::SysDept>("d")
+          .addEntityMapping<entity::SysRole>("r");
+
+    orm_rttr::ResultSet resultSet(std::vector<std::string>{
+        "t.user_id", "t.user_name", "d.dept_id", "d.dept_name", "r.role_id", "r.role_name", "extra"
+    });
+    for (int64_t i = 1; i <= 3; ++i) {
+        orm_rttr::ValueVariant* cells = resultSet.appendRow();
+        cells[0] = i;
+        cells[1] = std::string("user") + std::to_string(i);
+        cells[2] = static_cast<int64_t>(100 + i);
+        cells[3] = std::string("dept") + std::to_string(i);
+        cells[4] = static_cast<int64_t>(10 * i);
+        cells[5] = std::string("role") + std::to_string(i);
+        cells[6] = std::string("ignored");
+    }
+
+    auto tuples = mapper.mapToTuples<entity::SysUser, entity::SysDept, entity::SysRole>(resultSet);
+    REQUIRE(tuples.size() == 3);
+    const auto& [user, dept, role] = tuples[2];
+    CHECK(user.user_id == 3);
+    CHECK(user.user_name == "user3");
+    CHECK(dept.dept_id == 103);
+    CHECK(dept.dept_name == "dept3");
+    CHECK(role.role_id == 30);
+    CHECK(role.role_name == "role3");
+
+    auto users = mapper.mapToObjects<entity::SysUser>(resultSet);
+    REQUIRE(users.size() == 3);
+    CHECK(users[0].user_name == "user1");
+    CHECK(mapper.mapToObject<entity::SysRole>(resultSet[1]).role_id == 20);
+}
+
+/**
+ * 查询结果缓存：按所读各表的写入代数失效，超出内存预算时淘汰最久未用的条目
+ */
+TEST_CASE("查询结果缓存") {
+    using namespace orm_rttr;
+    QueryResultCache& cache = QueryResultCache::instance();
+    cache.clear();
+
+    JoinQueryWrapper<entity::SysRole> wrapper;
+    wrapper.mainTableAlias("r")
+        .leftJoin<entity::SysRoleMenu>("rm").on("r.role_id = rm.role_id")
+        .leftJoin<entity::SysMenu>("m").on("rm.menu_id = m.menu_id")
+        .select({"DISTINCT m.perms"})
+        .eq("r.role_id", 2);
+    TaggedQuery query = OrmService<entity::SysRole>::taggedJoinSelect(wrapper);
+    REQUIRE(query.tables.size() == 3);
+    CHECK(query.tables[2] == "sys_menu");
+
+    auto miss = cache.lookup(query);
+    CHECK(miss.get<std::vector<std::string>>() == nullptr);
+    cache.store(miss, std::vector<std::string>{"system:user:list", "system:role:list"});
+    auto hit = cache.lookup(query).get<std::vector<std::string>>();
+    REQUIRE(hit != nullptr);
+    CHECK(hit->size() == 2);
+    CHECK(cache.lookup(query).get<ResultSet>() == nullptr);
+
+    // 连接表之一被写入即失效
+    entity::SysRoleMenu link{};
+    OrmService<entity::SysRoleMenu>::insert(link);
+    CHECK(cache.lookup(query).get<std::vector<std::string>>() == nullptr);
+    auto stats = cache.stats();
+    CHECK(stats.invalidations == 1);
+    CHECK(stats.hits == 2);
+    CHECK(stats.entries == 0);
+
+    // 写语句生成后、执行前开始的读取读到旧数据并以新代数保存，执行完成后再次失效
+    auto pending = OrmService<entity::SysRoleMenu>::insert(link);
+    cache.store(cache.lookup(query), std::vector<std::string>{"system:user:list"});
+    REQUIRE(cache.lookup(query).get<std::vector<std::string>>() != nullptr);
+    completeWrite(pending);
+    CHECK(cache.lookup(query).get<std::vector<std::string>>() == nullptr);
+
+    // 内存预算
+    for (int i = 0; i < 4; ++i) {
+        QueryWrapper<entity::SysMenu> menus;
+        menus.eq("menu_id", i);
+        cache.store(cache.lookup(OrmService<entity::SysMenu>::taggedSelect(menus)), std::string(1000, 'x'));
+    }
+    cache.setBudget(2500);
+    CHECK(cache.stats().entries == 2);
+    CHECK(cache.stats().evictions == 2);
+    CHECK(cache.stats().hitRate() > 0.0);
+    cache.setBudget(64 * 1024 * 1024);
+}
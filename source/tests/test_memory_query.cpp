@@ -0,0 +1,132 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include "entity/sys_entities.hpp"
+#include "entity/sys_entities_mapping.hpp"
+#include "orm_memory.hpp"
+#include <doctest/doctest.h>
+
+namespace {
+
+std::vector<entity::SysDept> makeDepts() {
+    std::vector<entity::SysDept> depts;
+    const char* names[] = {"若依科技", "深圳总公司", "长沙分公司", "研发部门", "市场部门", "测试部门"};
+    const int64_t parents[] = {0, 100, 100, 101, 101, 101};
+    for (int i = 0; i < 6; ++i) {
+        entity::SysDept dept{};
+        dept.dept_id = 100 + i;
+        dept.parent_id = parents[i];
+        dept.dept_name = names[i];
+        dept.order_num = 6 - i;
+        dept.status = i == 4 ? '1' : '0';
+        dept.del_flag = '0';
+        depts.push_back(dept);
+    }
+    return depts;
+}
+
+} // namespace
+
+/**
+ * 同一个QueryWrapper既能生成SQL，也能直接过滤内存中的实体集合
+ */
+TEST_CASE("内存条件查询") {
+    using namespace orm_rttr;
+    auto depts = makeDepts();
+
+    QueryWrapper<entity::SysDept> wrapper;
+    wrapper.eq("parent_id", 101)
+           .eq("status", std::string("0"))
+           .orderBy("order_num", OrderDirection::ASC);
+    std::cout << "SQL: " << wrapper.getSelectSql().sql << std::endl;
+
+    InMemoryQuery<entity::SysDept> query(wrapper);
+    auto rows = query.select(depts);
+    REQUIRE(rows.size() == 2);
+    CHECK(rows[0].dept_name == "测试部门");
+    CHECK(rows[1].dept_name == "研发部门");
+    CHECK(query.count(depts) == 2);
+
+    // IN、BETWEEN、分页
+    QueryWrapper<entity::SysDept> paged;
+    paged.in("parent_id", std::vector<int64_t>{100, 101})
+         .between("order_num", 1, 5)
+         .orderBy("dept_id", OrderDirection::DESC)
+         .limit(2).offset(1);
+    auto page = InMemoryQuery<entity::SysDept>(paged).select(depts);
+    REQUIRE(page.size() == 2);
+    CHECK(page[0].dept_id == 104);
+    CHECK(page[1].dept_id == 103);
+
+    // OR逻辑
+    QueryWrapper<entity::SysDept> either;
+    either.or_().eq("dept_id", 100).eq("status", std::string("1"));
+    CHECK(InMemoryQuery<entity::SysDept>(either).count(depts) == 2);
+}
+
+TEST_CASE("内存查询LIKE与NULL语义") {
+    using namespace orm_rttr;
+    CHECK(internal::like_match("Research Dept", "research%"));
+    CHECK(internal::like_match("abc", "a_c"));
+    CHECK(internal::like_match("100%", "100\\%"));
+    CHECK_FALSE(internal::like_match("1000", "100\\%"));
+    CHECK_FALSE(internal::like_match("abc", "a_"));
+    CHECK(internal::compare_values(ValueVariant{1}, ValueVariant{1.0}) == 0);
+    CHECK_FALSE(internal::compare_values(ValueVariant{}, ValueVariant{1}).has_value());
+
+    std::vector<entity::SysPost> posts(3);
+    posts[0].post_id = 1; posts[0].post_code = "CEO"; posts[0].post_name = "董事长"; posts[0].status = '0';
+    posts[1].post_id = 2; posts[1].post_code = "se"; posts[1].post_name = "项目经理"; posts[1].status = '0';
+    posts[2].post_id = 3; posts[2].post_code = "HR"; posts[2].post_name = "人力资源"; posts[2].status = '1';
+
+    InMemoryTable<entity::SysPost> table;
+    CHECK(table.stale());
+    // 读取期间完成的写入：快照仍过期
+    auto generation = table.beginLoad();
+    completeWrite(OrmService<entity::SysPost>::deleteById(9));
+    table.load(posts, generation);
+    CHECK(table.stale());
+    table.load(posts, table.beginLoad());
+    CHECK_FALSE(table.stale());
+
+    QueryWrapper<entity::SysPost> wrapper;
+    wrapper.like("post_code", "S%").ne("status", std::string("1"));
+    auto found = table.selectOne(wrapper);
+    REQUIRE(found.has_value());
+    CHECK(found->post_id == 2);
+
+    QueryWrapper<entity::SysPost> notIn;
+    notIn.notIn("post_id", std::vector<int64_t>{1, 3});
+    CHECK(table.count(notIn) == 1);
+
+    // 写语句使快照过期
+    entity::SysPost post{};
+    OrmService<entity::SysPost>::insert(post);
+    CHECK(table.stale());
+}
+
+/**
+ * 拆分执行的大IN查询：合并各段结果，去重后按原排序与分页截取
+ */
+TEST_CASE("大IN列表拆分结果合并") {
+    using namespace orm_rttr;
+    auto depts = makeDepts();
+
+    QueryWrapper<entity::SysDept> wrapper;
+    wrapper.or_().in("dept_id", std::vector<int64_t>{100, 101, 102, 103, 104, 105}).eq("status", std::string("0"))
+           .orderBy("order_num", OrderDirection::ASC).limit(3).offset(1);
+
+    std::vector<std::vector<entity::SysDept>> parts{
+        {depts[0], depts[1], depts[2], depts[3]},
+        {depts[3], depts[4], depts[5], depts[0]}};
+    auto rows = mergeSplitResults(std::move(parts), wrapper);
+    REQUIRE(rows.size() == 3);
+    CHECK(rows[0].dept_id == 104);
+    CHECK(rows[1].dept_id == 103);
+    CHECK(rows[2].dept_id == 102);
+
+    QueryWrapper<entity::SysDept> subquery;
+    subquery.inSubquery("dept_id", "SELECT dept_id FROM sys_role_dept");
+    CHECK(subquery.getSelectSql().params.empty());
+    CHECK_THROWS(InMemoryQuery<entity::SysDept>(subquery));
+}
@@ -5,6 +5,8 @@
 #include <chrono>
 #include <sstream>
 #include <cmath>
+#include <limits>
+#include <numeric>
 #include <doctest/doctest.h>
 
 #include "orm_rttr.hpp"
@@ -252,4 +254,586 @@ TEST_CASE("ORM功能测试") {
     } catch (const std::exception& e) {
         std::cout << "生成SQL时出错: " << e.what() << std::endl;
     }
-}
\ No newline at end of file
+}
+
+// --- 测试实体元数据计划 ---
+TEST_CASE("实体元数据计划") {
+    using namespace orm_rttr;
+
+    const EntityPlan& plan = EntityPlan::of<User>();
+    CHECK(&plan == &EntityPlan::of<User>()); // 只构建一次
+    CHECK(plan.table_name == "users");
+    CHECK(plan.quoted_table == "`users`");
+    REQUIRE(plan.pk_index >= 0);
+    CHECK(plan.primaryKey().name == "id");
+    CHECK(plan.primaryKey().auto_increment);
+    CHECK(plan.insert_indices.size() == plan.props.size() - 1);
+    CHECK(plan.insert_columns_sql.find("`id`") == std::string::npos);
+    CHECK(plan.use_logical_delete);
+    CHECK(plan.logical_delete_field == "is_deleted");
+    CHECK(plan.use_version);
+    CHECK(plan.props[plan.version_index].name == "version");
+    CHECK(plan.props[plan.create_time_index].name == "create_time");
+    CHECK(plan.props[plan.update_time_index].name == "update_time");
+    CHECK(plan.property("score").negative_as_null);
+    CHECK(plan.property("age").kind == ValueKind::Int);
+    CHECK_THROWS(plan.property("missing"));
+
+    // 负数空值规则只在显式要求时生效
+    User user{};
+    user.score = -1;
+    CHECK(std::holds_alternative<int>(plan.property("score").read(user)));
+    CHECK(std::holds_alternative<std::monostate>(plan.property("score").read(user, true)));
+}
+
+// --- 测试SQL形状缓存 ---
+TEST_CASE("SQL形状缓存") {
+    using namespace orm_rttr;
+    SqlShapeCache::instance().clear();
+
+    QueryWrapper<User> first;
+    first.eq("name", std::string("Alice")).in("id", std::vector<long long>{1, 2, 3}).orderBy("age", OrderDirection::DESC).limit(10);
+    QueryWrapper<User> second;
+    second.eq("name", std::string("Bob")).in("id", std::vector<long long>{7, 8, 9}).orderBy("age", OrderDirection::DESC).limit(10);
+
+    auto a = first.getSelectSql();
+    auto b = second.getSelectSql();
+    CHECK(a.sql == b.sql);
+    REQUIRE(b.params.size() == 5);
+    CHECK(std::get<std::string>(b.params[0]) == "Bob");
+    CHECK(std::get<long long>(b.params[3]) == 9);
+    CHECK(std::get<long long>(b.params[4]) == 10);  // LIMIT以参数绑定
+
+    auto stats = SqlShapeCache::instance().stats();
+    CHECK(stats.misses == 1);
+    CHECK(stats.hits == 1);
+
+    // IN元数不同属于新形状
+    QueryWrapper<User> third;
+    third.eq("name", std::string("Carol")).in("id", std::vector<long long>{1, 2}).orderBy("age", OrderDirection::DESC).limit(10);
+    CHECK(third.getSelectSql().sql != a.sql);
+    CHECK(SqlShapeCache::instance().stats().misses == 2);
+
+    // 操作符与元数分别记入形状键：不分桶时大IN列表不会与相邻操作符的形状混淆
+    {
+        InListPolicy saved = InListPolicy::global();
+        InListPolicy::global().bucket_threshold = std::numeric_limits<size_t>::max();
+        std::vector<long long> many(100001);
+        std::iota(many.begin(), many.end(), 1LL);
+        QueryWrapper<User> wide;
+        wide.in("id", many);
+        QueryWrapper<User> single;
+        single.notIn("id", std::vector<long long>{1});
+        CHECK(single.getSelectSql().sql.find("NOT IN") != std::string::npos);
+        CHECK(wide.getSelectSql().sql.find("NOT IN") == std::string::npos);
+        InListPolicy::global() = saved;
+    }
+
+    // 计数语句与查询语句分别缓存
+    CHECK(first.getCountSql().sql == second.getCountSql().sql);
+    CHECK(SqlShapeCache::instance().stats().hits == 2);
+    CHECK(first.getCountSql().params.size() == 4);  // 计数语句不带分页参数
+
+    // 不同页码共享同一形状
+    QueryWrapper<User> page3 = first;
+    page3.offset(20);
+    QueryWrapper<User> page4 = first;
+    page4.offset(30);
+    const auto misses = SqlShapeCache::instance().stats().misses;
+    CHECK(page3.getSelectSql().sql == page4.getSelectSql().sql);
+    CHECK(SqlShapeCache::instance().stats().misses == misses + 1);
+    CHECK(std::get<long long>(page4.getSelectSql().params.back()) == 30);
+
+    // 容量满后淘汰最久未使用的形状，新形状仍可缓存
+    SqlShapeCache::instance().setCapacity(2);
+    CHECK(SqlShapeCache::instance().stats().entries == 2);
+    third.getSelectSql();
+    const auto hits = SqlShapeCache::instance().stats().hits;
+    third.getSelectSql();
+    CHECK(SqlShapeCache::instance().stats().hits == hits + 1);
+    CHECK(SqlShapeCache::instance().stats().evictions > 0);
+    SqlShapeCache::instance().setCapacity(4096);
+}
+
+// --- 测试列式结果集 ---
+TEST_CASE("共享列结构的结果集") {
+    using namespace orm_rttr;
+
+    ResultSet rs({"id", "name"});
+    ValueVariant* cells = rs.appendRow();
+    cells[0] = 1LL;
+    cells[1] = std::string("Alice");
+
+    // 逐行构建的DbRow按列名对齐，出现新列时已有行补NULL
+    DbRow row;
+    row.setValue("name", std::string("Bob"));
+    row.setValue("id", 2LL);
+    row.setValue("age", 42);
+    rs.push_back(row);
+
+    REQUIRE(rs.size() == 2);
+    CHECK(rs.columnCount() == 3);
+    const int ageIdx = rs.columnIndex("age");
+    REQUIRE(ageIdx == 2);
+    CHECK(std::holds_alternative<std::monostate>(rs[0].getValue(static_cast<size_t>(ageIdx))));
+    CHECK(rs[1].getValueAs<int>(static_cast<size_t>(ageIdx)) == 42);
+    CHECK(rs[1].getValueAs<std::string>("name") == "Bob");
+    CHECK(rs[0].getValueAs<int>(static_cast<size_t>(ageIdx)) == 0);
+    CHECK_FALSE(rs[0].hasColumn("email"));
+    CHECK_THROWS(rs[0].getValue("email"));
+
+    long long sum = 0;
+    for (const auto& r : rs) sum += r.getValueAs<long long>("id");
+    CHECK(sum == 3);
+
+    // 复制出的行共享列结构，新增列时写时复制
+    DbRow shared(rs.schemaPtr());
+    shared.setValue("email", std::string("x@example.com"));
+    CHECK(shared.hasColumn("email"));
+    CHECK_FALSE(rs.schema().indexOf("email") >= 0);
+}
+
+// --- 测试脏字段跟踪 ---
+TEST_CASE("脏字段跟踪更新") {
+    using namespace orm_rttr;
+
+    User loaded{};
+    loaded.id = 7;
+    loaded.name = "old";
+    loaded.age = 20;
+    loaded.version = 5;
+    loaded.score = 10;
+
+    Tracked<User> tracked(loaded);
+    CHECK_FALSE(tracked.isDirty());
+    CHECK_FALSE(OrmService<User>::updateChanged(tracked).has_value());
+
+    tracked->name = "new";
+    CHECK(tracked.changedFields() == std::vector<std::string>{"name"});
+
+    auto update = OrmService<User>::updateChanged(tracked);
+    REQUIRE(update.has_value());
+    print_sql("脏字段跟踪更新", *update);
+    CHECK(update->sql == "UPDATE `users` SET `name` = ?, `version` = ?, `update_time` = ? WHERE `id` = ? AND `version` = ?");
+    REQUIRE(update->params.size() == 5);
+    CHECK(std::get<std::string>(update->params[0]) == "new");
+    CHECK(std::get<long long>(update->params[1]) == 6);
+    CHECK(std::get<long long>(update->params[3]) == 7);
+    CHECK(std::get<long long>(update->params[4]) == 5);
+
+    tracked.markClean();
+    CHECK_FALSE(tracked.isDirty());
+
+    // 只改主键：不生成语句，版本与更新时间保持不变
+    const auto update_time = tracked->update_time;
+    tracked->id = 8;
+    CHECK_FALSE(OrmService<User>::updateChanged(tracked).has_value());
+    CHECK(tracked->version == 6);
+    CHECK(tracked->update_time == update_time);
+
+    // 指定字段更新按实体计划顺序生成，与集合迭代顺序无关
+    User user = loaded;
+    auto first = OrmService<User>::updateFieldsById(user, {"score", "age", "name"});
+    auto second = OrmService<User>::updateFieldsById(user, {"name", "score", "age"});
+    CHECK(first.sql == second.sql);
+    CHECK(first.sql == "UPDATE `users` SET `name` = ?, `age` = ?, `score` = ? WHERE `id` = ? AND `version` = ?");
+}
+
+// --- 测试批量更新与批量插入或更新 ---
+TEST_CASE("批量更新与批量插入或更新") {
+    using namespace orm_rttr;
+
+    std::vector<User> users(3);
+    for (size_t i = 0; i < users.size(); ++i) {
+        users[i].id = static_cast<long long>(i + 1);
+        users[i].name = "user" + std::to_string(i);
+        users[i].age = 30;
+        users[i].version = 1;
+        users[i].score = static_cast<int>(i) * 10;
+    }
+    const auto created = std::chrono::system_clock::now() - std::chrono::hours(24);
+    users[0].create_time = created;
+
+    auto upsert = OrmService<User>::batchUpsert(users);
+    REQUIRE(upsert.size() == 1);
+    print_sql("批量插入或更新", upsert[0]);
+    CHECK(upsert[0].sql.rfind("INSERT INTO `users` (`id`, `name`, ", 0) == 0);
+    CHECK(upsert[0].sql.find("ON DUPLICATE KEY UPDATE `name` = VALUES(`name`)") != std::string::npos);
+    CHECK(upsert[0].sql.find("`version` = `version` + 1") != std::string::npos);
+    CHECK(upsert[0].sql.find("`create_time` = VALUES") == std::string::npos);
+    CHECK(upsert[0].sql.find("`is_deleted` = VALUES") == std::string::npos);
+    CHECK(upsert[0].params.size() == 27);
+    // 已有行：版本号与冲突分支结果一致，已设置的创建时间不被覆盖
+    CHECK(users[0].version == 2);
+    CHECK(users[0].create_time == created);
+    CHECK(users[1].create_time.time_since_epoch().count() != 0);
+    std::vector<User> fresh(1);
+    fresh[0].id = 9;
+    OrmService<User>::batchUpsert(fresh);
+    CHECK(fresh[0].version == 1);
+
+    // 整块取值相同的列折叠为单个占位符
+    auto sameAge = OrmService<User>::batchUpdateById(users, {"age"});
+    REQUIRE(sameAge.size() == 1);
+    print_sql("批量更新（相同取值）", sameAge[0]);
+    CHECK(sameAge[0].sql == "UPDATE `users` SET `age` = ?, `update_time` = ?, `version` = `version` + 1 "
+                            "WHERE (`id`, `version`) IN ((?,?),(?,?),(?,?)) AND `is_deleted` != 1");
+    CHECK(sameAge[0].params.size() == 8);
+    CHECK(users[0].version == 3);
+
+    // 取值不同使用CASE分支，空值行保持原值
+    users[1].score = -1;
+    auto scores = OrmService<User>::batchUpdateById(users, {"score"});
+    REQUIRE(scores.size() == 1);
+    print_sql("批量更新（CASE）", scores[0]);
+    CHECK(scores[0].sql.rfind("UPDATE `users` SET `score` = CASE `id` WHEN ? THEN ? WHEN ? THEN ? ELSE `score` END, ", 0) == 0);
+
+    // 按行数分块
+    BatchOptions options;
+    options.max_rows = 2;
+    CHECK(OrmService<User>::batchUpdateById(users, {"name"}, options).size() == 2);
+    CHECK_THROWS(OrmService<User>::batchUpdateById(users, {"missing"}));
+}
+
+// --- 测试游标分页 ---
+TEST_CASE("游标分页") {
+    using namespace orm_rttr;
+
+    QueryWrapper<User> wrapper;
+    wrapper.gt("age", 18)
+           .orderBy("create_time", OrderDirection::DESC)
+           .orderBy("id", OrderDirection::DESC);
+
+    SeekParam page;
+    page.page_size = 20;
+    auto first = OrmService<User>::selectSeekPage(wrapper, page);
+    print_sql("游标分页（第一页）", first);
+    CHECK(first.sql == "SELECT * FROM `users` WHERE `age` > ? AND `is_deleted` != 1 ORDER BY `create_time` DESC, `id` DESC LIMIT ?");
+    CHECK(std::get<long long>(first.params.back()) == 21);
+
+    // 模拟查询返回page_size+1行
+    std::vector<User> rows(21);
+    for (size_t i = 0; i < rows.size(); ++i) rows[i].id = static_cast<long long>(100 - i);
+    auto result = OrmService<User>::buildSeekPage(rows, wrapper, page);
+    CHECK(result.records.size() == 20);
+    REQUIRE(result.has_next);
+    REQUIRE(!result.next_cursor.empty());
+
+    page.cursor = result.next_cursor;
+    auto next = OrmService<User>::selectSeekPage(wrapper, page);
+    print_sql("游标分页（下一页）", next);
+    CHECK(next.sql == "SELECT * FROM `users` WHERE `age` > ? AND (`create_time`, `id`) < (?, ?) AND `is_deleted` != 1 "
+                      "ORDER BY `create_time` DESC, `id` DESC LIMIT ?");
+    REQUIRE(next.params.size() == 4);
+    CHECK(std::get<long long>(next.params[2]) == 81);
+
+    // 排序方向混合时展开为OR形式
+    QueryWrapper<User> mixed;
+    mixed.orderBy("age", OrderDirection::ASC).orderBy("id", OrderDirection::DESC);
+    SeekParam mixedPage{10, internal::encode_seek_cursor({30, 5LL})};
+    auto mixedSql = OrmService<User>::selectSeekPage(mixed, mixedPage);
+    CHECK(mixedSql.sql == "SELECT * FROM `users` WHERE ((`age` > ?) OR (`age` = ? AND `id` < ?)) AND `is_deleted` != 1 "
+                          "ORDER BY `age` ASC, `id` DESC LIMIT ?");
+    CHECK(mixedSql.params.size() == 4);
+
+    CHECK_THROWS(OrmService<User>::selectSeekPage(QueryWrapper<User>(), page));
+    SeekParam badCursor{10, "not-a-cursor"};
+    CHECK_THROWS(OrmService<User>::selectSeekPage(wrapper, badCursor));
+}
+
+// --- 测试单次往返分页 ---
+TEST_CASE("单次往返分页") {
+    using namespace orm_rttr;
+
+    QueryWrapper<User> wrapper;
+    wrapper.gt("age", 18);
+    PageParam page{2, 10};
+
+    auto window = OrmService<User>::selectPage(wrapper, page, PageCountMode::Window);
+    print_sql("窗口计数分页", window.data);
+    CHECK_FALSE(window.count.has_value());
+    CHECK(window.data.sql == "SELECT *,COUNT(*) OVER() AS `__total` FROM `users` WHERE `age` > ? AND `is_deleted` != 1 LIMIT ? OFFSET ?");
+
+    auto foundRows = OrmService<User>::selectPage(wrapper, page, PageCountMode::FoundRows);
+    CHECK(foundRows.data.sql.rfind("SELECT SQL_CALC_FOUND_ROWS * FROM `users`", 0) == 0);
+    REQUIRE(foundRows.count.has_value());
+    CHECK(foundRows.count->sql == "SELECT FOUND_ROWS()");
+
+    auto skip = OrmService<User>::selectPage(wrapper, page, PageCountMode::SkipCount);
+    CHECK(skip.data.sql == "SELECT * FROM `users` WHERE `age` > ? AND `is_deleted` != 1 LIMIT ? OFFSET ?");
+    REQUIRE(skip.data.params.size() == 3);
+    CHECK(std::get<long long>(skip.data.params[1]) == 11);
+    CHECK(std::get<long long>(skip.data.params[2]) == 10);
+
+    auto separate = OrmService<User>::selectPage(wrapper, page, PageCountMode::Separate);
+    REQUIRE(separate.count.has_value());
+    CHECK(separate.count->sql == "SELECT COUNT(*) FROM `users` WHERE `age` > ?");
+
+    // 从首行的总数列读取总数
+    ResultSet rows(std::vector<std::string>{"id", "__total"});
+    for (int i = 0; i < 10; ++i) {
+        ValueVariant* cells = rows.appendRow();
+        cells[0] = static_cast<long long>(i);
+        cells[1] = 35LL;
+    }
+    auto result = PageResult<User>::build(std::vector<User>(10), rows, page);
+    CHECK(result.total == 35);
+    CHECK(result.pages == 4);
+    CHECK(result.has_next);
+
+    // 页码越界时没有行，总数未知而不是0
+    ResultSet beyond(std::vector<std::string>{"id", "__total"});
+    auto past = PageResult<User>::build({}, beyond, PageParam{9, 10});
+    CHECK(past.total == -1);
+    CHECK_FALSE(past.total_exact);
+    CHECK_FALSE(past.has_next);
+    auto empty = PageResult<User>::build({}, beyond, PageParam{1, 10});
+    CHECK(empty.total == 0);
+    CHECK(empty.total_exact);
+
+    // 字符串形式的总数按整数解析，无法解析时总数未知
+    ResultSet text(std::vector<std::string>{"FOUND_ROWS()"});
+    text.appendRow()[0] = std::string("42");
+    CHECK(PageResult<User>::build({}, text, page).total == 42);
+    ResultSet bad(std::vector<std::string>{"FOUND_ROWS()"});
+    bad.appendRow()[0] = std::string("n/a");
+    CHECK(PageResult<User>::build({}, bad, page).total == -1);
+
+    auto scroll = PageResult<User>::buildSkipCount(std::vector<User>(11), page);
+    CHECK(scroll.records.size() == 10);
+    CHECK(scroll.has_next);
+    CHECK(scroll.total == -1);
+}
+
+// --- 测试计数缓存 ---
+TEST_CASE("计数缓存") {
+    using namespace orm_rttr;
+    CountCache& cache = CountCache::instance();
+    cache.clear();
+
+    QueryWrapper<User> wrapper;
+    wrapper.gt("age", 18);
+    CountQuery query = OrmService<User>::countQuery(wrapper);
+    CHECK(query.exact);
+    CHECK(query.table == "users");
+
+    auto miss = cache.lookup(query);
+    CHECK_FALSE(miss.total.has_value());
+    cache.store(miss, 42);
+    auto hit = cache.lookup(query);
+    REQUIRE(hit.total.has_value());
+    CHECK(*hit.total == 42);
+
+    // 参数不同视为不同的键
+    QueryWrapper<User> other;
+    other.gt("age", 30);
+    CHECK_FALSE(cache.lookup(OrmService<User>::countQuery(other)).total.has_value());
+
+    // 写语句使缓存失效
+    OrmService<User>::deleteById(1LL);
+    CHECK_FALSE(cache.lookup(query).total.has_value());
+
+    // 查询期间表被写入时不保存
+    auto stale = cache.lookup(query);
+    User user{};
+    OrmService<User>::insert(user);
+    cache.store(stale, 1);
+    CHECK_FALSE(cache.lookup(query).total.has_value());
+
+    // TTL到期
+    cache.setTtl(std::chrono::seconds(0));
+    cache.store(cache.lookup(query), 7);
+    CHECK_FALSE(cache.lookup(query).total.has_value());
+    cache.setTtl(std::chrono::seconds(30));
+
+    // 无过滤条件时可使用估算总数
+    CountQuery approx = OrmService<User>::countQuery(QueryWrapper<User>(), CountMode::Approximate);
+    CHECK_FALSE(approx.exact);
+    CHECK(approx.sql.sql.find("information_schema.TABLES") != std::string::npos);
+    CHECK(OrmService<User>::countQuery(wrapper, CountMode::Approximate).exact);
+
+    auto page = PageResult<User>::build({}, 1000, PageParam{}, approx.exact);
+    CHECK_FALSE(page.total_exact);
+}
+
+TEST_CASE("大IN列表改写") {
+    using namespace orm_rttr;
+    InListPolicy& policy = InListPolicy::global();
+    const InListPolicy saved = policy;
+
+    // 达到分桶阈值后去重排序并补齐到2的幂，元数相近的列表共享同一语句
+    std::vector<long long> ids;
+    for (long long i = 20; i > 0; --i) ids.push_back(i % 10 == 0 ? 5 : i);
+    QueryWrapper<User> bucketed;
+    bucketed.in("id", ids);
+    auto sql = bucketed.getSelectSql();
+    REQUIRE(sql.params.size() == 32);
+    CHECK(std::get<long long>(sql.params[0]) == 1);
+    CHECK(std::get<long long>(sql.params[31]) == 19);
+
+    // 超过拆分阈值：按段生成语句，分页推迟到合并后
+    policy.split_threshold = 8;
+    policy.temp_table_threshold = 16;
+    std::vector<long long> many(12);
+    for (size_t i = 0; i < many.size(); ++i) many[i] = static_cast<long long>(i + 1);
+    QueryWrapper<User> wrapper;
+    wrapper.in("id", many).orderBy("age", OrderDirection::DESC).limit(5).offset(10);
+    auto split = OrmService<User>::planInList(wrapper);
+    CHECK(split.kind == InListPlan::Kind::Split);
+    REQUIRE(split.queries.size() == 2);
+    CHECK(split.queries[0].params.size() == 9);
+    CHECK(split.queries[1].params.size() == 5);
+    CHECK(split.queries[0].sql.find("LIMIT ?") != std::string::npos);
+    CHECK(std::get<long long>(split.queries[0].params.back()) == 15);
+    CHECK(split.queries[0].sql.find("OFFSET") == std::string::npos);
+
+    // NOT IN不能拆分，改用临时表子查询
+    QueryWrapper<User> excluded;
+    excluded.notIn("id", many);
+    auto temp = OrmService<User>::planInList(excluded);
+    CHECK(temp.kind == InListPlan::Kind::TempTable);
+    REQUIRE(temp.setup.size() == 4);
+    CHECK(temp.setup[1].sql.find("`v` BIGINT NOT NULL PRIMARY KEY") != std::string::npos);
+    CHECK(temp.setup[2].sql == temp.setup[3].sql);
+    REQUIRE(temp.queries.size() == 1);
+    CHECK(temp.queries[0].sql.find("NOT IN (SELECT `v` FROM `__in_id`)") != std::string::npos);
+    CHECK(temp.queries[0].params.empty());
+    REQUIRE(temp.cleanup.size() == 1);
+
+    // 未超过阈值时原样执行
+    QueryWrapper<User> small;
+    small.in("id", std::vector<long long>{1, 2, 3});
+    CHECK(OrmService<User>::planInList(small).kind == InListPlan::Kind::Single);
+
+    policy = saved;
+}
+
+TEST_CASE("实体缓存") {
+    using namespace orm_rttr;
+    EntityCache<User>& cache = EntityCache<User>::instance();
+    cache.setEnabled(true);
+
+    User user{};
+    user.id = 7;
+    user.name = "Alice";
+    user.version = 3;
+
+    auto miss = cache.lookup(7);
+    CHECK(miss.entity == nullptr);
+    cache.store(miss, user);
+    auto hit = cache.lookup(7LL);
+    REQUIRE(hit.entity != nullptr);
+    CHECK(hit.entity->name == "Alice");
+
+    // 已知更高版本时缓存条目视为过期
+    CHECK(cache.lookup(7, 4).entity == nullptr);
+
+    // 查询开始后按主键更新：该次查询的结果不被保存
+    auto inflight = cache.lookup(7);
+    User edited = user;
+    OrmService<User>::updateFieldsById(edited, {"name"});
+    cache.store(inflight, user);
+    CHECK(cache.lookup(7).entity == nullptr);
+
+    // 较旧版本不覆盖较新版本
+    cache.store(cache.lookup(7), edited);
+    cache.store(cache.lookup(7), user);
+    REQUIRE(cache.lookup(7).entity != nullptr);
+    CHECK(cache.lookup(7).entity->version == edited.version);
+
+    OrmService<User>::deleteById(7);
+    CHECK(cache.lookup(7).entity == nullptr);
+    CHECK(cache.stats().invalidations == 2);
+
+    // 写语句生成后、执行前开始的读取：失效标记早于查询，读到的旧行会被保存，执行完成后再次失效
+    auto pending = OrmService<User>::updateFieldsById(edited, {"name"});
+    cache.store(cache.lookup(7), user);
+    REQUIRE(cache.lookup(7).entity != nullptr);
+    completeWrite(pending);
+    CHECK(cache.lookup(7).entity == nullptr);
+    CHECK(cache.stats().invalidations == 4);
+
+    // 请求级标识映射
+    IdentityMap identity;
+    identity.put<User>(7, std::make_shared<const User>(user));
+    CHECK(identity.find<User>(7LL) != nullptr);
+    identity.forget<User>(7);
+    CHECK(identity.size() == 0);
+
+    cache.setEnabled(false);
+    cache.store(cache.lookup(7), user);
+    CHECK(cache.size() == 0);
+}
+
+TEST_CASE("语句路由标记") {
+    using namespace orm_rttr;
+    QueryWrapper<User> wrapper;
+    wrapper.eq("name", std::string("Alice"));
+    CHECK(OrmService<User>::selectByCondition(wrapper).route == StatementRoute::Replica);
+    CHECK(OrmService<User>::selectByCondition(wrapper, LockMode::ForUpdate).route == StatementRoute::Primary);
+    CHECK(OrmService<User>::getById(1LL, LockMode::ForShare).route == StatementRoute::Primary);
+
+    // 未标记的语句按文本判断
+    User user{};
+    CHECK(internal::resolve_route(OrmService<User>::insert(user)) == StatementRoute::Primary);
+    CHECK(internal::resolve_route(wrapper.getCountSql()) == StatementRoute::Replica);
+    CHECK(internal::classify_statement("(SELECT 1) UNION (SELECT 2)") == StatementRoute::Replica);
+    CHECK(internal::classify_statement("select * from t lock in share mode") == StatementRoute::Primary);
+}
+
+TEST_CASE("自增主键的变更事件") {
+    using namespace orm_rttr;
+    auto subscription = ChangeEventBus::instance().subscribe({"users"}, [](const ChangeEvent&) {});
+
+    // 插入前拿不到数据库生成的主键：不携带主键，标记为不完整
+    User user{};
+    user.id = 0;
+    auto insert = OrmService<User>::insert(user);
+    REQUIRE(insert.effect);
+    REQUIRE(insert.effect->change);
+    CHECK_FALSE(insert.effect->change->complete);
+    CHECK(insert.effect->change->keys.empty());
+
+    // upsert带上已有主键时事件可信；含主键为0的行则同插入
+    std::vector<User> users(2);
+    users[0].id = 3;
+    users[1].id = 4;
+    auto upsert = OrmService<User>::batchUpsert(users);
+    REQUIRE(upsert[0].effect->change);
+    CHECK(upsert[0].effect->change->complete);
+    CHECK(upsert[0].effect->change->keys.size() == 2);
+    users[1].id = 0;
+    upsert = OrmService<User>::batchUpsert(users);
+    CHECK_FALSE(upsert[0].effect->change->complete);
+    CHECK(upsert[0].effect->change->keys.empty());
+
+    // 更新按主键定向
+    users[1].id = 4;
+    auto update = OrmService<User>::updateById(users[1]);
+    REQUIRE(update.effect->change);
+    CHECK(update.effect->change->complete);
+    REQUIRE(update.effect->change->keys.size() == 1);
+    CHECK(internal::value_to_long_long(update.effect->change->keys[0][0]) == 4);
+}
+
+TEST_CASE("附加谓词") {
+    using namespace orm_rttr;
+    // apply追加的谓词与其余条件整体以AND连接，or_()不会放宽它
+    QueryWrapper<User> wrapper;
+    wrapper.eq("age", 18).or_().eq("age", 20).apply("score > ? OR email = ?", {10, std::string("a@b.c")});
+    auto sql = OrmService<User>::selectByCondition(wrapper);
+    CHECK(sql.sql == "SELECT * FROM `users` WHERE (`age` = ? OR `age` = ?) AND (score > ? OR email = ?) AND `is_deleted` != 1");
+    REQUIRE(sql.params.size() == 4);
+    CHECK(std::get<int>(sql.params[2]) == 10);
+
+    // 谓词文本参与形状键，参数不参与
+    QueryWrapper<User> other;
+    other.eq("age", 18).or_().eq("age", 20).apply("score > ? OR email = ?", {99, std::string("x@y.z")});
+    auto otherSql = OrmService<User>::selectByCondition(other);
+    CHECK(otherSql.sql == sql.sql);
+    CHECK(std::get<int>(otherSql.params[2]) == 99);
+
+    QueryWrapper<User> only;
+    only.apply("1 = 0");
+    CHECK(only.getCountSql().sql == "SELECT COUNT(*) FROM `users` WHERE (1 = 0)");
+}
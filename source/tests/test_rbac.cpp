@@ -0,0 +1,428 @@
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <doctest/doctest.h>
+
+#include "rbac/change_listener.hpp"
+#include "rbac/data_scope.hpp"
+#include "rbac/dept_tree.hpp"
+#include "rbac/menu_tree.hpp"
+#include "rbac/permission_index.hpp"
+
+namespace {
+
+entity::SysMenu makeMenu(int64_t menu_id, std::string perms, char status = '0') {
+    entity::SysMenu menu{};
+    menu.menu_id = menu_id;
+    menu.menu_type = 'F';
+    menu.status = status;
+    menu.perms = std::move(perms);
+    return menu;
+}
+
+entity::SysRole makeRole(int64_t role_id, std::string role_key, char status = '0', char del_flag = '0') {
+    entity::SysRole role{};
+    role.role_id = role_id;
+    role.role_key = std::move(role_key);
+    role.status = status;
+    role.del_flag = del_flag;
+    return role;
+}
+
+} // namespace
+
+/**
+ * 权限索引：与 getUserPermsSql 结果一致；停用角色与停用菜单不授予权限，同一角色组合的用户共享并集
+ */
+TEST_CASE("权限索引") {
+    using namespace rbac;
+    std::vector<entity::SysMenu> menus = {
+        makeMenu(1, "system:user:list"),
+        makeMenu(2, "system:user:add,system:user:edit"),
+        makeMenu(3, "system:role:list"),
+        makeMenu(4, "system:log:list", '1'),
+    };
+    std::vector<entity::SysRole> roles = {
+        makeRole(1, "admin"), makeRole(2, "common"), makeRole(3, "auditor"), makeRole(4, "frozen", '1'),
+    };
+    std::vector<entity::SysRoleMenu> role_menus = {{2, 1}, {2, 2}, {3, 3}, {3, 4}, {4, 3}};
+    std::vector<entity::SysUserRole> user_roles = {{1, 1}, {2, 2}, {3, 2}, {3, 3}, {4, 4}, {5, 2}};
+
+    PermissionIndex index;
+    index.load(menus, roles, role_menus, user_roles, index.beginLoad());
+
+    CHECK(index.hasPerm(2, "system:user:list"));
+    CHECK(index.hasPerm(2, "system:user:edit"));
+    CHECK_FALSE(index.hasPerm(2, "system:role:list"));
+    CHECK(index.hasPerm(3, "system:role:list"));
+    CHECK_FALSE(index.hasPerm(3, "system:log:list"));  // 菜单停用
+    CHECK_FALSE(index.hasPerm(4, "system:role:list"));  // 角色停用
+    CHECK_FALSE(index.hasPerm(99, "system:user:list"));
+
+    CHECK(index.isAdmin(1));
+    CHECK(index.hasPerm(1, "anything:at:all"));
+    CHECK(index.perms(1) == std::vector<std::string>{"*:*:*"});
+    CHECK(index.perms(2) == std::vector<std::string>{"system:user:add", "system:user:edit", "system:user:list"});
+
+    auto stats = index.stats();
+    CHECK(stats.perms == 4);
+    CHECK(stats.roles == 3);
+    CHECK(stats.role_sets == 4);  // 用户2与用户5共享 {2}
+
+    // 单个用户改授角色
+    index.setUserRoles(2, {3});
+    CHECK_FALSE(index.hasPerm(2, "system:user:list"));
+    CHECK(index.hasPerm(2, "system:role:list"));
+    index.setUserRoles(5, {});
+    CHECK(index.perms(5).empty());
+
+    // 菜单变化：已有标识的id不变，新增标识立即可用
+    menus.push_back(makeMenu(5, "system:user:remove"));
+    role_menus.push_back({3, 5});
+    index.reloadMenus(menus, index.beginLoad());
+    CHECK_FALSE(index.hasPerm(2, "system:user:remove"));  // 关联尚未重新载入
+    index.reloadRoles(roles, role_menus, index.beginLoad());
+    CHECK(index.hasPerm(2, "system:user:remove"));
+    CHECK(index.hasPerm(2, "system:role:list"));
+
+    // 相关表写入后报告过期，重新载入对应部分后恢复
+    CHECK(index.staleTables().empty());
+    orm_rttr::TableGeneration::instance().bump("sys_user_role");
+    CHECK(index.staleTables() == std::vector<std::string>{"sys_user_role"});
+    index.reloadUserRoles(user_roles, index.beginLoad());
+    CHECK(index.staleTables().empty());
+    CHECK(index.hasPerm(2, "system:user:list"));
+
+    // 读取源表之后、载入之前完成的写入：载入的是写入前的行，仍报告过期
+    auto generations = index.beginLoad();
+    orm_rttr::TableGeneration::instance().bump("sys_user_role");
+    index.reloadUserRoles(user_roles, generations);
+    CHECK(index.staleTables() == std::vector<std::string>{"sys_user_role"});
+    index.reloadUserRoles(user_roles, index.beginLoad());
+    CHECK(index.staleTables().empty());
+}
+
+/**
+ * 部门树：子部门查询变为区间判断，新增与移动只在空闲编号区间内增量分配
+ */
+TEST_CASE("部门树") {
+    using namespace rbac;
+    auto dept = [](int64_t dept_id, int64_t parent_id, char del_flag = '0') {
+        entity::SysDept d{};
+        d.dept_id = dept_id;
+        d.parent_id = parent_id;
+        d.del_flag = del_flag;
+        return d;
+    };
+    // 100 ─┬─ 101 ─┬─ 103
+    //      │       └─ 104
+    //      └─ 102 ─── 105
+    DeptTree tree;
+    tree.load({dept(100, 0), dept(101, 100), dept(102, 100), dept(103, 101), dept(104, 101), dept(105, 102), dept(106, 102, '2')},
+              tree.beginLoad());
+
+    auto sorted = [](std::vector<int64_t> ids) { std::sort(ids.begin(), ids.end()); return ids; };
+    CHECK(sorted(tree.descendants(101)) == std::vector<int64_t>{101, 103, 104});
+    CHECK(sorted(tree.descendants(100, false)) == std::vector<int64_t>{101, 102, 103, 104, 105});
+    CHECK(tree.descendants(106).empty());
+    CHECK(tree.inSubtree(105, 100));
+    CHECK_FALSE(tree.inSubtree(105, 101));
+    CHECK(tree.ancestors(103) == "0,100,101");
+    CHECK(tree.stats().depts == 6);
+
+    // 新增部门不触发整体重新编号
+    tree.insert(dept(107, 101));
+    tree.insert(dept(108, 107));
+    CHECK(tree.stats().renumbers == 1);
+    CHECK(sorted(tree.descendants(101)) == std::vector<int64_t>{101, 103, 104, 107, 108});
+    CHECK(tree.ancestors(108) == "0,100,101,107");
+    CHECK_THROWS_AS(tree.insert(dept(103, 100)), std::invalid_argument);
+
+    // 移动子树
+    tree.move(107, 102);
+    CHECK(tree.stats().renumbers == 1);
+    CHECK(sorted(tree.descendants(101)) == std::vector<int64_t>{101, 103, 104});
+    CHECK(sorted(tree.descendants(102)) == std::vector<int64_t>{102, 105, 107, 108});
+    CHECK(tree.inSubtree(108, 102));
+    CHECK(tree.ancestors(108) == "0,100,102,107");
+    CHECK_THROWS_AS(tree.move(102, 108), std::invalid_argument);
+
+    // 间隔耗尽时整体重新编号，结果不变
+    for (int64_t id = 200; id < 260; ++id) tree.insert(dept(id, 105));
+    CHECK(tree.stats().renumbers > 1);
+    CHECK(tree.descendants(105).size() == 61);
+    CHECK(tree.inSubtree(259, 100));
+
+    tree.remove(102);
+    CHECK(sorted(tree.descendants(100)) == std::vector<int64_t>{100, 101, 103, 104});
+    CHECK_FALSE(tree.contains(259));
+
+    CHECK_FALSE(tree.stale());
+    orm_rttr::TableGeneration::instance().bump("sys_dept");
+    CHECK(tree.stale());
+    // 修改部门树期间完成的其他写入不被确认
+    const uint64_t synced = tree.beginLoad();
+    orm_rttr::TableGeneration::instance().bump("sys_dept");
+    tree.markSynced(synced);
+    CHECK(tree.stale());
+    tree.markSynced(tree.beginLoad());
+    CHECK_FALSE(tree.stale());
+
+    // 读取 sys_dept 之后、载入之前完成的写入：载入后仍过期
+    const uint64_t generation = tree.beginLoad();
+    orm_rttr::TableGeneration::instance().bump("sys_dept");
+    tree.load({dept(100, 0)}, generation);
+    CHECK(tree.stale());
+}
+
+/**
+ * 数据权限：角色组合编译为部门集合与仅本人过滤，按角色组合与部门缓存
+ */
+TEST_CASE("数据权限编译") {
+    using namespace rbac;
+    auto dept = [](int64_t dept_id, int64_t parent_id) {
+        entity::SysDept d{};
+        d.dept_id = dept_id;
+        d.parent_id = parent_id;
+        d.del_flag = '0';
+        return d;
+    };
+    auto role = [](int64_t role_id, char data_scope, char status = '0') {
+        entity::SysRole r = makeRole(role_id, "r" + std::to_string(role_id), status);
+        r.data_scope = data_scope;
+        return r;
+    };
+    DeptTree tree;
+    tree.load({dept(100, 0), dept(101, 100), dept(102, 100), dept(103, 101), dept(200, 0)}, tree.beginLoad());
+
+    DataScopeCompiler compiler(tree);
+    compiler.load({role(1, DATA_SCOPE_ALL), role(2, DATA_SCOPE_CUSTOM), role(3, DATA_SCOPE_DEPT),
+                   role(4, DATA_SCOPE_DEPT_AND_CHILD), role(5, DATA_SCOPE_SELF), role(6, DATA_SCOPE_ALL, '1')},
+                  {{2, 200}, {2, 102}}, compiler.beginLoad());
+
+    CHECK(compiler.compile({1, 5}, 7, 101).all());
+    CHECK_FALSE(compiler.compile({6}, 7, 101).all());  // 停用角色
+    CHECK(compiler.compile({6}, 7, 101).compiled->none());
+
+    auto scope = compiler.compile({4, 2}, 7, 101);
+    CHECK(scope.compiled->dept_ids == std::vector<int64_t>{101, 102, 103, 200});
+    REQUIRE(scope.compiled->ranges.size() == 2);
+    CHECK(scope.compiled->ranges[0].first == 101);
+    CHECK(scope.compiled->ranges[0].last == 103);
+    CHECK(scope.allows(103, 1));
+    CHECK_FALSE(scope.allows(100, 7));
+
+    auto self = compiler.compile({5, 3}, 7, 100);
+    CHECK(self.allows(100, 1));
+    CHECK(self.allows(200, 7));
+    CHECK_FALSE(self.allows(200, 8));
+
+    // 同一角色组合与部门复用编译结果，角色顺序无关
+    const auto misses = compiler.stats().misses;
+    auto again = compiler.compile({2, 4, 4}, 8, 101);
+    CHECK(again.compiled == scope.compiled);
+    CHECK(again.user_id == 8);
+    CHECK(compiler.stats().misses == misses);
+
+    // 追加的谓词
+    orm_rttr::QueryWrapper<entity::SysUser> wrapper;
+    scope.applyTo(wrapper, "u.dept_id", "u.user_id");
+    REQUIRE(wrapper.appliedPredicates().size() == 1);
+    CHECK(wrapper.appliedPredicates()[0].first == "u.dept_id BETWEEN ? AND ? OR u.dept_id = ?");
+    CHECK(wrapper.appliedPredicates()[0].second.size() == 3);
+    orm_rttr::QueryWrapper<entity::SysUser> selfOnly;
+    self.applyTo(selfOnly);
+    CHECK(selfOnly.appliedPredicates()[0].first == "dept_id = ? OR user_id = ?");
+    orm_rttr::QueryWrapper<entity::SysUser> nothing;
+    compiler.compile({6}, 7, 101).applyTo(nothing);
+    CHECK(nothing.appliedPredicates()[0].first == "1 = 0");
+
+    // sys_role_dept 变化后重新载入，缓存失效
+    orm_rttr::TableGeneration::instance().bump("sys_role_dept");
+    CHECK(compiler.staleTables() == std::vector<std::string>{"sys_role_dept"});
+    // 读取之后、载入之前完成的写入使该表仍过期
+    auto generations = compiler.beginLoad();
+    orm_rttr::TableGeneration::instance().bump("sys_role_dept");
+    compiler.reloadRoleDepts({{2, 100}}, generations);
+    CHECK(compiler.staleTables() == std::vector<std::string>{"sys_role_dept"});
+    compiler.reloadRoleDepts({{2, 100}}, compiler.beginLoad());
+    CHECK(compiler.staleTables().empty());
+    CHECK(compiler.compile({2}, 7, 101).compiled->dept_ids == std::vector<int64_t>{100});
+
+    // 部门树变化后本部门及以下重新展开
+    CHECK(compiler.compile({4}, 7, 101).compiled->dept_ids.size() == 2);
+    tree.insert(dept(104, 101));
+    CHECK(compiler.compile({4}, 7, 101).compiled->dept_ids.size() == 3);
+}
+
+/**
+ * 菜单树：每个角色组合构建一次并缓存序列化结果，子菜单按 order_num 排序
+ */
+TEST_CASE("菜单树缓存") {
+    using namespace rbac;
+    auto menu = [](int64_t menu_id, int64_t parent_id, int order_num, char menu_type, char status = '0') {
+        entity::SysMenu m = makeMenu(menu_id, "", status);
+        m.parent_id = parent_id;
+        m.order_num = order_num;
+        m.menu_type = menu_type;
+        m.menu_name = "m" + std::to_string(menu_id);
+        return m;
+    };
+    std::vector<entity::SysMenu> menus = {
+        menu(1, 0, 2, 'M'), menu(2, 0, 1, 'M'), menu(10, 1, 2, 'C'), menu(11, 1, 1, 'C'),
+        menu(12, 1, 3, 'C', '1'), menu(100, 10, 1, 'F'), menu(20, 2, 1, 'C'),
+    };
+    std::vector<entity::SysRole> roles = {makeRole(1, "admin"), makeRole(2, "common"), makeRole(3, "frozen", '1')};
+    std::vector<entity::SysRoleMenu> role_menus = {{2, 1}, {2, 10}, {2, 11}, {2, 12}, {2, 100}, {3, 2}, {3, 20}};
+
+    MenuTreeService service;
+    service.load(menus, roles, role_menus, service.beginLoad());
+
+    auto common = service.tree({2});
+    auto parsed = boost::json::parse(*common).as_array();
+    REQUIRE(parsed.size() == 1);
+    CHECK(parsed[0].at("menuId").as_int64() == 1);
+    auto& children = parsed[0].at("children").as_array();
+    REQUIRE(children.size() == 2);  // 停用菜单与按钮不进入菜单树
+    CHECK(children[0].at("menuId").as_int64() == 11);
+    CHECK(children[1].at("menuId").as_int64() == 10);
+
+    // 同一角色组合直接返回缓存；停用角色不影响键
+    CHECK(service.tree({2, 3}) == common);
+    CHECK(service.stats().hits == 1);
+    CHECK(service.stats().builds == 1);
+
+    auto all = boost::json::parse(*service.tree({1})).as_array();
+    REQUIRE(all.size() == 2);
+    CHECK(all[0].at("menuId").as_int64() == 2);
+    CHECK(service.tree({3})->compare("[]") == 0);
+
+    // 菜单变化后重新载入，缓存失效
+    orm_rttr::TableGeneration::instance().bump("sys_menu");
+    CHECK(service.staleTables() == std::vector<std::string>{"sys_menu"});
+    menus[4].status = '0';
+    service.reloadMenus(menus, service.beginLoad());
+    CHECK(service.staleTables().empty());
+
+    // 读取之后、载入之前完成的写入不被掩盖
+    auto generations = service.beginLoad();
+    orm_rttr::TableGeneration::instance().bump("sys_menu");
+    service.reloadMenus(menus, generations);
+    CHECK(service.staleTables() == std::vector<std::string>{"sys_menu"});
+    service.reloadMenus(menus, service.beginLoad());
+    CHECK(service.staleTables().empty());
+    CHECK(boost::json::parse(*service.tree({2})).as_array()[0].at("children").as_array().size() == 3);
+}
+
+/**
+ * 变更事件：写语句执行成功后发布，失败不发布；显式事务内按(表, 操作)合并后一次投递，回滚丢弃；
+ * 监听器将关联表的增删按批定向应用到内存结构
+ */
+TEST_CASE("变更事件") {
+    using namespace rbac;
+    using orm_rttr::ChangeEvent;
+    using orm_rttr::ChangeOp;
+    auto& bus = orm_rttr::ChangeEventBus::instance();
+    auto event = [](std::string table, ChangeOp op, std::vector<std::vector<orm_rttr::ValueVariant>> keys) {
+        return ChangeEvent{std::move(table), op, std::move(keys)};
+    };
+    // 生成器填写的写语句后续处理
+    auto write = [&](std::string table, ChangeOp op, std::vector<std::vector<orm_rttr::ValueVariant>> keys) {
+        auto effect = std::make_shared<orm_rttr::WriteEffect>();
+        effect->table = table;
+        effect->change = event(std::move(table), op, std::move(keys));
+        orm_rttr::SqlQueryResult query;
+        query.effect = std::move(effect);
+        return query;
+    };
+
+    std::vector<ChangeEvent> seen;
+    auto subscription = bus.subscribe({"sys_post"}, [&](const ChangeEvent& e) { seen.push_back(e); });
+    {
+        orm_rttr::ChangeTransaction transaction;
+        transaction.add(event("sys_post", ChangeOp::Update, {{2L}, {1L}}));
+        orm_rttr::completeWrite(write("sys_post", ChangeOp::Update, {{1L}, {3L}}), &transaction);
+        transaction.add(event("sys_post", ChangeOp::Delete, {{4L}}));
+        CHECK(transaction.pending() == 2);
+        CHECK(seen.empty());
+        transaction.commit();
+        CHECK_THROWS_AS(transaction.commit(), std::logic_error);  // 重复提交
+        CHECK_THROWS_AS(transaction.add(event("sys_post", ChangeOp::Insert, {{9L}})), std::logic_error);
+    }
+    REQUIRE(seen.size() == 2);
+    CHECK(seen[0].keys.size() == 3);  // 主键去重
+    CHECK(seen[1].generation == seen[0].generation + 1);
+    CHECK(bus.generation() == seen[1].generation);
+    {
+        orm_rttr::ChangeTransaction transaction;
+        transaction.add(event("sys_post", ChangeOp::Insert, {{5L}}));
+    }
+    CHECK(seen.size() == 2);  // 未提交即回滚
+    {
+        // 内层并入外层；内层未结束时外层不能提交
+        orm_rttr::ChangeTransaction outer;
+        {
+            orm_rttr::ChangeTransaction inner(outer);
+            inner.add(event("sys_post", ChangeOp::Insert, {{6L}}));
+            CHECK_THROWS_AS(outer.commit(), std::logic_error);
+            inner.commit();
+        }
+        CHECK(outer.pending() == 1);
+        CHECK(seen.size() == 2);
+        outer.commit();
+    }
+    CHECK(seen.size() == 3);
+    bus.publish(event("sys_notice", ChangeOp::Insert, {{1L}}));
+    CHECK(seen.size() == 3);  // 未订阅的表
+
+    // 只生成、未执行（或执行失败）的写语句不发布；执行结果未知时发布不带主键的不完整事件
+    auto failed = write("sys_post", ChangeOp::Insert, {{7L}});
+    CHECK(seen.size() == 3);
+    orm_rttr::abandonWrite(failed);
+    REQUIRE(seen.size() == 4);
+    CHECK_FALSE(seen[3].complete);
+    CHECK(seen[3].keys.empty());
+
+    // 监听器
+    std::vector<entity::SysMenu> menus = {makeMenu(1, "system:user:list"), makeMenu(2, "system:role:list")};
+    std::vector<entity::SysRole> roles = {makeRole(2, "common"), makeRole(3, "auditor")};
+    PermissionIndex index;
+    index.load(menus, roles, {{2, 1}}, {{7, 2}}, index.beginLoad());
+    MenuTreeService service;
+    service.load(menus, roles, {{2, 1}}, service.beginLoad());
+    RbacChangeListener listener(&index, nullptr, &service, nullptr);
+
+    const uint64_t before = listener.generation();
+    // 生成授权语句但执行失败：不授予
+    auto grant = write("sys_user_role", ChangeOp::Insert, {{7L, 3L}, {8L, 3L}});
+    CHECK(index.roles(7) == std::vector<int64_t>{2});
+    orm_rttr::completeWrite(grant);  // 一个事件中的多行一次应用
+    CHECK(index.roles(7) == std::vector<int64_t>{2, 3});
+    CHECK(index.roles(8) == std::vector<int64_t>{3});
+    bus.publish(event("sys_role_menu", ChangeOp::Insert, {{3L, 2L}}));
+    CHECK(index.hasPerm(7, "system:role:list"));
+    CHECK(index.hasPerm(8, "system:role:list"));
+    bus.publish(event("sys_role_menu", ChangeOp::Delete, {{2L}}));  // 按角色删除全部菜单
+    CHECK_FALSE(index.hasPerm(7, "system:user:list"));
+    bus.publish(event("sys_user_role", ChangeOp::Delete, {{7L}, {8L, 3L}}));
+    CHECK(index.roles(7).empty());
+    CHECK(index.roles(8).empty());
+    CHECK(listener.generation() > before);
+    CHECK(listener.stats().applied == 4);
+
+    // 菜单行变化无法定向处理，记入待重新载入
+    bus.publish(event("sys_menu", ChangeOp::Update, {{1L}}));
+    CHECK(listener.pendingReload() == std::vector<std::string>{"sys_menu"});
+    const uint64_t reload_from = listener.generation();
+    bus.publish(event("sys_menu", ChangeOp::Update, {{2L}}));  // 重新载入期间到达的变更不被确认掉
+    listener.markReloaded("sys_menu", reload_from);
+    CHECK(listener.pendingReload() == std::vector<std::string>{"sys_menu"});
+    listener.markReloaded("sys_menu", listener.generation());
+    CHECK(listener.pendingReload().empty());
+
+    // 执行结果未知的关联表写入同样只能重新载入
+    orm_rttr::abandonWrite(write("sys_user_role", ChangeOp::Delete, {{2L, 2L}}));
+    CHECK(listener.pendingReload() == std::vector<std::string>{"sys_user_role"});
+    CHECK(listener.stats().deferred == 3);
+}
@@ -3,6 +3,8 @@
 #include "entity/sys_entities.hpp"
 #include "entity/sys_entities_mapping.hpp"
 #include "orm_rttr.hpp"
+#include "rbac/data_scope.hpp"
+#include "rbac/dept_tree.hpp"
 #include <variant>
 #include <doctest/doctest.h>
 
@@ -54,6 +56,22 @@ std::pair<orm_rttr::SqlQueryResult, orm_rttr::SqlQueryResult> getUserListSql(
     return orm_rttr::OrmService<entity::SysUser>::selectPage(wrapper, pageParam);
 }
 
+/**
+ * 获取数据权限范围内的用户列表查询SQL（分页），数据权限以预编译谓词追加，不再执行数据范围子查询
+ * @param pageParam 分页参数
+ * @param scope 当前用户的数据权限
+ * @return SQL查询结果对（计数SQL和数据SQL）
+ */
+std::pair<orm_rttr::SqlQueryResult, orm_rttr::SqlQueryResult> getUserListSql(
+        const orm_rttr::PageParam& pageParam,
+        const rbac::DataScope& scope) {
+    orm_rttr::QueryWrapper<entity::SysUser> wrapper;
+    wrapper.eq("del_flag", '0');
+    scope.applyTo(wrapper, "`dept_id`", "`user_id`");
+    wrapper.orderBy("create_time", orm_rttr::OrderDirection::DESC);
+    return orm_rttr::OrmService<entity::SysUser>::selectPage(wrapper, pageParam);
+}
+
 /**
  * 获取带部门信息的用户查询SQL
  * @param userId 用户ID
@@ -247,6 +265,19 @@ orm_rttr::SqlQueryResult getUsersByDeptHierarchySql(int64_t userId) {
     return result;
 }
 
+/**
+ * 获取部门及子部门的所有用户（由部门树展开子部门）
+ * @param tree 已载入的部门树
+ * @param deptId 部门ID
+ * @return SQL查询结果
+ */
+orm_rttr::SqlQueryResult getUsersByDeptHierarchySql(const rbac::DeptTree& tree, int64_t deptId) {
+    orm_rttr::QueryWrapper<entity::SysUser> wrapper;
+    tree.applyTo(wrapper, "dept_id", deptId);
+    wrapper.eq("del_flag", '0');
+    return orm_rttr::OrmService<entity::SysUser>::selectByCondition(wrapper);
+}
+
 /**
  * 格式化参数列表为字符串
  * @param params 参数列表
@@ -321,6 +352,16 @@ TEST_CASE("用户SQL查询测试") {
         std::cout << "数据SQL: " << listSql.sql << std::endl;
         std::cout << "数据参数: " << test_sql::formatParams(listSql.params) << std::endl;
 
+        // 数据权限：本部门及以下（101~103）或本人
+        auto compiled = std::make_shared<rbac::CompiledDataScope>();
+        compiled->self = true;
+        compiled->dept_ids = {101, 102, 103};
+        compiled->ranges = {{101, 103}};
+        auto [scopedCount, scopedList] = test_sql::getUserListSql(pageParam, rbac::DataScope{compiled, userId});
+        std::cout << "数据权限计数SQL: " << scopedCount.sql << std::endl;
+        CHECK(scopedCount.sql.find("AND (`dept_id` BETWEEN ? AND ? OR `user_id` = ?)") != std::string::npos);
+        CHECK(scopedList.sql.find("data_scope") == std::string::npos);
+
         // 3. 获取带部门信息的用户
         std::cout << "\n--- 3. 获取带部门信息的用户 ---\n";
         auto userWithDept = test_sql::getUserWithDeptSql(userId);
@@ -375,6 +416,20 @@ TEST_CASE("用户SQL查询测试") {
         auto usersByDeptHierarchy = test_sql::getUsersByDeptHierarchySql(userId);
         std::cout << "SQL: " << usersByDeptHierarchy.sql << std::endl;
         std::cout << "参数: " << test_sql::formatParams(usersByDeptHierarchy.params) << std::endl;
+
+        // 12. 由部门树展开子部门
+        std::cout << "\n--- 12. 由部门树展开子部门 ---\n";
+        rbac::DeptTree tree;
+        entity::SysDept root{}, child{};
+        root.dept_id = 100;
+        child.dept_id = 101;
+        child.parent_id = 100;
+        tree.load({root, child}, tree.beginLoad());
+        auto usersByDeptTree = test_sql::getUsersByDeptHierarchySql(tree, 100);
+        std::cout << "SQL: " << usersByDeptTree.sql << std::endl;
+        std::cout << "参数: " << test_sql::formatParams(usersByDeptTree.params) << std::endl;
+        CHECK(usersByDeptTree.sql.find("ancestors") == std::string::npos);
+        CHECK(usersByDeptTree.sql.find("`dept_id` IN (?,?)") != std::string::npos);
     } catch (const std::exception& e) {
         std::cout << "生成SQL时出错: " << e.what() << std::endl;
     }
@@ -422,4 +477,75 @@ void saveSqlToFile() {
     } catch (const std::exception& e) {
         std::cout << "保存SQL到文件失败: " << e.what() << std::endl;
     }
-}
\ No newline at end of file
+}
+/**
+ * 测试静态反射路径：SysUser/SysDept走Boost.PFR描述符生成插入语句并映射结果
+ */
+TEST_CASE("静态反射插入与映射") {
+    static_assert(orm_rttr::PfrEntity<entity::SysUser>);
+    static_assert(orm_rttr::PfrEntity<entity::SysDept>);
+    static_assert(!orm_rttr::PfrEntity<entity::SysRole>);
+
+    entity::SysUser user{};
+    user.dept_id = 103;
+    user.user_name = "admin";
+    user.sex = '1';
+    user.remark = "管理员";
+
+    auto insertSql = orm_rttr::OrmService<entity::SysUser>::insert(user);
+    CHECK(insertSql.sql.rfind("INSERT INTO `sys_user` (`dept_id`, `user_name`, ", 0) == 0);
+    CHECK(insertSql.sql.find("`user_id`") == std::string::npos);
+    REQUIRE(insertSql.params.size() == 19);
+    CHECK(std::get<int64_t>(insertSql.params[0]) == 103);
+    CHECK(std::get<std::string>(insertSql.params[1]) == "admin");
+    CHECK(std::get<std::string>(insertSql.params[6]) == "1");
+    CHECK(std::get<std::string>(insertSql.params[18]) == "管理员");
+
+    std::vector<entity::SysDept> depts(2);
+    depts[0].dept_name = "研发部门";
+    depts[1].dept_name = "测试部门";
+    auto batchSql = orm_rttr::OrmService<entity::SysDept>::batchInsert(depts);
+    CHECK(batchSql.sql.find("VALUES (?,?,?,?,?,?,?,?,?,?,?,?,?),(?,?,?,?,?,?,?,?,?,?,?,?,?)") != std::string::npos);
+    CHECK(batchSql.params.size() == 26);
+
+    orm_rttr::DbRow row;
+    row.setValue("user_id", 1LL);
+    row.setValue("user_name", std::string("ry"));
+    row.setValue("status", std::string("0"));
+    row.setValue("remark", orm_rttr::ValueVariant{});
+    auto mapped = orm_rttr::OrmService<entity::SysUser>::mapRow(row);
+    CHECK(mapped.user_id == 1);
+    CHECK(mapped.user_name == "ry");
+    CHECK(mapped.status == '0');
+    CHECK(mapped.remark.empty());
+}
+
+TEST_CASE("借用参数绑定") {
+    entity::SysUser user{};
+    user.dept_id = 103;
+    user.user_name = "admin";
+    user.sex = '1';
+    user.remark = std::string(64, 'x');
+
+    auto view = orm_rttr::OrmService<entity::SysUser>::insertView(user);
+    auto owned = orm_rttr::OrmService<entity::SysUser>::insert(user);
+    CHECK(view.sql == owned.sql);
+    REQUIRE(view.params.size() == owned.params.size());
+    // 字符串参数直接指向实体字段
+    CHECK(std::get<std::string_view>(view.params[1]).data() == user.user_name.data());
+    CHECK(std::get<std::string_view>(view.params[18]).data() == user.remark.data());
+    CHECK(std::get<std::string_view>(view.params[6]) == "1");
+
+    auto materialized = view.materialize();
+    CHECK(std::get<std::string>(materialized.params[18]) == user.remark);
+    CHECK(std::get<int64_t>(materialized.params[0]) == 103);
+
+    orm_rttr::QueryWrapper<entity::SysUser> wrapper;
+    wrapper.eq("user_name", "admin").in("status", std::vector<std::string>{"0", "1"});
+    auto selectView = wrapper.getSelectSqlView();
+    auto selectSql = wrapper.getSelectSql();
+    CHECK(selectView.sql == selectSql.sql);
+    REQUIRE(selectView.params.size() == 3);
+    CHECK(std::get<std::string_view>(selectView.params[0]) == "admin");
+    CHECK(std::get<std::string>(selectSql.params[2]) == "1");
+}